@@ -177,7 +177,28 @@ HEADERS	+=	src/TWApp.h \
 			src/synctex_parser_utils.h \
 			src/ClickableLabel.h \
 			src/ConfigurableApp.h \
-			src/TWSystemCmd.h
+			src/TWSystemCmd.h \
+			src/DocumentSaver.h \
+			src/DelimiterIndex.h \
+			src/TeXBlockData.h \
+			src/CompletionStore.h \
+			src/DictionaryManager.h \
+			src/TypesetScheduler.h \
+			src/LivePreview.h \
+			src/PreambleCache.h \
+			src/BuildDriver.h \
+			src/LogParser.h \
+			src/BuildStatistics.h \
+			src/EngineResolver.h \
+			src/BuildDirectory.h \
+			src/SettingsStore.h \
+			src/FilePropertyStore.h \
+			src/PDFLinkIndex.h \
+			src/PDFRenderer.h \
+			src/PDFPageStrip.h \
+			src/PDFFontScanner.h \
+			src/PDFOutline.h \
+			src/PDFRenderCache.h
 
 FORMS	+=	src/TeXDocument.ui \
 			src/PDFDocument.ui \
@@ -213,6 +234,27 @@ SOURCES	+=	src/main.cpp \
 			src/ResourcesDialog.cpp \
 			src/ScriptManager.cpp \
 			src/ConfirmDelete.cpp \
+			src/DocumentSaver.cpp \
+			src/DelimiterIndex.cpp \
+			src/TeXBlockData.cpp \
+			src/CompletionStore.cpp \
+			src/DictionaryManager.cpp \
+			src/TypesetScheduler.cpp \
+			src/LivePreview.cpp \
+			src/PreambleCache.cpp \
+			src/BuildDriver.cpp \
+			src/LogParser.cpp \
+			src/BuildStatistics.cpp \
+			src/EngineResolver.cpp \
+			src/BuildDirectory.cpp \
+			src/SettingsStore.cpp \
+			src/FilePropertyStore.cpp \
+			src/PDFLinkIndex.cpp \
+			src/PDFRenderer.cpp \
+			src/PDFPageStrip.cpp \
+			src/PDFFontScanner.cpp \
+			src/PDFOutline.cpp \
+			src/PDFRenderCache.cpp \
 			src/synctex_parser.c \
 			src/synctex_parser_utils.c
 
@@ -0,0 +1,182 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#include "BuildDirectory.h"
+#include "TWUtils.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDirIterator>
+#include <QRegExp>
+#include <QCryptographicHash>
+
+#ifdef Q_WS_WIN
+#include <windows.h>
+#else
+#include <stdio.h>
+#endif
+
+// scratch directories not used for this long are removed
+const int kStaleBuildDays = 2;
+
+// outputs that are copied back, in this order: the PDF goes last, so a
+// previewer reloading it finds the matching SyncTeX data
+static const char * const kCommittedSuffixes[] = {
+	".synctex.gz", ".synctex", ".pdf", NULL
+};
+
+BuildDirectory::BuildDirectory(const QString& rootFile)
+	: rootFilePath(rootFile), dirPath(pathFor(rootFile))
+{
+}
+
+QString BuildDirectory::scratchRoot()
+{
+#ifdef Q_OS_LINUX
+	// the per-user tmpfs on systemd-based systems, then the shared one
+	QString runtimeDir = QString::fromLocal8Bit(qgetenv("XDG_RUNTIME_DIR"));
+	QFileInfo runtimeInfo(runtimeDir);
+	if (!runtimeDir.isEmpty() && runtimeInfo.isDir() && runtimeInfo.isWritable())
+		return runtimeDir + "/texworks-build";
+	QFileInfo shmInfo("/dev/shm");
+	if (shmInfo.isDir() && shmInfo.isWritable())
+		return TWUtils::privatePath("/dev/shm", "texworks-build");
+#endif
+	return TWUtils::privatePath(QDir::tempPath(), "texworks-build");
+}
+
+QString BuildDirectory::pathFor(const QString& file)
+{
+	// keyed by directory and job name, so the root file and its PDF map to
+	// the same directory
+	QFileInfo fi(file);
+	QString job = fi.absolutePath() + "/" + fi.completeBaseName();
+	return scratchRoot() + "/" + QCryptographicHash::hash(job.toUtf8(), QCryptographicHash::Sha1).toHex()
+		+ "-" + fi.completeBaseName();
+}
+
+void BuildDirectory::removeStaleDirectories(const QString& keep)
+{
+	// a RAM-backed file system is only freed at reboot otherwise
+	QDateTime limit = QDateTime::currentDateTime().addDays(-kStaleBuildDays);
+	foreach (const QFileInfo& job, QDir(scratchRoot()).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+		if (job.absoluteFilePath() == keep || job.isSymLink())
+			continue;
+		QDateTime lastUsed = job.lastModified();
+		QDirIterator it(job.absoluteFilePath(), QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+		while (it.hasNext()) {
+			it.next();
+			if (it.fileInfo().lastModified() > lastUsed)
+				lastUsed = it.fileInfo().lastModified();
+		}
+		if (lastUsed < limit)
+			TWUtils::removeDirectory(job.absoluteFilePath());
+	}
+}
+
+bool BuildDirectory::prepare()
+{
+	// the PDF and SyncTeX file are copied back next to the document, so no
+	// one else may be able to read or plant files in there
+	if (!TWUtils::makePrivateDirectory(scratchRoot()))
+		return false;
+	static bool cleanedUp = false;
+	if (!cleanedUp) {
+		removeStaleDirectories(dirPath);
+		cleanedUp = true;
+	}
+
+	QDir dir(dirPath);
+	if (!dir.mkpath("."))
+		return false;
+
+	// TeX opens the .aux file of \include{chapters/intro} as chapters/intro.aux
+	// in the output directory, and fails if the subdirectory doesn't exist
+	QFile root(rootFilePath);
+	if (root.open(QIODevice::ReadOnly)) {
+		QString text = QString::fromLocal8Bit(root.readAll());
+		QRegExp include("\\\\include\\s*\\{([^}]+)\\}");
+		int pos = 0;
+		while ((pos = include.indexIn(text, pos)) >= 0) {
+			QString subdir = QFileInfo(include.cap(1).trimmed()).path();
+			if (subdir != "." && !QDir::isAbsolutePath(subdir) && !subdir.startsWith(".."))
+				dir.mkpath(subdir);
+			pos += include.matchedLength();
+		}
+	}
+	return true;
+}
+
+QStringList BuildDirectory::arguments(const QStringList& args) const
+{
+	QStringList result(args);
+	result.prepend("-output-directory=" + dirPath);
+	return result;
+}
+
+QStringList BuildDirectory::environment(const QStringList& env) const
+{
+	QStringList result(env);
+	result << "TEXMFOUTPUT=" + dirPath;
+	return result;
+}
+
+bool BuildDirectory::replaceFile(const QString& source, const QString& dest)
+{
+	// copy to a temporary name in the destination directory first, so the
+	// final step is a rename within one file system
+	QFileInfo destInfo(dest);
+	QString temp = destInfo.absolutePath() + "/." + destInfo.fileName() + ".tw-part";
+	QFile::remove(temp);
+	if (!QFile::copy(source, temp))
+		return false;
+#ifdef Q_WS_WIN
+	bool ok = MoveFileExW((LPCWSTR)QDir::toNativeSeparators(temp).utf16(), (LPCWSTR)QDir::toNativeSeparators(dest).utf16(),
+						  MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	bool ok = (rename(QFile::encodeName(temp).constData(), QFile::encodeName(dest).constData()) == 0);
+#endif
+	if (!ok)
+		QFile::remove(temp);
+	return ok;
+}
+
+bool BuildDirectory::commit(QString& error) const
+{
+	QFileInfo rootInfo(rootFilePath);
+	QString job = rootInfo.completeBaseName();
+	for (int i = 0; kCommittedSuffixes[i] != NULL; ++i) {
+		QFileInfo source(dirPath + "/" + job + kCommittedSuffixes[i]);
+		if (!source.exists())
+			continue;
+		QFileInfo dest(rootInfo.absolutePath() + "/" + job + kCommittedSuffixes[i]);
+		// unchanged since the last commit (e.g., the run failed early)
+		if (dest.exists() && dest.size() == source.size() && dest.lastModified() >= source.lastModified())
+			continue;
+		if (!replaceFile(source.absoluteFilePath(), dest.absoluteFilePath())) {
+			error = dest.absoluteFilePath();
+			return false;
+		}
+	}
+	return true;
+}
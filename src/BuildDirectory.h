@@ -0,0 +1,68 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#ifndef BuildDirectory_H
+#define BuildDirectory_H
+
+#include <QString>
+#include <QStringList>
+
+// A scratch output directory for typesetting a root file, preferably on a
+// RAM-backed file system. The engine is run with -output-directory pointing
+// there, so the many small writes of .aux, .log, .toc etc. don't go to the
+// (possibly network-mounted) source directory. The directory is kept between
+// runs, so auxiliary files carry over like they would next to the source;
+// only the PDF and the SyncTeX file are copied back, each replaced atomically
+// so the previewer never sees a partially written file.
+class BuildDirectory
+{
+public:
+	BuildDirectory(const QString& rootFile);
+
+	const QString& path() const { return dirPath; }
+
+	// create the directory and the subdirectories \include'd files write to
+	bool prepare();
+
+	QStringList arguments(const QStringList& args) const;
+	// lets helper tools (BibTeX, MakeIndex) write there in paranoid mode
+	QStringList environment(const QStringList& env) const;
+
+	// copy the SyncTeX file and the PDF next to the root file; on failure,
+	// error describes the file that couldn't be copied
+	bool commit(QString& error) const;
+
+	// the scratch directory used for a root file or its PDF
+	static QString pathFor(const QString& file);
+	// where all build directories live: a tmpfs if there is one; it is
+	// private to the user
+	static QString scratchRoot();
+
+private:
+	// remove the directories of jobs that haven't been built for a while
+	static void removeStaleDirectories(const QString& keep);
+	static bool replaceFile(const QString& source, const QString& dest);
+
+	QString rootFilePath;
+	QString dirPath;
+};
+
+#endif
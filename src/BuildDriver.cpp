@@ -0,0 +1,298 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#include "BuildDriver.h"
+#include "EngineResolver.h"
+#include "TWUtils.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QRegExp>
+#include <QSettings>
+#include <QDateTime>
+#include <QCryptographicHash>
+
+// the passes LaTeX may need to settle page numbers that depend on the
+// references themselves; anything beyond this won't converge
+const int kMaxLaTeXPasses = 5;
+
+static const char * const kAuxSuffixes[] = {
+	".aux", ".toc", ".lof", ".lot", ".out", ".nav", ".snm", ".loa", NULL
+};
+
+BuildDriver::BuildDriver(const QString& rootFile, const QString& program)
+	: rootFilePath(rootFile), latexProgram(program),
+	  current(LaTeXPass), rerunNeeded(false), latexPasses(0)
+{
+	QFileInfo fi(rootFile);
+	directory = fi.absolutePath();
+	outputDirectory = directory;
+	jobName = fi.completeBaseName();
+}
+
+void BuildDriver::setOutputDirectory(const QString& dir)
+{
+	outputDirectory = dir;
+}
+
+QString BuildDriver::auxPath(const QString& suffix) const
+{
+	return outputDirectory + "/" + jobName + suffix;
+}
+
+QStringList BuildDriver::auxFiles() const
+{
+	QStringList files;
+	for (int i = 0; kAuxSuffixes[i] != NULL; ++i)
+		files << auxPath(kAuxSuffixes[i]);
+
+	// \include'd files have aux files of their own
+	QFile aux(auxPath(".aux"));
+	if (aux.open(QIODevice::ReadOnly)) {
+		QRegExp input("\\\\@input\\{([^}]+)\\}");
+		QString text = QString::fromLatin1(aux.readAll());
+		int pos = 0;
+		while ((pos = input.indexIn(text, pos)) >= 0) {
+			files << QFileInfo(QDir(outputDirectory), input.cap(1)).absoluteFilePath();
+			pos += input.matchedLength();
+		}
+	}
+	return files;
+}
+
+QHash<QString, QByteArray> BuildDriver::snapshotAux() const
+{
+	QHash<QString, QByteArray> hashes;
+	foreach (const QString& path, auxFiles()) {
+		if (QFileInfo(path).exists())
+			hashes.insert(path, FileVersionDatabase::hashForFile(path));
+	}
+	return hashes;
+}
+
+// a file the tool reads besides the LaTeX output: name, size and time stamp
+static void addDatabase(QCryptographicHash& hash, const QFileInfo& fi)
+{
+	if (!fi.exists())
+		return;
+	hash.addData(fi.absoluteFilePath().toUtf8());
+	hash.addData(QByteArray::number(fi.size()));
+	hash.addData(QByteArray::number(fi.lastModified().toTime_t()));
+}
+
+QByteArray BuildDriver::bibtexInput() const
+{
+	// BibTeX only looks at the citation, database and style lines
+	QCryptographicHash hash(QCryptographicHash::Md5);
+	QStringList databases;
+	bool hasData = false;
+	foreach (const QString& path, auxFiles()) {
+		if (!path.endsWith(".aux"))
+			continue;
+		QFile aux(path);
+		if (!aux.open(QIODevice::ReadOnly))
+			continue;
+		while (!aux.atEnd()) {
+			QByteArray line = aux.readLine();
+			if (line.startsWith("\\citation{") || line.startsWith("\\bibstyle{"))
+				hash.addData(line);
+			else if (line.startsWith("\\bibdata{")) {
+				hash.addData(line);
+				hasData = true;
+				QString names = QString::fromLatin1(line.mid(9));
+				names.truncate(names.indexOf('}'));
+				databases << names.split(',', QString::SkipEmptyParts);
+			}
+		}
+	}
+	if (!hasData)
+		return QByteArray();
+	foreach (QString name, databases) {
+		name = name.trimmed();
+		if (!name.endsWith(".bib"))
+			name += ".bib";
+		addDatabase(hash, QFileInfo(QDir(directory), name));
+	}
+	return hash.result().toHex();
+}
+
+QByteArray BuildDriver::biberInput() const
+{
+	QFile bcf(auxPath(".bcf"));
+	if (!bcf.open(QIODevice::ReadOnly))
+		return QByteArray();
+	QByteArray control = bcf.readAll();
+	QCryptographicHash hash(QCryptographicHash::Md5);
+	hash.addData(control);
+	QRegExp source("<bcf:datasource[^>]*>([^<]+)</bcf:datasource>");
+	QString text = QString::fromUtf8(control);
+	int pos = 0;
+	while ((pos = source.indexIn(text, pos)) >= 0) {
+		addDatabase(hash, QFileInfo(QDir(directory), source.cap(1).trimmed()));
+		pos += source.matchedLength();
+	}
+	return hash.result().toHex();
+}
+
+QByteArray BuildDriver::makeindexInput() const
+{
+	if (!QFileInfo(auxPath(".idx")).exists())
+		return QByteArray();
+	return FileVersionDatabase::hashForFile(auxPath(".idx")).toHex();
+}
+
+QString BuildDriver::stateFile() const
+{
+	// anyone who could write there could make the driver skip passes
+	QString dir = TWUtils::cachePath("builds");
+	if (!TWUtils::makePrivateDirectory(dir))
+		return QString();
+	return dir + "/" + QCryptographicHash::hash(rootFilePath.toUtf8(), QCryptographicHash::Md5).toHex() + ".ini";
+}
+
+QString BuildDriver::toolKey(PassKind kind)
+{
+	switch (kind) {
+		case BibTeXPass:
+			return "bibtex";
+		case BiberPass:
+			return "biber";
+		case MakeIndexPass:
+			return "makeindex";
+		default:
+			return "latex";
+	}
+}
+
+QString BuildDriver::toolOutput(PassKind kind)
+{
+	return (kind == MakeIndexPass ? ".ind" : ".bbl");
+}
+
+void BuildDriver::queueTool(PassKind kind, const QByteArray& input)
+{
+	if (input.isEmpty())
+		return;
+	QString path = stateFile();
+	if (!path.isEmpty()) {
+		QSettings state(path, QSettings::IniFormat);
+		if (state.value(toolKey(kind)).toByteArray() == input && QFileInfo(auxPath(toolOutput(kind))).exists())
+			return;
+	}
+	Tool tool;
+	tool.kind = kind;
+	tool.input = input;
+	pendingTools << tool;
+}
+
+void BuildDriver::start(const QStringList& arguments)
+{
+	latexArguments = arguments;
+	auxSnapshot = snapshotAux();
+	totalTimer.start();
+	passTimer.start();
+}
+
+bool BuildDriver::passFinished(int exitCode, Pass& next)
+{
+	passTimes << qMakePair(current == LaTeXPass ? QFileInfo(latexProgram).completeBaseName() : toolKey(current),
+						   passTimer.elapsed());
+
+	if (current == LaTeXPass) {
+		++latexPasses;
+		// errors need the user's attention; further passes won't help
+		if (exitCode != 0)
+			return false;
+		QHash<QString, QByteArray> after = snapshotAux();
+		if (after != auxSnapshot) {
+			rerunNeeded = true;
+			rerunReason = QObject::tr("cross-references changed");
+		}
+		else
+			rerunNeeded = false;
+		auxSnapshot = after;
+
+		pendingTools.clear();
+		if (!biberInput().isEmpty())
+			queueTool(BiberPass, biberInput());
+		else
+			queueTool(BibTeXPass, bibtexInput());
+		queueTool(MakeIndexPass, makeindexInput());
+	}
+	else {
+		// BibTeX reports warnings with exit code 1
+		if (exitCode > (current == BibTeXPass ? 1 : 0))
+			return false;
+		QString path = stateFile();
+		if (!path.isEmpty()) {
+			QSettings state(path, QSettings::IniFormat);
+			state.setValue(toolKey(current), currentTool.input);
+		}
+		if (FileVersionDatabase::hashForFile(auxPath(toolOutput(current))) != outputBefore) {
+			rerunNeeded = true;
+			rerunReason = (current == MakeIndexPass ? QObject::tr("index changed") : QObject::tr("bibliography changed"));
+		}
+	}
+
+	while (!pendingTools.isEmpty()) {
+		currentTool = pendingTools.takeFirst();
+		QString name = toolKey(currentTool.kind);
+		QString program = EngineResolver::instance()->resolve(name);
+		if (program.isEmpty())
+			continue;
+		current = currentTool.kind;
+		outputBefore = FileVersionDatabase::hashForFile(auxPath(toolOutput(current)));
+		next.program = program;
+		// the tools write their output next to their input
+		if (current == BiberPass)
+			next.arguments = QStringList() << "--output-directory=" + outputDirectory << jobName;
+		else if (outputDirectory == directory)
+			next.arguments = QStringList(current == MakeIndexPass ? jobName + ".idx" : jobName);
+		else
+			next.arguments = QStringList(current == MakeIndexPass ? auxPath(".idx") : auxPath(QString()));
+		next.description = QObject::tr("Running %1 (input changed)").arg(name);
+		passTimer.restart();
+		return true;
+	}
+
+	if (rerunNeeded && latexPasses < kMaxLaTeXPasses) {
+		current = LaTeXPass;
+		rerunNeeded = false;
+		next.program = latexProgram;
+		next.arguments = latexArguments;
+		next.description = QObject::tr("Rerunning %1 (%2)").arg(QFileInfo(latexProgram).completeBaseName()).arg(rerunReason);
+		passTimer.restart();
+		return true;
+	}
+	return false;
+}
+
+QStringList BuildDriver::summary() const
+{
+	QStringList lines;
+	for (int i = 0; i < passTimes.count(); ++i)
+		lines << QObject::tr("Pass %1: %2 (%3 s)").arg(i + 1).arg(passTimes[i].first)
+				 .arg(passTimes[i].second / 1000.0, 0, 'f', 2);
+	lines << QObject::tr("Build finished after %1 pass(es) in %2 s").arg(passTimes.count())
+			 .arg(totalTimer.elapsed() / 1000.0, 0, 'f', 2);
+	return lines;
+}
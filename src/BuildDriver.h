@@ -0,0 +1,107 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#ifndef BuildDriver_H
+#define BuildDriver_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QTime>
+
+// Drives a complete LaTeX build for engines configured as build drivers.
+// After every LaTeX pass the auxiliary outputs (.aux, .toc, .out, ...) are
+// compared with their state before the pass; BibTeX, Biber and MakeIndex are
+// only run when their input (citations and databases, .bcf, .idx) differs
+// from the one they were last run on, and LaTeX is only rerun when some file
+// it reads back has changed. The input of the helper tools is remembered
+// between builds, so an incremental rebuild usually takes a single pass.
+class BuildDriver
+{
+public:
+	struct Pass {
+		QString program;
+		QStringList arguments;
+		QString description;
+	};
+
+	BuildDriver(const QString& rootFile, const QString& program);
+
+	// where LaTeX writes its auxiliary files, if not next to the root file
+	void setOutputDirectory(const QString& dir);
+
+	// called when the first LaTeX pass is started with the given arguments
+	void start(const QStringList& arguments);
+	// returns true and fills in next if another pass is required
+	bool passFinished(int exitCode, Pass& next);
+	// per-pass timings and the total, for the console
+	QStringList summary() const;
+
+private:
+	enum PassKind {
+		LaTeXPass,
+		BibTeXPass,
+		BiberPass,
+		MakeIndexPass
+	};
+
+	struct Tool {
+		PassKind kind;
+		QByteArray input;
+	};
+
+	QString auxPath(const QString& suffix) const;
+	QStringList auxFiles() const;
+	QHash<QString, QByteArray> snapshotAux() const;
+	QByteArray bibtexInput() const;
+	QByteArray biberInput() const;
+	QByteArray makeindexInput() const;
+	// empty if there is no private place for it; tools always run then
+	QString stateFile() const;
+	void queueTool(PassKind kind, const QByteArray& input);
+	static QString toolKey(PassKind kind);
+	static QString toolOutput(PassKind kind);
+
+	QString rootFilePath;
+	QString directory;
+	QString outputDirectory;
+	QString jobName;
+	QString latexProgram;
+	QStringList latexArguments;
+
+	PassKind current;
+	Tool currentTool;
+	QList<Tool> pendingTools;
+	QHash<QString, QByteArray> auxSnapshot;
+	QByteArray outputBefore;
+	bool rerunNeeded;
+	QString rerunReason;
+	int latexPasses;
+
+	QList< QPair<QString, int> > passTimes;
+	QTime passTimer;
+	QTime totalTimer;
+};
+
+#endif
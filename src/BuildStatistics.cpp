@@ -0,0 +1,313 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#include "BuildStatistics.h"
+#include "TWUtils.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+// history lines are tab-separated, in this order
+#define kHistoryFields "finished\tengine\twallMsecs\tcpuMsecs\tpeakRssKB\tpasses\tpages\tpdfSize\texitCode"
+
+const int kSampleInterval = 100;
+
+QMap<QString, QVariant> BuildRecord::toMap() const
+{
+	QMap<QString, QVariant> map;
+	map["finished"] = finished;
+	map["engine"] = engine;
+	map["wallMsecs"] = wallMsecs;
+	map["cpuMsecs"] = cpuMsecs;
+	map["peakRssKB"] = peakRssKB;
+	map["passes"] = passes;
+	map["pages"] = pages;
+	map["pdfSize"] = pdfSize;
+	map["exitCode"] = exitCode;
+	return map;
+}
+
+#pragma mark === BuildStatistics ===
+
+BuildStatistics *BuildStatistics::theInstance = NULL;
+
+BuildStatistics *BuildStatistics::instance()
+{
+	if (theInstance == NULL)
+		theInstance = new BuildStatistics(QCoreApplication::instance());
+	return theInstance;
+}
+
+BuildStatistics::BuildStatistics(QObject *parent)
+	: QObject(parent)
+{
+}
+
+BuildStatistics::~BuildStatistics()
+{
+	if (theInstance == this)
+		theInstance = NULL;
+}
+
+QString BuildStatistics::historyFile(const QString& rootFile)
+{
+	QString dir = TWUtils::cachePath("history");
+	if (!TWUtils::makePrivateDirectory(dir))
+		return QString();
+	return dir + "/" + QCryptographicHash::hash(rootFile.toUtf8(), QCryptographicHash::Md5).toHex() + ".txt";
+}
+
+void BuildStatistics::record(const QString& rootFile, const BuildRecord& build)
+{
+	session[rootFile] << build;
+
+	QString path = historyFile(rootFile);
+	QFile file(path);
+	bool isNew = !file.exists();
+	if (!path.isEmpty() && file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+		QTextStream out(&file);
+		out.setCodec("UTF-8");
+		if (isNew)
+			out << "# " << rootFile << "\n# " << kHistoryFields << "\n";
+		out << build.finished.toString(Qt::ISODate) << "\t" << build.engine << "\t"
+			<< build.wallMsecs << "\t" << build.cpuMsecs << "\t" << build.peakRssKB << "\t"
+			<< build.passes << "\t" << build.pages << "\t" << build.pdfSize << "\t"
+			<< build.exitCode << "\n";
+	}
+
+	emit buildRecorded(rootFile);
+}
+
+QList<BuildRecord> BuildStatistics::sessionRecords(const QString& rootFile) const
+{
+	return session.value(rootFile);
+}
+
+QList<BuildRecord> BuildStatistics::history(const QString& rootFile) const
+{
+	QList<BuildRecord> records;
+	QString path = historyFile(rootFile);
+	QFile file(path);
+	if (path.isEmpty() || !file.open(QIODevice::ReadOnly | QIODevice::Text))
+		return records;
+	QTextStream in(&file);
+	in.setCodec("UTF-8");
+	while (!in.atEnd()) {
+		QString line = in.readLine();
+		if (line.startsWith('#'))
+			continue;
+		QStringList fields = line.split('\t');
+		if (fields.count() < 9)
+			continue;
+		BuildRecord build;
+		build.finished = QDateTime::fromString(fields[0], Qt::ISODate);
+		build.engine = fields[1];
+		build.wallMsecs = fields[2].toInt();
+		build.cpuMsecs = fields[3].toInt();
+		build.peakRssKB = fields[4].toLongLong();
+		build.passes = fields[5].toInt();
+		build.pages = fields[6].toInt();
+		build.pdfSize = fields[7].toLongLong();
+		build.exitCode = fields[8].toInt();
+		records << build;
+	}
+	return records;
+}
+
+#pragma mark === ProcessMonitor ===
+
+#ifdef Q_OS_LINUX
+// utime and stime of pid, plus cutime and cstime (the programs it ran and
+// waited for) if withChildren is set; -1 if there is no such process.
+// The command name before them may contain spaces, so the fields are
+// counted from its closing parenthesis.
+static qint64 cpuTicks(qint64 pid, bool withChildren)
+{
+	QFile stat(QString("/proc/%1/stat").arg(pid));
+	if (!stat.open(QIODevice::ReadOnly))
+		return -1;
+	QByteArray line = stat.readAll();
+	QList<QByteArray> fields = line.mid(line.lastIndexOf(')') + 2).split(' ');
+	if (fields.count() <= 14)
+		return -1;
+	qint64 ticks = fields[11].toLongLong() + fields[12].toLongLong();
+	if (withChildren)
+		ticks += fields[13].toLongLong() + fields[14].toLongLong();
+	return ticks;
+}
+#endif
+
+// Blocks until a process has exited, without waiting for it in the sense of
+// waitpid(), so it stays a zombie and its final CPU time can still be read.
+class ProcessExitWatcher : public QThread
+{
+public:
+	ProcessExitWatcher(qint64 processId) : QThread(), pid(processId), ticks(-1) { }
+
+	// only valid once the thread has finished
+	qint64 exitTicks() const { return ticks; }
+
+protected:
+	virtual void run()
+	{
+#ifdef Q_OS_LINUX
+		siginfo_t info;
+		int result;
+		do
+			result = waitid(P_PID, (id_t)pid, &info, WEXITED | WNOWAIT);
+		while (result != 0 && errno == EINTR);
+		// fails if QProcess has already reaped the process
+		if (result == 0)
+			ticks = cpuTicks(pid, true);
+#endif
+	}
+
+private:
+	qint64 pid;
+	qint64 ticks;
+};
+
+ProcessMonitor::ProcessMonitor(QObject *parent)
+	: QObject(parent), process(NULL), processCount(0), finishedTicks(0), currentTicks(0), peakRss(-1)
+	, watcher(NULL), cpuTimeLost(false)
+{
+	timer.setInterval(kSampleInterval);
+	connect(&timer, SIGNAL(timeout()), this, SLOT(sample()));
+}
+
+ProcessMonitor::~ProcessMonitor()
+{
+	releaseWatcher();
+}
+
+void ProcessMonitor::releaseWatcher()
+{
+	if (watcher == NULL)
+		return;
+	// a watcher still waiting for its process is left to finish on its own
+	if (watcher->isRunning()) {
+		connect(watcher, SIGNAL(finished()), watcher, SLOT(deleteLater()));
+		if (!watcher->isRunning())
+			delete watcher;
+	}
+	else
+		delete watcher;
+	watcher = NULL;
+}
+
+void ProcessMonitor::watch(QProcess *p)
+{
+	if (process != NULL)
+		disconnect(process, 0, this, 0);
+	releaseWatcher();
+	process = p;
+	processCount = 0;
+	finishedTicks = 0;
+	currentTicks = 0;
+	peakRss = -1;
+	cpuTimeLost = false;
+	timer.stop();
+	if (process != NULL) {
+		connect(process, SIGNAL(started()), this, SLOT(processStarted()));
+		// connected before anyone who reads the results when the process is done
+		connect(process, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(processFinished()));
+	}
+}
+
+void ProcessMonitor::processStarted()
+{
+	releaseWatcher();
+	currentTicks = 0;
+	++processCount;
+#ifdef Q_OS_LINUX
+	watcher = new ProcessExitWatcher((qint64)process->pid());
+	watcher->start();
+	sample();
+	timer.start();
+#endif
+}
+
+void ProcessMonitor::processFinished()
+{
+	timer.stop();
+	currentTicks = 0;
+	if (watcher == NULL)
+		return;
+	// the process has been reaped by now, so the watcher is done or about to
+	// find that out
+	watcher->wait();
+	if (watcher->exitTicks() >= 0)
+		finishedTicks += watcher->exitTicks();
+	else
+		cpuTimeLost = true;
+	delete watcher;
+	watcher = NULL;
+}
+
+int ProcessMonitor::cpuMsecs() const
+{
+	qint64 msecs = -1;
+#ifdef Q_OS_LINUX
+	static const long ticksPerSecond = sysconf(_SC_CLK_TCK);
+	if (ticksPerSecond > 0 && !cpuTimeLost)
+		msecs = (finishedTicks + currentTicks) * 1000 / ticksPerSecond;
+#endif
+	return (int)msecs;
+}
+
+void ProcessMonitor::sample()
+{
+#ifdef Q_OS_LINUX
+	if (process == NULL || process->state() != QProcess::Running) {
+		timer.stop();
+		return;
+	}
+	qint64 ticks = cpuTicks((qint64)process->pid(), false);
+	if (ticks >= 0)
+		currentTicks = ticks;
+
+	// VmHWM is the peak resident set size, in kB
+	QFile status(QString("/proc/%1/status").arg((qint64)process->pid()));
+	if (status.open(QIODevice::ReadOnly)) {
+		while (!status.atEnd()) {
+			QByteArray line = status.readLine();
+			if (line.startsWith("VmHWM:")) {
+				qint64 rss = line.mid(6).trimmed().split(' ').first().toLongLong();
+				if (rss > peakRss)
+					peakRss = rss;
+				break;
+			}
+		}
+	}
+#endif
+}
@@ -0,0 +1,120 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#ifndef BuildStatistics_H
+#define BuildStatistics_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QHash>
+#include <QVariant>
+#include <QDateTime>
+#include <QTimer>
+#include <QProcess>
+
+// Performance record of one typesetting run (all passes of a build)
+struct BuildRecord {
+	QDateTime finished;
+	QString engine;
+	int wallMsecs;
+	int cpuMsecs;		// -1 if not available on this platform or not measured
+	qint64 peakRssKB;	// -1 if not available on this platform
+	int passes;
+	int pages;			// -1 if the engine didn't report it
+	qint64 pdfSize;		// -1 if there is no PDF
+	int exitCode;
+
+	QMap<QString, QVariant> toMap() const;
+};
+
+// Keeps the build records of the current session and appends every record
+// to a history file per root document (in the user's cache directory).
+class BuildStatistics : public QObject
+{
+	Q_OBJECT
+
+public:
+	static BuildStatistics *instance();
+
+	void record(const QString& rootFile, const BuildRecord& build);
+
+	QList<BuildRecord> sessionRecords(const QString& rootFile) const;
+	// everything recorded for rootFile, oldest first
+	QList<BuildRecord> history(const QString& rootFile) const;
+
+signals:
+	void buildRecorded(const QString& rootFile);
+
+private:
+	BuildStatistics(QObject *parent = NULL);
+	virtual ~BuildStatistics();
+
+	static QString historyFile(const QString& rootFile);
+
+	QHash<QString, QList<BuildRecord> > session;
+
+	static BuildStatistics *theInstance;
+};
+
+class ProcessExitWatcher;
+
+// Measures CPU time and peak resident set size of the processes started by
+// a QProcess from /proc (Linux only; elsewhere both stay unavailable).
+// A QProcess that is restarted for several passes is followed throughout.
+// The CPU time of a pass is read when it has exited but before QProcess
+// waits for it, so it covers all of the pass (and the programs it ran) but
+// no other process; if that moment is missed, the CPU time is unavailable.
+class ProcessMonitor : public QObject
+{
+	Q_OBJECT
+
+public:
+	ProcessMonitor(QObject *parent = NULL);
+	virtual ~ProcessMonitor();
+
+	// forget previous measurements and follow process
+	void watch(QProcess *process);
+
+	int passes() const { return processCount; }
+	int cpuMsecs() const;
+	qint64 peakRssKB() const { return peakRss; }
+
+private slots:
+	void processStarted();
+	void processFinished();
+	void sample();
+
+private:
+	void releaseWatcher();
+
+	QProcess *process;
+	QTimer timer;
+	int processCount;
+	qint64 finishedTicks;	// CPU time of the processes that have exited
+	qint64 currentTicks;	// last sample of the running process
+	qint64 peakRss;
+	ProcessExitWatcher *watcher;	// of the running pass
+	bool cpuTimeLost;	// a pass exited without its CPU time being read
+};
+
+#endif
@@ -22,14 +22,13 @@
 #include "CompletingEdit.h"
 #include "TWUtils.h"
 #include "TWApp.h"
+#include "DelimiterIndex.h"
+#include "CompletionStore.h"
 
-#include <QCompleter>
 #include <QKeyEvent>
 #include <QAbstractItemView>
 #include <QApplication>
 #include <QModelIndex>
-#include <QStandardItem>
-#include <QStandardItemModel>
 #include <QTextCursor>
 #include <QFileInfo>
 #include <QFile>
@@ -51,17 +50,15 @@ CompletingEdit::CompletingEdit(QWidget *parent)
 	  clickCount(0),
 	  autoIndentMode(-1), prefixLength(0),
 	  smartQuotesMode(-1),
-	  c(NULL), cmpCursor(QTextCursor()),
+	  cmpCursor(QTextCursor()), completionRow(-1),
 	  pHunspell(NULL), spellingCodec(NULL)
 {
-	if (sharedCompleter == NULL) { // initialize shared (static) members
+	if (currentCompletionFormat == NULL) { // initialize shared (static) members
 		qreal bgR, bgG, bgB;
 		qreal fgR, fgG, fgB;
 		
-		sharedCompleter = new QCompleter(qApp);
-		sharedCompleter->setCompletionMode(QCompleter::InlineCompletion);
-		sharedCompleter->setCaseSensitivity(Qt::CaseInsensitive);
-		loadCompletionFiles(sharedCompleter);
+		// starts loading the completion files in the background
+		CompletionStore::instance();
 
 		palette().color(QPalette::Active, QPalette::Base).getRgbF(&bgR, &bgG, &bgB);
 		palette().color(QPalette::Active, QPalette::Text).getRgbF(&fgR, &fgG, &fgB);
@@ -87,6 +84,8 @@ CompletingEdit::CompletingEdit(QWidget *parent)
 	connect(this, SIGNAL(selectionChanged()), this, SLOT(cursorPositionChangedSlot()));
 
 	lineNumberArea = new LineNumberArea(this);
+	delimiters = new DelimiterIndex(document());
+	new CompletionHarvester(document());
 	
 	connect(document(), SIGNAL(blockCountChanged(int)), this, SLOT(updateLineNumberAreaWidth(int)));
 	connect(this, SIGNAL(updateRequest(const QRect&, int)), this, SLOT(updateLineNumberArea(const QRect&, int)));
@@ -100,21 +99,21 @@ CompletingEdit::CompletingEdit(QWidget *parent)
 
 CompletingEdit::~CompletingEdit()
 {
-	setCompleter(NULL);
+	endCompletion();
 }
 
-void CompletingEdit::setCompleter(QCompleter *completer)
+void CompletingEdit::endCompletion()
 {
-	c = completer;
-	if (!c)
-		return;
-
-	c->setWidget(this);
+	// leaving a completion in place counts as using it
+	if (completionRow >= 0 && completionRow < completions.count())
+		CompletionStore::instance()->recordUse(completions[completionRow]);
+	completions.clear();
+	completionRow = -1;
 }
 
 void CompletingEdit::cursorPositionChangedSlot()
 {
-	setCompleter(NULL);
+	endCompletion();
 	if (!currentCompletionRange.isNull()) {
 		QTextCursor curs = textCursor();
 		currentCompletionRange = QTextCursor();
@@ -353,18 +352,16 @@ QTextCursor CompletingEdit::wordSelectionForPos(const QPoint& mousePos)
 		// don't test because the rect will be zero width (see above)!
 		//		r = cursorRect(cursor);
 		//		if (r.contains(pos)) {
-		const QString plainText = toPlainText();
-		QChar curChr = plainText[cursorPos];
-		QChar c;
-		if ((c = TWUtils::closerMatching(curChr)) != 0) {
-			int balancePos = TWUtils::balanceDelim(plainText, cursorPos + 1, c, 1);
+		QChar curChr = document()->characterAt(cursorPos);
+		if (TWUtils::closerMatching(curChr) != 0) {
+			int balancePos = delimiters->matchingDelim(cursorPos);
 			if (balancePos < 0)
 				QApplication::beep();
 			else
 				cursor.setPosition(balancePos + 1, QTextCursor::KeepAnchor);
 				}
-		else if ((c = TWUtils::openerMatching(curChr)) != 0) {
-			int balancePos = TWUtils::balanceDelim(plainText, cursorPos - 1, c, -1);
+		else if (TWUtils::openerMatching(curChr) != 0) {
+			int balancePos = delimiters->matchingDelim(cursorPos);
 			if (balancePos < 0)
 				QApplication::beep();
 			else {
@@ -413,8 +410,6 @@ void CompletingEdit::timerEvent(QTimerEvent *e)
 	
 void CompletingEdit::focusInEvent(QFocusEvent *e)
 {
-	if (c)
-		c->setWidget(this);
 	QTextEdit::focusInEvent(e);
 }
 
@@ -521,13 +516,10 @@ void CompletingEdit::handleOtherKey(QKeyEvent *e)
 			if (cursor.selectionStart() == pos + 1 || cursor.selectionStart() == pos - 1) {
 				if (cursor.selectionStart() == pos - 1) // we moved backward, set pos to look at the char we just passed over
 					--pos;
-				const QString text = document()->toPlainText();
 				int match = -2;
-				QChar c;
-				if (pos > 0 && pos < text.length() && (c = TWUtils::openerMatching(text[pos])) != 0)
-					match = TWUtils::balanceDelim(text, pos - 1, c, -1);
-				else if (pos < text.length() - 1 && (c = TWUtils::closerMatching(text[pos])) != 0)
-					match = TWUtils::balanceDelim(text, pos + 1, c, 1);
+				QChar c = document()->characterAt(pos);
+				if (pos >= 0 && (TWUtils::openerMatching(c) != 0 || TWUtils::closerMatching(c) != 0))
+					match = delimiters->matchingDelim(pos);
 				if (match >= 0) {
 					QList<ExtraSelection> selList = extraSelections();
 					ExtraSelection	sel;
@@ -606,32 +598,36 @@ void CompletingEdit::maybeSmartenQuote(int offset)
 	const QuoteMapping& mappings = quotesModes->at(smartQuotesMode).mappings;
 	QString replacement;
 
-	const QString& text = document()->toPlainText();
-	if (offset < 0 || offset >= text.length())
+	// only the line being typed in is needed, not the whole document
+	const QTextBlock block = document()->findBlock(offset);
+	if (!block.isValid())
+		return;
+	const QString text = block.text();
+	int i = offset - block.position();
+	if (i < 0 || i >= text.length())
 		return;
-	QTextCursor cursor(document());
-	cursor.setPosition(offset);
-	cursor.setPosition(offset + 1, QTextCursor::KeepAnchor);
 
-	QChar keyChar = cursor.selectedText()[0];
-	QuoteMapping::const_iterator iter = mappings.find(keyChar);
+	QuoteMapping::const_iterator iter = mappings.find(text[i]);
 	if (iter == mappings.end())
 		return;
 	
 	replacement = iter.value().second;
-	if (offset == 0) {
-		// always use opening quotes at the beginning of the document
+	if (i == 0) {
+		// always use opening quotes at the beginning of a line (or the document)
 		replacement = iter.value().first;
 	}
 	else {
-		if (text[offset - 1].isSpace())
+		if (text[i - 1].isSpace())
 			replacement = iter.value().first;
 		
 		// after opening brackets, also use opening quotes
-		if (text[offset - 1] == '{' || text[offset - 1] == '[' || text[offset - 1] == '(')
+		if (text[i - 1] == '{' || text[i - 1] == '[' || text[i - 1] == '(')
 			replacement = iter.value().first;
 	}
 	
+	QTextCursor cursor(document());
+	cursor.setPosition(offset);
+	cursor.setPosition(offset + 1, QTextCursor::KeepAnchor);
 	cursor.insertText(replacement);
 }
 
@@ -641,15 +637,22 @@ void CompletingEdit::smartenQuotes()
 		return;
 	const QuoteMapping& mappings = quotesModes->at(smartQuotesMode).mappings;
 
-	const QString& text = document()->toPlainText();
-
 	QTextCursor curs = textCursor();
 	int selStart = curs.selectionStart();
 	int selEnd = curs.selectionEnd();
+
+	// the selection and the character before it; line breaks come out as
+	// QChar::ParagraphSeparator, which counts as space
+	int textStart = qMax(selStart - 1, 0);
+	QTextCursor range(document());
+	range.setPosition(textStart);
+	range.setPosition(selEnd, QTextCursor::KeepAnchor);
+	const QString text = range.selectedText();
+
 	bool changed = false;
 	for (int offset = selEnd; offset > selStart; ) {
 		--offset;
-		QChar ch = text[offset];
+		QChar ch = text[offset - textStart];
 		QuoteMapping::const_iterator iter = mappings.find(ch);
 		if (iter == mappings.end())
 			continue;
@@ -660,7 +663,7 @@ void CompletingEdit::smartenQuotes()
 		}
 		curs.setPosition(offset, QTextCursor::MoveAnchor);
 		curs.setPosition(offset + 1, QTextCursor::KeepAnchor);
-		const QString& replacement((offset == 0 || text[offset - 1].isSpace()) ?
+		const QString& replacement((offset == 0 || text[offset - 1 - textStart].isSpace()) ?
 								   iter.value().first : iter.value().second);
 		curs.insertText(replacement);
 		selEnd += replacement.length() - 1;
@@ -703,7 +706,7 @@ void CompletingEdit::handleCompletionShortcut(QKeyEvent *e)
 			atLineStart = true;
 	}
 	
-	if (c == NULL && !atLineStart) {
+	if (completions.isEmpty() && !atLineStart) {
 		cmpCursor = textCursor();
 		if (!selectWord(cmpCursor) && textCursor().selectionStart() > 0) {
 			cmpCursor.setPosition(textCursor().selectionStart() - 1);
@@ -738,22 +741,20 @@ void CompletingEdit::handleCompletionShortcut(QKeyEvent *e)
 		}
 		
 		while (1) {
-			QString completionPrefix = cmpCursor.selectedText();
-			if (completionPrefix != "") {
-				setCompleter(sharedCompleter);
-				c->setCompletionPrefix(completionPrefix);
-				if (c->completionCount() == 0) {
+			QString prefix = cmpCursor.selectedText();
+			if (prefix != "") {
+				completions = CompletionStore::instance()->candidates(prefix);
+				if (completions.isEmpty()) {
 					if (cmpCursor.selectionStart() < start) {
 						// we must have included a preceding brace or hyphen; now try without it
 						cmpCursor.setPosition(start);
 						cmpCursor.setPosition(end, QTextCursor::KeepAnchor);
 						continue;
 					}
-					setCompleter(NULL);
 				}
 				else {
-					if (e->modifiers() == Qt::ShiftModifier)
-						c->setCurrentRow(c->completionCount() - 1);
+					completionPrefix = prefix;
+					completionRow = (e->modifiers() == Qt::ShiftModifier) ? completions.count() - 1 : 0;
 					showCurrentCompletion();
 					return;
 				}
@@ -762,24 +763,26 @@ void CompletingEdit::handleCompletionShortcut(QKeyEvent *e)
 		}
 	}
 	
-	if (c != NULL && c->completionCount() > 0) {
+	if (!completions.isEmpty()) {
 		if (e->modifiers() == Qt::ShiftModifier)  {
-			if (c->currentRow() == 0) {
-				showCompletion(c->completionPrefix());
-				setCompleter(NULL);
+			if (completionRow == 0) {
+				completionRow = -1;
+				showCompletion(completionPrefix);
+				endCompletion();
 			}
 			else {
-				c->setCurrentRow(c->currentRow() - 1);
+				--completionRow;
 				showCurrentCompletion();
 			}
 		}
 		else {
-			if (c->currentRow() == c->completionCount() - 1) {
-				showCompletion(c->completionPrefix());
-				setCompleter(NULL);
+			if (completionRow == completions.count() - 1) {
+				completionRow = -1;
+				showCompletion(completionPrefix);
+				endCompletion();
 			}
 			else {
-				c->setCurrentRow(c->currentRow() + 1);
+				++completionRow;
 				showCurrentCompletion();
 			}
 		}
@@ -793,13 +796,10 @@ void CompletingEdit::showCompletion(const QString& completion, int insOffset)
 {
 	disconnect(this, SIGNAL(cursorPositionChanged()), this, SLOT(cursorPositionChangedSlot()));
 
-	if (c->widget() != this)
-		return;
-
 	QTextCursor tc = cmpCursor;
 	if (tc.isNull()) {
 		tc = textCursor();
-		tc.movePosition(QTextCursor::Left, QTextCursor::KeepAnchor, c->completionPrefix().length());
+		tc.movePosition(QTextCursor::Left, QTextCursor::KeepAnchor, completionPrefix.length());
 	}
 
 	tc.insertText(completion);
@@ -818,34 +818,10 @@ void CompletingEdit::showCompletion(const QString& completion, int insOffset)
 
 void CompletingEdit::showCurrentCompletion()
 {
-	if (c->widget() != this)
+	if (completionRow < 0 || completionRow >= completions.count())
 		return;
 
-	QStandardItemModel *model = qobject_cast<QStandardItemModel*>(c->model());
-	QList<QStandardItem*> items = model->findItems(c->currentCompletion());
-
-	if (items.count() > 1) {
-		if (c->currentCompletion() == prevCompletion) {
-			if (c->currentIndex().row() > prevRow)
-				++itemIndex;
-			else
-				--itemIndex;
-			if (itemIndex < 0)
-				itemIndex = items.count() - 1;
-			else if (itemIndex > items.count() - 1)
-				itemIndex = 0;
-		}
-		else
-			itemIndex = 0;
-		prevRow = c->currentIndex().row();
-		prevCompletion = c->currentCompletion();
-	}
-	else {
-		prevCompletion = QString();
-		itemIndex = 0;
-	}
-
-	QString completion = model->item(items[itemIndex]->row(), 1)->text();
+	QString completion = completions[completionRow].expansion;
 	
 	int insOffset = completion.indexOf("#INS#");
 	if (insOffset != -1)
@@ -854,48 +830,6 @@ void CompletingEdit::showCurrentCompletion()
 	showCompletion(completion, insOffset);
 }
 
-void CompletingEdit::loadCompletionsFromFile(QStandardItemModel *model, const QString& filename)
-{
-	QFile	completionFile(filename);
-	if (completionFile.exists() && completionFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-		QTextStream in(&completionFile);
-		in.setCodec("UTF-8");
-		in.setAutoDetectUnicode(true);
-		QList<QStandardItem*> row;
-		while (1) {
-			QString	line = in.readLine();
-			if (line.isNull())
-				break;
-			if (line[0] == '%')
-				continue;
-			line.replace("#RET#", "\n");
-			QStringList parts = line.split(":=");
-			if (parts.count() > 2)
-				continue;
-			if (parts.count() == 1)
-				parts.append(parts[0]);
-			parts[0].replace("#INS#", "");
-			row.append(new QStandardItem(parts[0]));
-			row.append(new QStandardItem(parts[1]));
-			model->appendRow(row);
-			row.clear();
-		}
-		completionFile.close();
-	}
-}
-
-void CompletingEdit::loadCompletionFiles(QCompleter *theCompleter)
-{
-	QStandardItemModel *model = new QStandardItemModel(0, 2, theCompleter); // columns are abbrev, expansion
-
-	QDir completionDir(TWUtils::getLibraryPath("completion"));
-	foreach (QFileInfo fileInfo, completionDir.entryInfoList(QDir::Files | QDir::Readable, QDir::Name)) {
-		loadCompletionsFromFile(model, fileInfo.canonicalFilePath());
-	}
-
-	theCompleter->setModel(model);
-}
-
 void CompletingEdit::jumpToPdf()
 {
 	QAction *act = qobject_cast<QAction*>(sender());
@@ -1182,7 +1116,6 @@ QTextCharFormat	*CompletingEdit::currentLineFormat = NULL;
 bool CompletingEdit::highlightCurrentLine = true;
 bool CompletingEdit::autocompleteEnabled = true;
 
-QCompleter	*CompletingEdit::sharedCompleter = NULL;
 
 QList<CompletingEdit::IndentMode> *CompletingEdit::indentModes = NULL;
 QList<CompletingEdit::QuotesMode> *CompletingEdit::quotesModes = NULL;
@@ -28,9 +28,10 @@
 
 #include <hunspell.h>
 
-class QCompleter;
-class QStandardItemModel;
+#include "CompletionStore.h"
+
 class QTextCodec;
+class DelimiterIndex;
 
 class CompletingEdit : public QTextEdit
 {
@@ -50,6 +51,8 @@ public:
 
 	bool getLineNumbersVisible() const { return lineNumberArea->isVisible(); }
 
+	DelimiterIndex *delimiterIndex() const { return delimiters; }
+
 	QString getIndentMode() const {
 		return autoIndentMode >= 0 && autoIndentMode < autoIndentModes().size() ?
 			autoIndentModes().at(autoIndentMode) : QString();
@@ -103,14 +106,11 @@ private slots:
 	void updateLineNumberArea(const QRect&, int);
 	
 private:
-	void setCompleter(QCompleter *c);
+	void endCompletion();
 
 	void showCompletion(const QString& completion, int insOffset = -1);
 	void showCurrentCompletion();
 
-	void loadCompletionsFromFile(QStandardItemModel *model, const QString& filename);
-	void loadCompletionFiles(QCompleter *theCompleter);
-
 	void handleCompletionShortcut(QKeyEvent *e);
 	void handleReturn(QKeyEvent *e);
 	void handleBackspace(QKeyEvent *e);
@@ -162,12 +162,11 @@ private:
 	
 	int smartQuotesMode;
 
-	QCompleter *c;
 	QTextCursor cmpCursor;
 
-	QString prevCompletion; // used with multiple entries for the same key (e.g., "--")
-	int itemIndex;
-	int prevRow;
+	QList<CompletionStore::Candidate> completions; // empty unless we're completing
+	QString completionPrefix;
+	int completionRow; // index of the completion shown, or -1 for the prefix
 
 	QTextCursor currentWord;
 	Hunhandle *pHunspell;
@@ -176,13 +175,12 @@ private:
 	QTextCursor	currentCompletionRange;
 
 	QWidget *lineNumberArea;
+	DelimiterIndex *delimiters;
 
 	static QTextCharFormat	*currentCompletionFormat;
 	static QTextCharFormat	*braceMatchingFormat;
 	static QTextCharFormat	*currentLineFormat;
 	
-	static QCompleter	*sharedCompleter;
-	
 	static bool highlightCurrentLine;
 	static bool autocompleteEnabled;
 };
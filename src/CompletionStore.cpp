@@ -0,0 +1,333 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#include "CompletionStore.h"
+#include "TeXBlockData.h"
+#include "TWUtils.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QTime>
+#include <QSet>
+
+const int kMinHarvestedWordLength = 5;
+const int kHarvestDelay = 1000; // msec of idle time before harvesting edits
+const int kHarvestSlice = 20; // max msec spent harvesting at a time
+
+CompletionStore *CompletionStore::theInstance = NULL;
+
+CompletionStore *CompletionStore::instance()
+{
+	if (theInstance == NULL)
+		theInstance = new CompletionStore(QCoreApplication::instance());
+	return theInstance;
+}
+
+CompletionStore::CompletionStore(QObject *parent)
+	: QObject(parent), loaded(false)
+{
+	loader = new CompletionLoader(TWUtils::getLibraryPath("completion"), this);
+	connect(loader, SIGNAL(finished()), this, SLOT(loaderFinished()));
+	loader->start(QThread::LowPriority);
+}
+
+CompletionStore::~CompletionStore()
+{
+	if (loader)
+		loader->wait();
+	if (theInstance == this)
+		theInstance = NULL;
+}
+
+void CompletionStore::loaderFinished()
+{
+	if (loaded || loader == NULL)
+		return;
+	entries = loader->entries;
+	loaded = true;
+	loader->deleteLater();
+	loader = NULL;
+}
+
+void CompletionStore::waitForEntries()
+{
+	// only happens if completion is requested right after startup
+	if (!loaded && loader) {
+		loader->wait();
+		loaderFinished();
+	}
+}
+
+static bool entryLessThanKey(const CompletionStore::Entry& entry, const QString& key)
+{
+	return entry.lowerKey < key;
+}
+
+static QString usageKey(const QString& key, const QString& expansion)
+{
+	return key + QChar('\n') + expansion;
+}
+
+int CompletionStore::useCount(const QString& key, const QString& expansion) const
+{
+	return uses.value(usageKey(key, expansion), 0);
+}
+
+struct RankedCandidate {
+	CompletionStore::Candidate candidate;
+	int uses;
+	int group;	// 0 for completion file entries, 1 for document words
+	int rank;	// file order, or negated number of occurrences
+};
+
+static bool rankedLessThan(const RankedCandidate& a, const RankedCandidate& b)
+{
+	if (a.uses != b.uses)
+		return a.uses > b.uses;
+	if (a.group != b.group)
+		return a.group < b.group;
+	return a.rank < b.rank;
+}
+
+QList<CompletionStore::Candidate> CompletionStore::candidates(const QString& prefix)
+{
+	waitForEntries();
+
+	QString lowerPrefix = prefix.toLower();
+	QList<RankedCandidate> ranked;
+	QSet<QString> expansions;
+
+	QVector<Entry>::const_iterator it = qLowerBound(entries.constBegin(), entries.constEnd(), lowerPrefix, entryLessThanKey);
+	for ( ; it != entries.constEnd() && it->lowerKey.startsWith(lowerPrefix); ++it) {
+		RankedCandidate rc;
+		rc.candidate.key = it->key;
+		rc.candidate.expansion = it->expansion;
+		rc.uses = useCount(it->key, it->expansion);
+		rc.group = 0;
+		rc.rank = it->order;
+		ranked.append(rc);
+		expansions.insert(it->expansion);
+	}
+
+	QMap<QString, int>::const_iterator w = documentWords.lowerBound(lowerPrefix);
+	for ( ; w != documentWords.constEnd() && w.key().startsWith(lowerPrefix); ++w) {
+		QString word = w.key().mid(w.key().indexOf(QChar('\n')) + 1);
+		// don't offer what is already there, or what the files provide anyway
+		if (word == prefix || expansions.contains(word))
+			continue;
+		RankedCandidate rc;
+		rc.candidate.key = word;
+		rc.candidate.expansion = word;
+		rc.uses = useCount(word, word);
+		rc.group = 1;
+		rc.rank = -w.value();
+		ranked.append(rc);
+	}
+
+	qStableSort(ranked.begin(), ranked.end(), rankedLessThan);
+
+	QList<Candidate> result;
+	foreach (const RankedCandidate& rc, ranked)
+		result.append(rc.candidate);
+	return result;
+}
+
+void CompletionStore::recordUse(const Candidate& candidate)
+{
+	++uses[usageKey(candidate.key, candidate.expansion)];
+}
+
+void CompletionStore::addWords(const QStringList& words)
+{
+	foreach (const QString& word, words)
+		++documentWords[word.toLower() + QChar('\n') + word];
+}
+
+void CompletionStore::removeWords(const QStringList& words)
+{
+	foreach (const QString& word, words) {
+		QMap<QString, int>::iterator it = documentWords.find(word.toLower() + QChar('\n') + word);
+		if (it != documentWords.end() && --it.value() <= 0)
+			documentWords.erase(it);
+	}
+}
+
+QStringList CompletionStore::harvestWords(const QString& text)
+{
+	QStringList result;
+	int len = text.length();
+	int i = 0;
+	while (i < len) {
+		QChar ch = text[i];
+		if (ch == '\\') {
+			int j = i + 1;
+			while (j < len && (text[j].isLetter() || text[j] == '@'))
+				++j;
+			if (j == i + 1) {
+				// control symbol such as \% or \; skip it
+				i += 2;
+				continue;
+			}
+			QString cs = text.mid(i, j - i);
+			if (cs.length() > 2)
+				result << cs;
+			if (cs == "\\label" && j < len && text[j] == '{') {
+				int close = text.indexOf('}', j + 1);
+				if (close > j + 1) {
+					result << text.mid(j + 1, close - j - 1);
+					j = close + 1;
+				}
+			}
+			i = j;
+			continue;
+		}
+		if (ch.isLetter()) {
+			int j = i + 1;
+			while (j < len && (text[j].isLetter() || text[j].isMark()))
+				++j;
+			if (j - i >= kMinHarvestedWordLength)
+				result << text.mid(i, j - i);
+			i = j;
+			continue;
+		}
+		++i;
+	}
+	return result;
+}
+
+#pragma mark === CompletionLoader ===
+
+static bool entryLessThan(const CompletionStore::Entry& a, const CompletionStore::Entry& b)
+{
+	if (a.lowerKey != b.lowerKey)
+		return a.lowerKey < b.lowerKey;
+	return a.order < b.order;
+}
+
+void CompletionLoader::run()
+{
+	QDir completionDir(dirPath);
+	foreach (QFileInfo fileInfo, completionDir.entryInfoList(QDir::Files | QDir::Readable, QDir::Name))
+		loadFile(fileInfo.canonicalFilePath());
+	qSort(entries.begin(), entries.end(), entryLessThan);
+	entries.squeeze();
+}
+
+void CompletionLoader::loadFile(const QString& filename)
+{
+	QFile	completionFile(filename);
+	if (completionFile.exists() && completionFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+		QTextStream in(&completionFile);
+		in.setCodec("UTF-8");
+		in.setAutoDetectUnicode(true);
+		while (1) {
+			QString	line = in.readLine();
+			if (line.isNull())
+				break;
+			if (line[0] == '%')
+				continue;
+			line.replace("#RET#", "\n");
+			QStringList parts = line.split(":=");
+			if (parts.count() > 2)
+				continue;
+			if (parts.count() == 1)
+				parts.append(parts[0]);
+			parts[0].replace("#INS#", "");
+			CompletionStore::Entry entry;
+			entry.key = parts[0];
+			entry.lowerKey = parts[0].toLower();
+			entry.expansion = parts[1];
+			entry.order = entries.count();
+			entries.append(entry);
+		}
+		completionFile.close();
+	}
+}
+
+#pragma mark === CompletionHarvester ===
+
+CompletionHarvester::CompletionHarvester(QTextDocument *doc)
+	: QObject(doc), doc(doc)
+{
+	timer.setSingleShot(true);
+	connect(&timer, SIGNAL(timeout()), this, SLOT(harvest()));
+	connect(doc, SIGNAL(contentsChange(int, int, int)), this, SLOT(contentsChange(int, int, int)));
+}
+
+CompletionHarvester::~CompletionHarvester()
+{
+}
+
+void CompletionHarvester::contentsChange(int position, int charsRemoved, int charsAdded)
+{
+	Q_UNUSED(charsRemoved)
+
+	int end = qMin(position + charsAdded, doc->characterCount() - 1);
+	// typing usually extends the most recent range; avoid piling up cursors
+	if (!dirtyRanges.isEmpty()) {
+		QTextCursor& last = dirtyRanges.last();
+		if (last.selectionStart() <= position && position <= last.selectionEnd() + 1) {
+			if (end > last.selectionEnd()) {
+				int start = last.selectionStart();
+				last.setPosition(start);
+				last.setPosition(end, QTextCursor::KeepAnchor);
+			}
+			timer.start(kHarvestDelay);
+			return;
+		}
+	}
+	QTextCursor range(doc);
+	range.setPosition(position);
+	range.setPosition(end, QTextCursor::KeepAnchor);
+	dirtyRanges.append(range);
+	timer.start(kHarvestDelay);
+}
+
+void CompletionHarvester::harvest()
+{
+	QTime time;
+	time.start();
+	while (!dirtyRanges.isEmpty()) {
+		QTextCursor& range = dirtyRanges.first();
+		int end = range.selectionEnd();
+		QTextBlock block = doc->findBlock(range.selectionStart());
+		QTextBlock last = doc->findBlock(end);
+		while (block.isValid()) {
+			TeXBlockData::forBlock(block)->setHarvestedWords(CompletionStore::harvestWords(block.text()));
+			if (block == last)
+				break;
+			block = block.next();
+			if (time.elapsed() > kHarvestSlice) {
+				// continue with the remaining blocks in the next slice
+				range.setPosition(block.position());
+				range.setPosition(qMax(end, block.position()), QTextCursor::KeepAnchor);
+				timer.start(0);
+				return;
+			}
+		}
+		dirtyRanges.removeFirst();
+	}
+}
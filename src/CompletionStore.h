@@ -0,0 +1,141 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#ifndef CompletionStore_H
+#define CompletionStore_H
+
+#include <QObject>
+#include <QThread>
+#include <QVector>
+#include <QHash>
+#include <QMap>
+#include <QList>
+#include <QStringList>
+#include <QTextCursor>
+#include <QTimer>
+
+class QTextDocument;
+class CompletionLoader;
+
+// Shared completion data for all editor windows: the entries from the
+// completion files (sorted by lower-cased key, so all entries with a given
+// prefix form one contiguous range), plus words, labels and control
+// sequences harvested from the open documents.
+// The completion files are read on a worker thread the first time the
+// store is used.
+class CompletionStore : public QObject
+{
+	Q_OBJECT
+
+public:
+	struct Entry {
+		QString key;		// the abbreviation as typed
+		QString lowerKey;	// key.toLower(), used for ordering and lookup
+		QString expansion;
+		int order;			// position in the completion files
+	};
+
+	struct Candidate {
+		QString key;
+		QString expansion;
+	};
+
+	static CompletionStore *instance();
+	static CompletionStore *existingInstance() { return theInstance; }
+
+	// all candidates whose key starts with prefix (case-insensitively),
+	// most frequently used first
+	QList<Candidate> candidates(const QString& prefix);
+
+	// called when a completion has been accepted, for ranking
+	void recordUse(const Candidate& candidate);
+
+	// reference-counted words harvested from the documents
+	void addWords(const QStringList& words);
+	void removeWords(const QStringList& words);
+
+	// extract the words, labels and control sequences of a line of text
+	static QStringList harvestWords(const QString& text);
+
+private slots:
+	void loaderFinished();
+
+private:
+	CompletionStore(QObject *parent = NULL);
+	virtual ~CompletionStore();
+
+	void waitForEntries();
+	int useCount(const QString& key, const QString& expansion) const;
+
+	QVector<Entry> entries;
+	bool loaded;
+	CompletionLoader *loader;
+
+	// keys are lowercased word + '\n' + word, so a prefix lookup is a range
+	QMap<QString, int> documentWords;
+	QHash<QString, int> uses;
+
+	static CompletionStore *theInstance;
+};
+
+// Reads and sorts the completion files; runs on its own thread
+class CompletionLoader : public QThread
+{
+	Q_OBJECT
+
+public:
+	CompletionLoader(const QString& dirPath, QObject *parent = NULL)
+		: QThread(parent), dirPath(dirPath) { }
+
+	QVector<CompletionStore::Entry> entries;
+
+protected:
+	virtual void run();
+
+private:
+	void loadFile(const QString& filename);
+
+	QString dirPath;
+};
+
+// Keeps the words of one document in the CompletionStore up to date. Edited
+// blocks are collected and re-harvested when the user pauses typing, in
+// small time slices so that loading a large file doesn't block the editor.
+class CompletionHarvester : public QObject
+{
+	Q_OBJECT
+
+public:
+	CompletionHarvester(QTextDocument *doc);
+	virtual ~CompletionHarvester();
+
+private slots:
+	void contentsChange(int position, int charsRemoved, int charsAdded);
+	void harvest();
+
+private:
+	QTextDocument *doc;
+	// cursors adjust to later edits, so they keep track of the dirty ranges
+	QList<QTextCursor> dirtyRanges;
+	QTimer timer;
+};
+
+#endif
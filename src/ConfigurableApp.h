@@ -25,16 +25,23 @@
 #include <QApplication>
 #include <QSettings>
 
+#include "SettingsStore.h"
+
+// the preferences file itself; everything but SettingsStore should use QSETTINGS_OBJECT
 #ifdef Q_WS_MAC
-#define QSETTINGS_OBJECT(s) \
+#define QSETTINGS_BACKEND(s) \
 			QSettings s(ConfigurableApp::instance()->getSettingsFormat(), QSettings::UserScope, \
 						ConfigurableApp::instance()->organizationDomain(), ConfigurableApp::instance()->applicationName())
 #else
-#define QSETTINGS_OBJECT(s) \
+#define QSETTINGS_BACKEND(s) \
 			QSettings s(ConfigurableApp::instance()->getSettingsFormat(), QSettings::UserScope, \
 						ConfigurableApp::instance()->organizationName(), ConfigurableApp::instance()->applicationName())
 #endif
 
+// the preferences, served from memory
+#define QSETTINGS_OBJECT(s) \
+			SettingsStore& s = *SettingsStore::instance()
+
 
 class ConfigurableApp : public QApplication
 {
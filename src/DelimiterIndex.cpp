@@ -0,0 +1,246 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#include "DelimiterIndex.h"
+#include "TWUtils.h"
+#include "TeXBlockData.h"
+
+#include <QTextDocument>
+#include <QTextBlock>
+
+DelimiterIndex::DelimiterIndex(QTextDocument *doc)
+	: QObject(doc), doc(doc), leafCount(0), treeBlockCount(0), treeValid(false)
+{
+	connect(doc, SIGNAL(contentsChange(int, int, int)), this, SLOT(contentsChange(int, int, int)));
+}
+
+DelimiterIndex::~DelimiterIndex()
+{
+}
+
+TeXBlockData *DelimiterIndex::dataForBlock(QTextBlock block)
+{
+	TeXBlockData *data = TeXBlockData::forBlock(block);
+	if (!data->delimitersValid)
+		data->scanDelimiters(block.text());
+	return data;
+}
+
+void DelimiterIndex::contentsChange(int position, int charsRemoved, int charsAdded)
+{
+	Q_UNUSED(charsRemoved)
+
+	// only rescan the blocks touched by the edit; all others keep their data
+	QTextBlock block = doc->findBlock(position);
+	QTextBlock last = doc->findBlock(position + charsAdded);
+	bool updateLeaves = treeValid && doc->blockCount() == treeBlockCount;
+	treeValid = updateLeaves;
+	while (block.isValid()) {
+		TeXBlockData *data = TeXBlockData::forBlock(block);
+		data->scanDelimiters(block.text());
+		if (updateLeaves)
+			setLeaf(block.blockNumber(), data);
+		if (block == last)
+			break;
+		block = block.next();
+	}
+}
+
+#pragma mark === segment tree ===
+
+void DelimiterIndex::setLeaf(int index, const TeXBlockData *data)
+{
+	int node = leafCount + index;
+	tree[node].sum = data->net;
+	tree[node].minPrefix = data->minPrefix;
+	tree[node].maxSuffix = data->maxSuffix;
+	for (node /= 2; node >= 1; node /= 2)
+		updateNode(node);
+}
+
+void DelimiterIndex::updateNode(int node)
+{
+	const Node& l = tree[2 * node];
+	const Node& r = tree[2 * node + 1];
+	Node& n = tree[node];
+	n.sum = l.sum + r.sum;
+	n.minPrefix = qMin(l.minPrefix, l.sum + r.minPrefix);
+	n.maxSuffix = qMax(r.maxSuffix, r.sum + l.maxSuffix);
+}
+
+void DelimiterIndex::ensureTree()
+{
+	// the tree is indexed by block number, so it has to be rebuilt whenever
+	// blocks are inserted or removed; this only touches the cached summaries
+	if (treeValid)
+		return;
+
+	treeBlockCount = doc->blockCount();
+	leafCount = 1;
+	while (leafCount < treeBlockCount)
+		leafCount *= 2;
+
+	Node empty = { 0, 0, 0 };
+	tree.fill(empty, 2 * leafCount);
+
+	int i = 0;
+	for (QTextBlock block = doc->begin(); block.isValid() && i < treeBlockCount; block = block.next(), ++i) {
+		const TeXBlockData *data = dataForBlock(block);
+		Node& n = tree[leafCount + i];
+		n.sum = data->net;
+		n.minPrefix = data->minPrefix;
+		n.maxSuffix = data->maxSuffix;
+	}
+	for (int node = leafCount - 1; node >= 1; --node)
+		updateNode(node);
+
+	treeValid = true;
+}
+
+int DelimiterIndex::searchForward(int node, int lo, int hi, int first, int& depth) const
+	// find the first leaf >= first in which depth drops below zero; on return,
+	// depth is the depth at the start of that leaf
+{
+	if (hi <= first)
+		return -1;
+	if (lo >= first && depth + tree[node].minPrefix >= 0) {
+		depth += tree[node].sum;
+		return -1;
+	}
+	if (hi - lo == 1)
+		return lo;
+	int mid = (lo + hi) / 2;
+	int result = searchForward(2 * node, lo, mid, first, depth);
+	if (result < 0)
+		result = searchForward(2 * node + 1, mid, hi, first, depth);
+	return result;
+}
+
+int DelimiterIndex::searchBackward(int node, int lo, int hi, int last, int& depth) const
+	// mirror image of searchForward, reading from leaf last towards the start
+{
+	if (lo > last)
+		return -1;
+	if (hi - 1 <= last && depth - tree[node].maxSuffix >= 0) {
+		depth -= tree[node].sum;
+		return -1;
+	}
+	if (hi - lo == 1)
+		return lo;
+	int mid = (lo + hi) / 2;
+	int result = searchBackward(2 * node + 1, mid, hi, last, depth);
+	if (result < 0)
+		result = searchBackward(2 * node, lo, mid, last, depth);
+	return result;
+}
+
+#pragma mark === queries ===
+
+int DelimiterIndex::partnerForward(int blockNumber, int delimIndex, int depth)
+	// position of the first delimiter from delimIndex on at which depth
+	// drops below zero
+{
+	QTextBlock block = doc->findBlockByNumber(blockNumber);
+	const TeXBlockData *data = dataForBlock(block);
+	for (int i = delimIndex; i < data->delims.count(); ++i) {
+		depth += data->delims[i].sign;
+		if (depth < 0)
+			return block.position() + data->delims[i].offset;
+	}
+
+	ensureTree();
+	int found = searchForward(1, 0, leafCount, blockNumber + 1, depth);
+	if (found < 0 || found >= treeBlockCount)
+		return -1;
+	return partnerForward(found, 0, depth);
+}
+
+int DelimiterIndex::partnerBackward(int blockNumber, int delimIndex, int depth)
+	// position of the first delimiter from delimIndex backwards at which the
+	// (reversed) depth drops below zero
+{
+	QTextBlock block = doc->findBlockByNumber(blockNumber);
+	const TeXBlockData *data = dataForBlock(block);
+	for (int i = delimIndex; i >= 0; --i) {
+		depth -= data->delims[i].sign;
+		if (depth < 0)
+			return block.position() + data->delims[i].offset;
+	}
+
+	if (blockNumber == 0)
+		return -1;
+	ensureTree();
+	int found = searchBackward(1, 0, leafCount, blockNumber - 1, depth);
+	if (found < 0)
+		return -1;
+	const TeXBlockData *foundData = dataForBlock(doc->findBlockByNumber(found));
+	return partnerBackward(found, foundData->delims.count() - 1, depth);
+}
+
+static int firstDelimAtOrAfter(const TeXBlockData *data, int offset)
+{
+	int lo = 0, hi = data->delims.count();
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (data->delims[mid].offset < offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+int DelimiterIndex::matchingDelim(int pos)
+{
+	QTextBlock block = doc->findBlock(pos);
+	if (!block.isValid())
+		return -1;
+	const TeXBlockData *data = dataForBlock(block);
+	int offset = pos - block.position();
+	int i = firstDelimAtOrAfter(data, offset);
+	if (i >= data->delims.count() || data->delims[i].offset != offset)
+		return -1;
+
+	QChar c = block.text().at(offset);
+	int match;
+	QChar expected;
+	if (data->delims[i].sign > 0) {
+		match = partnerForward(block.blockNumber(), i + 1, 0);
+		expected = TWUtils::closerMatching(c);
+	}
+	else {
+		match = partnerBackward(block.blockNumber(), i - 1, 0);
+		expected = TWUtils::openerMatching(c);
+	}
+	if (match < 0 || doc->characterAt(match) != expected)
+		return -1;
+	return match;
+}
+
+int DelimiterIndex::enclosingOpener(int pos)
+{
+	QTextBlock block = doc->findBlock(pos);
+	if (!block.isValid())
+		return -1;
+	const TeXBlockData *data = dataForBlock(block);
+	int i = firstDelimAtOrAfter(data, pos - block.position());
+	return partnerBackward(block.blockNumber(), i - 1, 0);
+}
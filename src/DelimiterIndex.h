@@ -0,0 +1,81 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#ifndef DelimiterIndex_H
+#define DelimiterIndex_H
+
+#include <QObject>
+#include <QVector>
+
+class QTextDocument;
+class QTextBlock;
+class TeXBlockData;
+
+// Answers matching-delimiter queries for a QTextDocument without scanning
+// the whole text. Each block caches its delimiters in its TeXBlockData
+// (updated when the block is edited), and a segment tree over the blocks locates the block
+// containing the partner of a delimiter in O(log n).
+// Delimiters are nested by depth regardless of their kind; the partner found
+// this way is only accepted if it is of the matching kind.
+class DelimiterIndex : public QObject
+{
+	Q_OBJECT
+
+public:
+	DelimiterIndex(QTextDocument *doc);
+	virtual ~DelimiterIndex();
+
+	// position of the delimiter matching the one at pos, or -1
+	int matchingDelim(int pos);
+
+	// position of the innermost opening delimiter before pos that is not
+	// closed before pos, or -1
+	int enclosingOpener(int pos);
+
+private slots:
+	void contentsChange(int position, int charsRemoved, int charsAdded);
+
+private:
+	struct Node {
+		int sum;
+		int minPrefix;
+		int maxSuffix;
+	};
+
+	TeXBlockData *dataForBlock(QTextBlock block);
+	void setLeaf(int index, const TeXBlockData *data);
+	void updateNode(int node);
+	void ensureTree();
+
+	int searchForward(int node, int lo, int hi, int first, int& depth) const;
+	int searchBackward(int node, int lo, int hi, int last, int& depth) const;
+
+	int partnerForward(int blockNumber, int delimIndex, int depth);
+	int partnerBackward(int blockNumber, int delimIndex, int depth);
+
+	QTextDocument *doc;
+	QVector<Node> tree;
+	int leafCount;
+	int treeBlockCount;
+	bool treeValid;
+};
+
+#endif
@@ -0,0 +1,178 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#include "DictionaryManager.h"
+#include "TWUtils.h"
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QDir>
+#include <QMap>
+#include <QTime>
+
+// number of loaded dictionaries kept around although no document uses them
+const int kMaxUnusedDictionaries = 2;
+
+DictionaryManager *DictionaryManager::theInstance = NULL;
+
+DictionaryManager *DictionaryManager::instance()
+{
+	if (theInstance == NULL)
+		theInstance = new DictionaryManager(QCoreApplication::instance());
+	return theInstance;
+}
+
+DictionaryManager::DictionaryManager(QObject *parent)
+	: QObject(parent), useCounter(0)
+{
+}
+
+DictionaryManager::~DictionaryManager()
+{
+	foreach (const Dictionary& dict, dictionaries) {
+		if (dict.loader) {
+			dict.loader->wait();
+			if (dict.loader->handle)
+				Hunspell_destroy(dict.loader->handle);
+		}
+		if (dict.handle)
+			Hunspell_destroy(dict.handle);
+	}
+	if (theInstance == this)
+		theInstance = NULL;
+}
+
+QString DictionaryManager::dictionaryPath(const QString& language)
+{
+	if (language.isEmpty())
+		return QString();
+	if (paths.contains(language))
+		return paths.value(language);
+
+	QString path;
+	const QString dictPath = TWUtils::getLibraryPath("dictionaries");
+	QFileInfo affFile(dictPath + "/" + language + ".aff");
+	QFileInfo dicFile(dictPath + "/" + language + ".dic");
+	if (affFile.isReadable() && dicFile.isReadable())
+		path = dicFile.canonicalFilePath();
+	paths[language] = path;
+	return path;
+}
+
+Hunhandle *DictionaryManager::dictionary(const QString& language)
+{
+	QString path = dictionaryPath(language);
+	if (path.isEmpty())
+		return NULL;
+
+	Dictionary& dict = dictionaries[path];
+	dict.lastUsed = ++useCounter;
+	if (dict.handle == NULL && dict.loader == NULL)
+		startLoading(language, path);
+	return dict.handle;
+}
+
+bool DictionaryManager::isLoading(const QString& language)
+{
+	QString path = dictionaryPath(language);
+	return !path.isEmpty() && dictionaries.contains(path) && dictionaries[path].loader != NULL;
+}
+
+void DictionaryManager::acquire(const QString& language)
+{
+	QString path = dictionaryPath(language);
+	if (!path.isEmpty())
+		++dictionaries[path].users;
+}
+
+void DictionaryManager::release(const QString& language)
+{
+	QString path = dictionaryPath(language);
+	if (path.isEmpty() || !dictionaries.contains(path))
+		return;
+	Dictionary& dict = dictionaries[path];
+	if (dict.users > 0 && --dict.users == 0)
+		releaseUnused();
+}
+
+void DictionaryManager::preload(const QStringList& languages)
+{
+	QHash<QString, Dictionary>::iterator it;
+	for (it = dictionaries.begin(); it != dictionaries.end(); ++it)
+		it.value().preloaded = false;
+	foreach (const QString& language, languages) {
+		(void)dictionary(language);
+		QString path = dictionaryPath(language);
+		if (!path.isEmpty())
+			dictionaries[path].preloaded = true;
+	}
+	releaseUnused();
+}
+
+void DictionaryManager::startLoading(const QString& language, const QString& path)
+{
+	QFileInfo dicFile(path);
+	QFileInfo affFile(dicFile.dir(), dicFile.completeBaseName() + ".aff");
+	DictionaryLoader *loader = new DictionaryLoader(language, affFile.canonicalFilePath(), path, this);
+	dictionaries[path].loader = loader;
+	connect(loader, SIGNAL(finished()), this, SLOT(loaderFinished()));
+	loader->start(QThread::LowPriority);
+}
+
+void DictionaryManager::loaderFinished()
+{
+	DictionaryLoader *loader = qobject_cast<DictionaryLoader*>(sender());
+	if (loader == NULL)
+		return;
+
+	Dictionary& dict = dictionaries[loader->dicPath];
+	dict.loader = NULL;
+	dict.handle = loader->handle;
+	loader->deleteLater();
+
+	emit dictionaryLoaded(loader->language, loader->msecs);
+	releaseUnused();
+}
+
+void DictionaryManager::releaseUnused()
+{
+	// collect loaded dictionaries nobody uses, least recently used first;
+	// preloaded ones stay, or preloading more than a few would be undone
+	QMap<uint, QString> unused;
+	QHash<QString, Dictionary>::const_iterator it;
+	for (it = dictionaries.constBegin(); it != dictionaries.constEnd(); ++it) {
+		if (it.value().users == 0 && it.value().handle != NULL && !it.value().preloaded)
+			unused.insert(it.value().lastUsed, it.key());
+	}
+	while (unused.count() > kMaxUnusedDictionaries) {
+		QString path = unused.take(unused.begin().key());
+		Hunspell_destroy(dictionaries[path].handle);
+		dictionaries.remove(path);
+	}
+}
+
+void DictionaryLoader::run()
+{
+	QTime time;
+	time.start();
+	handle = Hunspell_create(affPath.toLocal8Bit().data(), dicPath.toLocal8Bit().data());
+	msecs = time.elapsed();
+}
@@ -0,0 +1,109 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#ifndef DictionaryManager_H
+#define DictionaryManager_H
+
+#include <QObject>
+#include <QThread>
+#include <QHash>
+#include <QStringList>
+
+#include <hunspell.h>
+
+class DictionaryLoader;
+
+// Owns the Hunspell handles used for spell checking. Dictionaries are
+// loaded on worker threads (Hunspell_create can take seconds for large
+// dictionaries), and handles no document uses any more are released on a
+// least-recently-used basis.
+// Languages that are aliases of the same dictionary file share one handle.
+class DictionaryManager : public QObject
+{
+	Q_OBJECT
+
+public:
+	static DictionaryManager *instance();
+
+	// Returns the handle for language if it's loaded. Otherwise NULL is
+	// returned and, if such a dictionary exists, it is loaded in the
+	// background; dictionaryLoaded() is emitted once it's available.
+	Hunhandle *dictionary(const QString& language);
+	bool isLoading(const QString& language);
+
+	// documents hold a reference to the language they use, so its handle
+	// isn't released while in use
+	void acquire(const QString& language);
+	void release(const QString& language);
+
+	// start loading dictionaries that are likely to be needed soon; they are
+	// kept even while no document uses them, until the next call
+	void preload(const QStringList& languages);
+
+signals:
+	void dictionaryLoaded(const QString& language, int msecs);
+
+private slots:
+	void loaderFinished();
+
+private:
+	DictionaryManager(QObject *parent = NULL);
+	virtual ~DictionaryManager();
+
+	QString dictionaryPath(const QString& language);
+	void startLoading(const QString& language, const QString& path);
+	void releaseUnused();
+
+	struct Dictionary {
+		Dictionary() : handle(NULL), users(0), lastUsed(0), loader(NULL), preloaded(false) { }
+		Hunhandle *handle;
+		int users;
+		uint lastUsed;
+		DictionaryLoader *loader;
+		bool preloaded;	// never released as unused
+	};
+	// keyed by the canonical path of the .dic file
+	QHash<QString, Dictionary> dictionaries;
+	QHash<QString, QString> paths;
+	uint useCounter;
+
+	static DictionaryManager *theInstance;
+};
+
+class DictionaryLoader : public QThread
+{
+	Q_OBJECT
+
+public:
+	DictionaryLoader(const QString& language, const QString& affPath, const QString& dicPath, QObject *parent = NULL)
+		: QThread(parent), language(language), affPath(affPath), dicPath(dicPath), handle(NULL), msecs(0) { }
+
+	QString language;
+	QString affPath;
+	QString dicPath;
+	Hunhandle *handle;
+	int msecs;
+
+protected:
+	virtual void run();
+};
+
+#endif
@@ -0,0 +1,170 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#include "DocumentSaver.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QTemporaryFile>
+#include <QTextCodec>
+
+#ifdef Q_WS_WIN
+#include <windows.h>
+#include <io.h>
+#else
+#include <stdio.h>
+#include <unistd.h>
+#endif
+
+DocumentSaver *DocumentSaver::theInstance = NULL;
+
+DocumentSaver *DocumentSaver::instance()
+{
+	if (theInstance == NULL)
+		theInstance = new DocumentSaver(QCoreApplication::instance());
+	return theInstance;
+}
+
+DocumentSaver::DocumentSaver(QObject *parent)
+	: QObject(parent)
+{
+	// a single worker keeps the writes in the order they were requested
+	pool.setMaxThreadCount(1);
+}
+
+DocumentSaver::~DocumentSaver()
+{
+	pool.waitForDone();
+	if (theInstance == this)
+		theInstance = NULL;
+}
+
+void DocumentSaver::save(const QString& fileName, const QString& text, QTextCodec *codec, const QString& lineEnding)
+{
+	DocumentSaveJob *job = new DocumentSaveJob(fileName, text, codec, lineEnding);
+	connect(job, SIGNAL(finished(const QString&, bool, const QString&)),
+			this, SLOT(jobFinished(const QString&, bool, const QString&)), Qt::QueuedConnection);
+	++pending[fileName];
+	pool.start(job);
+}
+
+void DocumentSaver::waitForDone()
+{
+	if (!hasPendingSaves())
+		return;
+	pool.waitForDone();
+	// deliver the queued results now, so callers see the final state
+	QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+}
+
+void DocumentSaver::jobFinished(const QString& fileName, bool success, const QString& errorString)
+{
+	if (--pending[fileName] <= 0)
+		pending.remove(fileName);
+	emit saveFinished(fileName, success, errorString);
+	if (pending.isEmpty())
+		emit allSavesFinished();
+}
+
+#pragma mark === DocumentSaveJob ===
+
+DocumentSaveJob::DocumentSaveJob(const QString& fileName, const QString& text, QTextCodec *codec, const QString& lineEnding)
+	: fileName(fileName), text(text), codec(codec), lineEnding(lineEnding)
+{
+	setAutoDelete(true);
+}
+
+void DocumentSaveJob::run()
+{
+	if (lineEnding != "\n")
+		text.replace("\n", lineEnding);
+	QByteArray data = codec->fromUnicode(text);
+	text.clear();
+
+	// write through symlinks rather than replacing them with a regular file
+	QString target = fileName;
+	QFileInfo info(fileName);
+	if (info.isSymLink())
+		target = info.symLinkTarget();
+
+	QString errorString;
+	bool success = writeAtomically(target, data, errorString);
+	emit finished(fileName, success, errorString);
+}
+
+bool DocumentSaveJob::writeAtomically(const QString& target, const QByteArray& data, QString& errorString)
+{
+	QFileInfo info(target);
+	QTemporaryFile tmp(info.absolutePath() + "/." + info.fileName() + ".XXXXXX");
+	// if we can't create a file next to the target (e.g., the directory is
+	// not writable but the file is), fall back to overwriting it directly
+	if (!tmp.open())
+		return writeInPlace(target, data, errorString);
+
+	if (info.exists())
+		tmp.setPermissions(QFile::permissions(target));
+
+	if (tmp.write(data) != data.size() || !tmp.flush()) {
+		errorString = tmp.errorString();
+		return false;
+	}
+	// the data must be on the disk before the rename makes it the target;
+	// otherwise a crash could still leave an empty or partial file behind
+#ifdef Q_WS_WIN
+	if (!FlushFileBuffers((HANDLE)_get_osfhandle(tmp.handle()))) {
+#else
+	if (::fsync(tmp.handle()) != 0) {
+#endif
+		errorString = tr("Could not write the file to disk.");
+		return false;
+	}
+	QString tmpName = tmp.fileName();
+	tmp.close();
+
+#ifdef Q_WS_WIN
+	if (!MoveFileExW((LPCWSTR)QDir::toNativeSeparators(tmpName).utf16(),
+					 (LPCWSTR)QDir::toNativeSeparators(target).utf16(),
+					 MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+		return writeInPlace(target, data, errorString);
+#else
+	if (::rename(QFile::encodeName(tmpName).constData(), QFile::encodeName(target).constData()) != 0)
+		return writeInPlace(target, data, errorString);
+#endif
+	// the temporary file has taken the place of the target now
+	tmp.setAutoRemove(false);
+	return true;
+}
+
+bool DocumentSaveJob::writeInPlace(const QString& target, const QByteArray& data, QString& errorString)
+{
+	QFile file(target);
+	if (!file.open(QFile::WriteOnly)) {
+		errorString = file.errorString();
+		return false;
+	}
+	if (file.write(data) != data.size()) {
+		errorString = file.errorString();
+		return false;
+	}
+	return true;
+}
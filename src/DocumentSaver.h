@@ -0,0 +1,95 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#ifndef DocumentSaver_H
+#define DocumentSaver_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QString>
+#include <QHash>
+
+class QTextCodec;
+
+// Writes document snapshots to disk on a worker thread. Line-ending
+// conversion, encoding and the actual write all happen off the GUI thread;
+// the data is written to a temporary file in the target directory, synced to
+// the disk and only then renamed over the original, so a crash or full disk
+// never leaves a truncated file behind.
+// Saves are processed strictly in the order they were requested.
+class DocumentSaver : public QObject
+{
+	Q_OBJECT
+
+public:
+	static DocumentSaver *instance();
+
+	// queue a save; text must use '\n' line endings, which are replaced by
+	// lineEnding when writing
+	void save(const QString& fileName, const QString& text, QTextCodec *codec, const QString& lineEnding);
+
+	bool isSaving(const QString& fileName) const { return pending.contains(fileName); }
+	bool hasPendingSaves() const { return !pending.isEmpty(); }
+
+	// block until all queued saves have been written and reported
+	void waitForDone();
+
+signals:
+	void saveFinished(const QString& fileName, bool success, const QString& errorString);
+	void allSavesFinished();
+
+private slots:
+	void jobFinished(const QString& fileName, bool success, const QString& errorString);
+
+private:
+	DocumentSaver(QObject *parent = NULL);
+	virtual ~DocumentSaver();
+
+	QThreadPool pool;
+	QHash<QString, int> pending;
+
+	static DocumentSaver *theInstance;
+};
+
+class DocumentSaveJob : public QObject, public QRunnable
+{
+	Q_OBJECT
+
+public:
+	DocumentSaveJob(const QString& fileName, const QString& text, QTextCodec *codec, const QString& lineEnding);
+
+	virtual void run();
+
+signals:
+	void finished(const QString& fileName, bool success, const QString& errorString);
+
+private:
+	bool writeAtomically(const QString& target, const QByteArray& data, QString& errorString);
+	bool writeInPlace(const QString& target, const QByteArray& data, QString& errorString);
+
+	QString fileName;
+	QString text;
+	QTextCodec *codec;
+	QString lineEnding;
+};
+
+#endif
@@ -0,0 +1,220 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#include "EngineResolver.h"
+#include "TWApp.h"
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QProcess>
+
+// wait this long after a change in a binary directory before probing again,
+// as installers tend to touch many files
+const int kReprobeDelay = 2000;
+// a tool that doesn't answer "--version" in time is left without a version
+const int kVersionTimeout = 5000;
+
+EngineResolver *EngineResolver::theInstance = NULL;
+
+EngineResolver *EngineResolver::instance()
+{
+	if (theInstance == NULL)
+		theInstance = new EngineResolver(QCoreApplication::instance());
+	return theInstance;
+}
+
+EngineResolver::EngineResolver(QObject *parent)
+	: QObject(parent), pathsValid(false), synctexSupport(-1), generation(0), prober(NULL)
+{
+	watcher = new QFileSystemWatcher(this);
+	connect(watcher, SIGNAL(directoryChanged(const QString&)), this, SLOT(directoryChanged()));
+	reprobeTimer.setSingleShot(true);
+	reprobeTimer.setInterval(kReprobeDelay);
+	connect(&reprobeTimer, SIGNAL(timeout()), this, SLOT(invalidate()));
+	connect(TWApp::instance(), SIGNAL(engineListChanged()), this, SLOT(invalidate()));
+	connect(TWApp::instance(), SIGNAL(binaryPathsChanged()), this, SLOT(invalidate()));
+}
+
+EngineResolver::~EngineResolver()
+{
+	if (prober != NULL) {
+		disconnect(prober, 0, this, 0);
+		prober->wait();
+	}
+	if (theInstance == this)
+		theInstance = NULL;
+}
+
+void EngineResolver::ensurePaths()
+{
+	QByteArray path = qgetenv("PATH");
+	if (pathsValid && path == pathVariable)
+		return;
+	if (pathsValid) {
+		// $PATH was changed (e.g., by a script); everything resolved so far is suspect
+		programs.clear();
+		synctexSupport = -1;
+		++generation;
+	}
+	pathVariable = path;
+	env = QProcess::systemEnvironment();
+	binPaths = TWApp::instance()->getBinaryPaths(env);
+	pathsValid = true;
+
+	QStringList watched = watcher->directories();
+	if (!watched.isEmpty())
+		watcher->removePaths(watched);
+	foreach (const QString& dir, binPaths) {
+		if (QFileInfo(dir).isDir())
+			watcher->addPath(dir);
+	}
+}
+
+void EngineResolver::invalidate()
+{
+	pathsValid = false;
+	programs.clear();
+	synctexSupport = -1;
+	++generation;
+	probeAll();
+}
+
+void EngineResolver::directoryChanged()
+{
+	reprobeTimer.start();
+}
+
+void EngineResolver::probeAll()
+{
+	ensurePaths();
+	if (prober != NULL)
+		return;	// proberFinished() starts another round if this one is outdated
+
+	QStringList names;
+	foreach (const Engine& e, TWApp::instance()->getEngineList()) {
+		if (!e.program().isEmpty() && !names.contains(e.program()))
+			names << e.program();
+	}
+	foreach (const QString& helper, QStringList() << "pdftex" << "bibtex" << "biber" << "makeindex") {
+		if (!names.contains(helper))
+			names << helper;
+	}
+
+	prober = new EngineProber(names, binPaths, env, generation, this);
+	connect(prober, SIGNAL(finished()), this, SLOT(proberFinished()));
+	prober->start(QThread::LowPriority);
+}
+
+void EngineResolver::proberFinished()
+{
+	EngineProber *p = qobject_cast<EngineProber*>(sender());
+	if (p == NULL)
+		return;
+	p->deleteLater();
+	if (p == prober)
+		prober = NULL;
+
+	if (p->generation != generation) {
+		// the paths changed while probing
+		probeAll();
+		return;
+	}
+
+	QHash<QString, ProgramInfo>::const_iterator i;
+	for (i = p->results.constBegin(); i != p->results.constEnd(); ++i)
+		programs.insert(i.key(), i.value());
+	synctexSupport = p->synctexSupport;
+	emit probed();
+}
+
+QStringList EngineResolver::binaryPaths()
+{
+	ensurePaths();
+	return binPaths;
+}
+
+QStringList EngineResolver::environment()
+{
+	ensurePaths();
+	return env;
+}
+
+QString EngineResolver::resolve(const QString& program)
+{
+	ensurePaths();
+	QHash<QString, ProgramInfo>::const_iterator i = programs.constFind(program);
+	if (i != programs.constEnd())
+		return i.value().path;
+
+	// not probed (yet); look it up once and remember the answer, found or not
+	ProgramInfo info;
+	info.path = TWApp::findProgram(program, binPaths);
+	programs.insert(program, info);
+	return info.path;
+}
+
+QString EngineResolver::version(const QString& program)
+{
+	ensurePaths();
+	return programs.value(program).version;
+}
+
+bool EngineResolver::supportsSynctex()
+{
+	ensurePaths();
+	return synctexSupport != 0;
+}
+
+void EngineProber::run()
+{
+	foreach (const QString& program, programs) {
+		EngineResolver::ProgramInfo info;
+		info.path = TWApp::findProgram(program, binPaths);
+		if (!info.path.isEmpty()) {
+			QProcess process;
+			process.setEnvironment(env);
+			process.setProcessChannelMode(QProcess::MergedChannels);
+			process.start(info.path, QStringList("--version"));
+			if (process.waitForFinished(kVersionTimeout))
+				info.version = QString::fromLocal8Bit(process.readAll()).section('\n', 0, 0).trimmed();
+			else {
+				process.kill();
+				process.waitForFinished();
+			}
+		}
+		results.insert(program, info);
+	}
+
+	// for old MikTeX versions: $synctexoption must be dropped if it causes an error
+	QString pdftex = results.value("pdftex").path;
+	if (!pdftex.isEmpty()) {
+		QProcess process;
+		process.setEnvironment(env);
+		process.start(pdftex, QStringList() << "-synctex=1" << "-version");
+		if (process.waitForFinished(kVersionTimeout))
+			synctexSupport = (process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0) ? 1 : 0;
+		else {
+			process.kill();
+			process.waitForFinished();
+		}
+	}
+}
@@ -0,0 +1,119 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#ifndef EngineResolver_H
+#define EngineResolver_H
+
+#include <QObject>
+#include <QThread>
+#include <QHash>
+#include <QStringList>
+#include <QTimer>
+
+class QFileSystemWatcher;
+class EngineProber;
+
+// Caches what starting a tool needs to know about the system: the binary
+// search path, the environment for child processes, the absolute path of
+// every program and engine capabilities (version, SyncTeX support). All
+// configured engines are probed once in the background; afterwards starting
+// a typeset doesn't touch the file system. The cache is dropped when $PATH,
+// the binary paths from the preferences or the engine list change, or when
+// a file is added to or removed from one of the binary directories.
+class EngineResolver : public QObject
+{
+	Q_OBJECT
+
+public:
+	struct ProgramInfo {
+		QString path;		// empty if the program wasn't found
+		QString version;	// first line of "program --version", if probed
+	};
+
+	static EngineResolver *instance();
+
+	// start probing all configured engines and helper programs
+	void probeAll();
+
+	QStringList binaryPaths();
+	// the system environment with PATH extended by the binary paths
+	QStringList environment();
+
+	// absolute path of program, or an empty string if it isn't installed
+	QString resolve(const QString& program);
+	QString version(const QString& program);
+	// whether pdftex understands -synctex=1 (assumed until probed otherwise)
+	bool supportsSynctex();
+
+signals:
+	void probed();
+
+public slots:
+	void invalidate();
+
+private slots:
+	void proberFinished();
+	void directoryChanged();
+
+private:
+	EngineResolver(QObject *parent = NULL);
+	virtual ~EngineResolver();
+
+	void ensurePaths();
+
+	QStringList binPaths;
+	QStringList env;
+	QByteArray pathVariable;
+	bool pathsValid;
+
+	QHash<QString, ProgramInfo> programs;
+	int synctexSupport;		// -1: not probed yet
+	int generation;
+	EngineProber *prober;
+
+	QFileSystemWatcher *watcher;
+	QTimer reprobeTimer;
+
+	static EngineResolver *theInstance;
+};
+
+class EngineProber : public QThread
+{
+	Q_OBJECT
+
+public:
+	EngineProber(const QStringList& programs, const QStringList& binPaths, const QStringList& env,
+				 int generation, QObject *parent = NULL)
+		: QThread(parent), programs(programs), binPaths(binPaths), env(env),
+		  generation(generation), synctexSupport(-1) { }
+
+	QStringList programs;
+	QStringList binPaths;
+	QStringList env;
+	int generation;
+	QHash<QString, EngineResolver::ProgramInfo> results;
+	int synctexSupport;
+
+protected:
+	virtual void run();
+};
+
+#endif
@@ -0,0 +1,288 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#include "FilePropertyStore.h"
+#include "TWUtils.h"
+#include "ConfigurableApp.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QPair>
+
+#ifdef Q_WS_WIN
+#include <windows.h>
+#else
+#include <stdio.h>
+#endif
+
+const quint32 kJournalMagic = 0x54574650;	// "TWFP"
+const quint32 kJournalVersion = 1;
+// the oldest entries are dropped beyond this
+const int kMaxEntries = 5000;
+const int kSyncDelay = 1000;
+
+FilePropertyStore *FilePropertyStore::theInstance = NULL;
+
+FilePropertyStore *FilePropertyStore::instance()
+{
+	if (theInstance == NULL)
+		theInstance = new FilePropertyStore(QCoreApplication::instance());
+	return theInstance;
+}
+
+FilePropertyStore::FilePropertyStore(QObject *parent)
+	: QObject(parent), recentDepth(0), nextSerial(0)
+{
+	syncTimer.setSingleShot(true);
+	syncTimer.setInterval(kSyncDelay);
+	connect(&syncTimer, SIGNAL(timeout()), this, SLOT(sync()));
+	if (QCoreApplication::instance() != NULL)
+		connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), this, SLOT(sync()));
+	load();
+}
+
+FilePropertyStore::~FilePropertyStore()
+{
+	sync();
+	if (theInstance == this)
+		theInstance = NULL;
+}
+
+QString FilePropertyStore::key(const QString& path)
+{
+	QString canonical = QFileInfo(path).canonicalFilePath();
+	return (canonical.isEmpty() ? path : canonical);
+}
+
+QString FilePropertyStore::journalPath() const
+{
+	return QDir(TWUtils::getLibraryPath("configuration")).absoluteFilePath("fileproperties.dat");
+}
+
+void FilePropertyStore::load()
+{
+	QFile file(journalPath());
+	if (!file.open(QIODevice::ReadOnly)) {
+		migrateRecentFiles();
+		return;
+	}
+
+	QDataStream in(&file);
+	in.setVersion(QDataStream::Qt_4_5);
+	quint32 magic, version;
+	in >> magic >> version;
+	if (magic != kJournalMagic || version != kJournalVersion) {
+		// not ours to read; start over
+		file.close();
+		file.remove();
+		return;
+	}
+
+	int records = 0;
+	bool damaged = false;
+	while (!in.atEnd()) {
+		QString path;
+		bool removed;
+		QMap<QString,QVariant> properties;
+		in >> path >> removed >> properties;
+		if (in.status() != QDataStream::Ok) {
+			// a record cut short by a crash; everything before it is fine,
+			// but nothing must be appended after it
+			damaged = true;
+			break;
+		}
+		++records;
+		if (removed)
+			entries.remove(path);
+		else {
+			Entry& e = entries[path];
+			e.properties = properties;
+			e.serial = nextSerial++;
+		}
+	}
+	file.close();
+
+	if (damaged || records > 2 * entries.count() + 64 || entries.count() > kMaxEntries)
+		compact();
+}
+
+void FilePropertyStore::migrateRecentFiles()
+{
+	// the properties used to be kept in the preferences
+	QSETTINGS_OBJECT(settings);
+	QList<QVariant> files;
+	if (settings.contains("recentFiles"))
+		files = settings.value("recentFiles").toList();
+	else if (settings.contains("recentFileList")) {
+		foreach (const QString& path, settings.value("recentFileList").toStringList()) {
+			QMap<QString,QVariant> map;
+			map.insert("path", path);
+			files.append(QVariant(map));
+		}
+	}
+	if (files.isEmpty())
+		return;
+
+	// the list is most recent first
+	for (int i = files.count() - 1; i >= 0; --i) {
+		QMap<QString,QVariant> map = files[i].toMap();
+		QString path = map.value("path").toString();
+		if (path.isEmpty())
+			continue;
+		Entry& e = entries[path];
+		e.properties = map;
+		e.serial = nextSerial++;
+	}
+	if (compact()) {
+		settings.remove("recentFiles");
+		settings.remove("recentFileList");
+	}
+}
+
+bool FilePropertyStore::compact()
+{
+	QList< QPair<quint32, QString> > order;
+	QHash<QString, Entry>::const_iterator i;
+	for (i = entries.constBegin(); i != entries.constEnd(); ++i)
+		order << qMakePair(i.value().serial, i.key());
+	qSort(order);
+	while (order.count() > kMaxEntries)
+		entries.remove(order.takeFirst().second);
+
+	QString path = journalPath();
+	QString temp = path + ".new";
+	QFile file(temp);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+	QDataStream out(&file);
+	out.setVersion(QDataStream::Qt_4_5);
+	out << kJournalMagic << kJournalVersion;
+	// oldest first, so the serials come out the same when reading it back
+	nextSerial = 0;
+	for (int j = 0; j < order.count(); ++j) {
+		Entry& e = entries[order[j].second];
+		e.serial = nextSerial++;
+		out << order[j].second << false << e.properties;
+	}
+	file.close();
+	if (out.status() != QDataStream::Ok) {
+		QFile::remove(temp);
+		return false;
+	}
+#ifdef Q_WS_WIN
+	return MoveFileExW((LPCWSTR)QDir::toNativeSeparators(temp).utf16(), (LPCWSTR)QDir::toNativeSeparators(path).utf16(),
+					   MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(QFile::encodeName(temp).constData(), QFile::encodeName(path).constData()) == 0;
+#endif
+}
+
+QMap<QString,QVariant> FilePropertyStore::properties(const QString& path) const
+{
+	QHash<QString, Entry>::const_iterator i = entries.constFind(key(path));
+	if (i == entries.constEnd())
+		return QMap<QString,QVariant>();
+	return i.value().properties;
+}
+
+void FilePropertyStore::setProperties(const QString& path, const QMap<QString,QVariant>& properties)
+{
+	QString k = key(path);
+	Entry& e = entries[k];
+	e.properties = properties;
+	e.properties.insert("path", k);
+	e.serial = nextSerial++;
+
+	recent.removeAll(k);
+	recent.prepend(k);
+	while (recent.count() > recentDepth)
+		recent.removeLast();
+
+	Change change;
+	change.path = k;
+	change.removed = false;
+	change.properties = e.properties;
+	queue(change);
+}
+
+void FilePropertyStore::remove(const QString& path)
+{
+	QString k = key(path);
+	if (!entries.contains(k))
+		return;
+	entries.remove(k);
+	// a shorter list must be refilled from older entries
+	if (recent.removeAll(k) > 0)
+		rebuildRecent(recentDepth);
+
+	Change change;
+	change.path = k;
+	change.removed = true;
+	queue(change);
+}
+
+void FilePropertyStore::queue(const Change& change)
+{
+	pending << change;
+	syncTimer.start();
+}
+
+void FilePropertyStore::sync()
+{
+	syncTimer.stop();
+	if (pending.isEmpty())
+		return;
+	QFile file(journalPath());
+	bool isNew = !file.exists() || file.size() == 0;
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+		return;	// keep the changes in memory; maybe next time
+	QDataStream out(&file);
+	out.setVersion(QDataStream::Qt_4_5);
+	if (isNew)
+		out << kJournalMagic << kJournalVersion;
+	foreach (const Change& change, pending)
+		out << change.path << change.removed << change.properties;
+	pending.clear();
+}
+
+void FilePropertyStore::rebuildRecent(int count)
+{
+	QList< QPair<quint32, QString> > order;
+	QHash<QString, Entry>::const_iterator i;
+	for (i = entries.constBegin(); i != entries.constEnd(); ++i)
+		order << qMakePair(i.value().serial, i.key());
+	qSort(order);
+
+	recent.clear();
+	for (int j = order.count() - 1; j >= 0 && recent.count() < count; --j)
+		recent << order[j].second;
+	recentDepth = count;
+}
+
+QStringList FilePropertyStore::recentFiles(int count)
+{
+	if (count > recentDepth)
+		rebuildRecent(count);
+	return recent.mid(0, count);
+}
@@ -0,0 +1,91 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#ifndef FilePropertyStore_H
+#define FilePropertyStore_H
+
+#include <QObject>
+#include <QHash>
+#include <QMap>
+#include <QList>
+#include <QVariant>
+#include <QStringList>
+#include <QTimer>
+
+// Remembers per-file window state (geometry, cursor position, editing modes,
+// the state of the PDF window, ...) for every file that was open, keyed by
+// canonical path. Lookups are hash lookups; changes are appended to a binary
+// journal in the configuration folder a moment later instead of rewriting a
+// preference holding all entries, and the journal is compacted when it is
+// loaded. The most recently used entries double as the recent files list.
+class FilePropertyStore : public QObject
+{
+	Q_OBJECT
+
+public:
+	static FilePropertyStore *instance();
+
+	QMap<QString,QVariant> properties(const QString& path) const;
+	// replaces the properties of path and makes it the most recent file
+	void setProperties(const QString& path, const QMap<QString,QVariant>& properties);
+	void remove(const QString& path);
+
+	// the count most recently used files, most recent first
+	QStringList recentFiles(int count);
+
+public slots:
+	// append pending changes to the journal now
+	void sync();
+
+private:
+	FilePropertyStore(QObject *parent = NULL);
+	virtual ~FilePropertyStore();
+
+	struct Entry {
+		QMap<QString,QVariant> properties;
+		quint32 serial;	// larger is more recent
+	};
+
+	struct Change {
+		QString path;
+		bool removed;
+		QMap<QString,QVariant> properties;
+	};
+
+	static QString key(const QString& path);
+	QString journalPath() const;
+	void load();
+	void migrateRecentFiles();
+	bool compact();
+	void rebuildRecent(int count);
+	void queue(const Change& change);
+
+	QHash<QString, Entry> entries;
+	QStringList recent;		// most recent first; the first recentDepth entries by serial
+	int recentDepth;
+	quint32 nextSerial;
+	QList<Change> pending;
+	QTimer syncTimer;
+
+	static FilePropertyStore *theInstance;
+};
+
+#endif
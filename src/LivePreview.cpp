@@ -0,0 +1,201 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#include "LivePreview.h"
+#include "ConfigurableApp.h"
+#include "TWUtils.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QCryptographicHash>
+
+#define kShadowListName ".shadows"
+
+const int kDefault_LivePreviewDelay = 1000;
+
+LivePreview::LivePreview(QObject *parent)
+	: QObject(parent), process(NULL), enabled(false)
+{
+	QSETTINGS_OBJECT(settings);
+	idleTimer.setSingleShot(true);
+	idleTimer.setInterval(settings.value("livePreviewDelay", kDefault_LivePreviewDelay).toInt());
+	connect(&idleTimer, SIGNAL(timeout()), this, SIGNAL(updateRequested()));
+}
+
+LivePreview::~LivePreview()
+{
+	abort();
+}
+
+void LivePreview::setEnabled(bool enable)
+{
+	enabled = enable;
+	if (!enabled)
+		idleTimer.stop();
+}
+
+void LivePreview::documentChanged()
+{
+	if (enabled)
+		idleTimer.start();
+}
+
+QString LivePreview::scratchRoot()
+{
+	return TWUtils::cachePath("preview");
+}
+
+QString LivePreview::scratchDirectory(const QString& rootFile)
+{
+	// keyed by the whole path; the name is only there to be recognizable
+	QFileInfo fi(rootFile);
+	return scratchRoot() + "/" + QCryptographicHash::hash(fi.absoluteFilePath().toUtf8(), QCryptographicHash::Sha1).toHex()
+		+ "-" + fi.completeBaseName();
+}
+
+bool LivePreview::writeShadows(const QString& rootFile, const QMap<QString, QByteArray>& shadows)
+{
+	QFileInfo rootInfo(rootFile);
+	// the shadows are the user's unsaved text; no one else may read them, or
+	// plant files for the engine to pick up
+	if (!TWUtils::makePrivateDirectory(scratchRoot()))
+		return false;
+	QDir scratch(scratchDirectory(rootFile));
+	if (!scratch.mkpath("."))
+		return false;
+
+	// remove the shadows of the previous run; a buffer that is clean by now
+	// must be read from the root's directory again
+	QFile list(scratch.filePath(kShadowListName));
+	if (list.open(QIODevice::ReadOnly | QIODevice::Text)) {
+		QTextStream in(&list);
+		in.setCodec("UTF-8");
+		while (!in.atEnd()) {
+			QString relPath = in.readLine();
+			if (!relPath.isEmpty())
+				scratch.remove(relPath);
+		}
+		list.close();
+	}
+
+	QMap<QString, QByteArray> files(shadows);
+	if (!files.contains(rootInfo.fileName())) {
+		QFile source(rootFile);
+		if (!source.open(QIODevice::ReadOnly))
+			return false;
+		files.insert(rootInfo.fileName(), source.readAll());
+	}
+
+	if (!list.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+		return false;
+	QTextStream out(&list);
+	out.setCodec("UTF-8");
+	QMap<QString, QByteArray>::const_iterator i;
+	for (i = files.constBegin(); i != files.constEnd(); ++i) {
+		QString path = scratch.filePath(i.key());
+		scratch.mkpath(QFileInfo(path).absolutePath());
+		QFile shadow(path);
+		if (!shadow.open(QIODevice::WriteOnly | QIODevice::Truncate) || shadow.write(i.value()) != i.value().size())
+			return false;
+		out << i.key() << "\n";
+	}
+	return true;
+}
+
+bool LivePreview::start(const QString& rootFile, const QString& program, const QStringList& args,
+						const QStringList& env, const QMap<QString, QByteArray>& shadows)
+{
+	abort();
+	if (!writeShadows(rootFile, shadows))
+		return false;
+
+	QFileInfo rootInfo(rootFile);
+	QString scratch = scratchDirectory(rootFile);
+	pdfFile = scratch + "/" + rootInfo.completeBaseName() + ".pdf";
+	// a PDF after the run is then a new one; file times are too coarse to
+	// tell two runs within the same second apart
+	if (QFile::exists(pdfFile) && !QFile::remove(pdfFile))
+		return false;
+
+	// shadows in the working directory win; everything else is found next
+	// to the real root file
+#ifdef Q_WS_WIN
+	const QString sep(";");
+#else
+	const QString sep(":");
+#endif
+	QStringList environment;
+	QString texInputs = "." + sep + rootInfo.absolutePath() + sep;
+	foreach (const QString& var, env) {
+		if (var.startsWith("TEXINPUTS=", Qt::CaseInsensitive))
+			texInputs += var.mid(10);
+		else
+			environment << var;
+	}
+	environment << "TEXINPUTS=" + texInputs;
+
+	process = new QProcess(this);
+	process->setWorkingDirectory(scratch);
+	process->setEnvironment(environment);
+	process->setProcessChannelMode(QProcess::MergedChannels);
+	// nobody reads the output; keep the pipe from filling up
+	process->setStandardOutputFile(scratch + "/" + rootInfo.completeBaseName() + ".out.txt");
+	connect(process, SIGNAL(error(QProcess::ProcessError)), this, SLOT(processError(QProcess::ProcessError)));
+	connect(process, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(processFinished(int, QProcess::ExitStatus)));
+	process->start(program, args);
+	// there is no one to answer error prompts; end-of-file makes TeX give up
+	process->closeWriteChannel();
+	return true;
+}
+
+void LivePreview::abort()
+{
+	if (process != NULL) {
+		disconnect(process, 0, this, 0);
+		process->kill();
+		process->deleteLater();
+		process = NULL;
+	}
+}
+
+void LivePreview::processFinished(int /*exitCode*/, QProcess::ExitStatus exitStatus)
+{
+	// TeX reports errors through the exit code but usually still ships a
+	// usable PDF, so judge by the output file instead
+	finish(exitStatus == QProcess::NormalExit && QFile::exists(pdfFile));
+}
+
+void LivePreview::processError(QProcess::ProcessError /*error*/)
+{
+	finish(false);
+}
+
+void LivePreview::finish(bool success)
+{
+	if (process != NULL) {
+		disconnect(process, 0, this, 0);
+		process->deleteLater();
+		process = NULL;
+	}
+	emit finished(success, pdfFile);
+}
@@ -0,0 +1,81 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#ifndef LivePreview_H
+#define LivePreview_H
+
+#include <QObject>
+#include <QProcess>
+#include <QTimer>
+#include <QMap>
+#include <QStringList>
+
+// Typesets the unsaved state of a document for the preview window without
+// touching the user's files. Dirty buffers are written as shadow copies into
+// a private scratch directory (one per root file, so auxiliary files are
+// reused between runs); the engine runs there with TEXINPUTS pointing back
+// at the root's directory for everything that isn't shadowed.
+class LivePreview : public QObject
+{
+	Q_OBJECT
+
+public:
+	LivePreview(QObject *parent = NULL);
+	virtual ~LivePreview();
+
+	bool isEnabled() const { return enabled; }
+	void setEnabled(bool enable);
+
+	bool isRunning() const { return process != NULL; }
+
+	static QString scratchDirectory(const QString& rootFile);
+	// the private directory all scratch directories live in
+	static QString scratchRoot();
+
+	// shadows maps paths relative to the root file's directory to the bytes
+	// to write; the root file itself is copied from disk if not included
+	bool start(const QString& rootFile, const QString& program, const QStringList& args,
+			   const QStringList& env, const QMap<QString, QByteArray>& shadows);
+	void abort();
+
+public slots:
+	// restarts the idle timer
+	void documentChanged();
+
+signals:
+	void updateRequested();
+	void finished(bool success, const QString& pdfFile);
+
+private slots:
+	void processFinished(int exitCode, QProcess::ExitStatus exitStatus);
+	void processError(QProcess::ProcessError error);
+
+private:
+	bool writeShadows(const QString& rootFile, const QMap<QString, QByteArray>& shadows);
+	void finish(bool success);
+
+	QTimer idleTimer;
+	QProcess *process;
+	QString pdfFile;
+	bool enabled;
+};
+
+#endif
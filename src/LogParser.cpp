@@ -0,0 +1,280 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#include "LogParser.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QRegExp>
+
+// TeX wraps its terminal output at max_print_line characters
+const int kMaxPrintLine = 79;
+// give up on an error message whose context line never shows up
+const int kMaxErrorLines = 20;
+
+// number of characters in UTF-8 data, not counting continuation bytes
+static int utf8Length(const char *data, int size)
+{
+	int length = 0;
+	for (int i = 0; i < size; ++i) {
+		if ((data[i] & 0xC0) != 0x80)
+			++length;
+	}
+	return length;
+}
+
+LogParser::LogParser(QObject *parent)
+	: QObject(parent)
+{
+	reset(QString());
+}
+
+LogParser::~LogParser()
+{
+}
+
+void LogParser::reset(const QString& dir)
+{
+	directory = dir;
+	partial.clear();
+	segmentStart = 0;
+	fileStack.clear();
+	state = Normal;
+	skipLines = 0;
+	errorLines = 0;
+	continuation.clear();
+	entryList.clear();
+	pages = -1;
+	emit cleared();
+}
+
+int LogParser::count(EntryType type) const
+{
+	int result = 0;
+	foreach (const Entry& entry, entryList) {
+		if (entry.type == type)
+			++result;
+	}
+	return result;
+}
+
+void LogParser::addData(const QByteArray& bytes)
+{
+	int start = 0;
+	while (start < bytes.size()) {
+		int eol = bytes.indexOf('\n', start);
+		if (eol < 0) {
+			partial.append(bytes.constData() + start, bytes.size() - start);
+			return;
+		}
+		partial.append(bytes.constData() + start, eol - start);
+		start = eol + 1;
+		if (partial.endsWith('\r'))
+			partial.chop(1);
+		// a full-width line is continued on the next one; pdfTeX counts bytes,
+		// XeTeX and LuaTeX count the characters of their UTF-8 output
+		int segmentLength = partial.size() - segmentStart;
+		if (segmentLength == kMaxPrintLine
+			|| (segmentLength > kMaxPrintLine && utf8Length(partial.constData() + segmentStart, segmentLength) == kMaxPrintLine)) {
+			segmentStart = partial.size();
+			continue;
+		}
+		parseLine(QString::fromUtf8(partial.constData(), partial.size()));
+		partial.clear();
+		segmentStart = 0;
+	}
+}
+
+void LogParser::finish()
+{
+	if (!partial.isEmpty())
+		parseLine(QString::fromUtf8(partial.constData(), partial.size()));
+	partial.clear();
+	segmentStart = 0;
+	flushPending();
+}
+
+QString LogParser::currentFile() const
+{
+	return fileStack.isEmpty() ? QString() : fileStack.last();
+}
+
+void LogParser::addEntry(const Entry& entry)
+{
+	Entry e(entry);
+	if (!e.file.isEmpty())
+		e.file = QFileInfo(QDir(directory), e.file).absoluteFilePath();
+	entryList << e;
+	emit entryAdded(entryList.count() - 1);
+}
+
+void LogParser::flushPending()
+{
+	if (state == InError || state == InWarning)
+		addEntry(pending);
+	state = Normal;
+}
+
+void LogParser::parseLine(const QString& line)
+{
+	static QRegExp contextLine("^l\\.(\\d+)");
+	static QRegExp inputLine("input line (\\d+)");
+
+	switch (state) {
+		case InError:
+			if (contextLine.indexIn(line) == 0) {
+				if (pending.line <= 0)
+					pending.line = contextLine.cap(1).toInt();
+				addEntry(pending);
+				state = Normal;
+				// the rest of the context line follows and may hold stray parentheses
+				skipLines = 1;
+			}
+			else if (++errorLines > kMaxErrorLines)
+				flushPending();
+			return;
+
+		case InWarning:
+			if (line.startsWith(continuation)) {
+				pending.message += " " + line.mid(continuation.length()).trimmed();
+				if (inputLine.indexIn(line) >= 0)
+					pending.line = inputLine.cap(1).toInt();
+				return;
+			}
+			flushPending();
+			break;
+
+		case SkipToBlank:
+			if (line.trimmed().isEmpty())
+				state = Normal;
+			return;
+
+		case Normal:
+			break;
+	}
+
+	if (skipLines > 0) {
+		--skipLines;
+		return;
+	}
+
+	static QRegExp outputWritten("^Output written on .* \\((\\d+) pages?, \\d+ bytes\\)");
+	if (outputWritten.indexIn(line) == 0) {
+		pages = outputWritten.cap(1).toInt();
+		return;
+	}
+
+	if (!startEntry(line))
+		scanParentheses(line);
+}
+
+bool LogParser::startEntry(const QString& line)
+{
+	static QRegExp fileLineError("^(\\S.*):(\\d+): (.*)$");
+	static QRegExp warning("^(LaTeX|LaTeX Font|Package (\\S+)|Class (\\S+)) Warning: (.*)$");
+	static QRegExp badBox("^(Over|Under)full \\\\[hv]box");
+	static QRegExp boxLines("at lines? (\\d+)");
+	static QRegExp inputLine("input line (\\d+)");
+
+	if (line.startsWith("! ")) {
+		pending.type = Error;
+		pending.file = currentFile();
+		pending.line = 0;
+		pending.message = line.mid(2).trimmed();
+		state = InError;
+		errorLines = 0;
+		return true;
+	}
+
+	// -file-line-error style
+	if (fileLineError.indexIn(line) == 0) {
+		QString file = fileLineError.cap(1);
+		if (file.startsWith("./") || file.startsWith("/") || QFileInfo(QDir(directory), file).exists()) {
+			pending.type = Error;
+			pending.file = file;
+			pending.line = fileLineError.cap(2).toInt();
+			pending.message = fileLineError.cap(3).trimmed();
+			state = InError;
+			errorLines = 0;
+			return true;
+		}
+	}
+
+	if (warning.indexIn(line) == 0) {
+		pending.type = Warning;
+		pending.file = currentFile();
+		pending.line = (inputLine.indexIn(line) >= 0 ? inputLine.cap(1).toInt() : 0);
+		pending.message = warning.cap(4).trimmed();
+		QString source = warning.cap(2);
+		if (source.isEmpty())
+			source = warning.cap(3);
+		if (warning.cap(1) == "LaTeX Font")
+			source = "Font";
+		if (source.isEmpty()) {
+			addEntry(pending);
+			// LaTeX's own warnings may still open or close files on the same line
+			return false;
+		}
+		continuation = "(" + source + ")";
+		state = InWarning;
+		return true;
+	}
+
+	if (badBox.indexIn(line) == 0) {
+		Entry entry;
+		entry.type = BadBox;
+		entry.file = currentFile();
+		entry.line = (boxLines.indexIn(line) >= 0 ? boxLines.cap(1).toInt() : 0);
+		entry.message = line.trimmed();
+		addEntry(entry);
+		state = SkipToBlank;
+		return true;
+	}
+
+	return false;
+}
+
+void LogParser::scanParentheses(const QString& line)
+{
+	// a path ending in an extension that starts with a letter ("15.0pt" is not a file)
+	static QRegExp fileName("[^\\s()\\[\\]{}]*\\.[A-Za-z][A-Za-z0-9]{0,7}");
+
+	const int length = line.length();
+	for (int i = 0; i < length; ++i) {
+		QChar c = line[i];
+		if (c == '(') {
+			// "(name.ext" opens a file; any other parenthesis just nests
+			int end = i + 1;
+			while (end < length && !line[end].isSpace() && line[end] != '(' && line[end] != ')')
+				++end;
+			QString token = line.mid(i + 1, end - i - 1);
+			if (!token.isEmpty() && fileName.exactMatch(token))
+				fileStack << token;
+			else
+				fileStack << currentFile();
+			i = end - 1;
+		}
+		else if (c == ')') {
+			if (!fileStack.isEmpty())
+				fileStack.pop_back();
+		}
+	}
+}
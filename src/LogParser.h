@@ -0,0 +1,100 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#ifndef LogParser_H
+#define LogParser_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QVector>
+#include <QByteArray>
+
+// Follows the output of a TeX engine as it arrives and extracts errors,
+// warnings and bad boxes together with the file and line they refer to.
+// The current file is tracked from the parentheses TeX prints when it opens
+// and closes input files. Only the current line is buffered, so the work is
+// linear in the length of the log.
+class LogParser : public QObject
+{
+	Q_OBJECT
+
+public:
+	enum EntryType {
+		Error,
+		Warning,
+		BadBox
+	};
+
+	struct Entry {
+		EntryType type;
+		QString file;
+		int line;
+		QString message;
+	};
+
+	LogParser(QObject *parent = NULL);
+	virtual ~LogParser();
+
+	// start a new log; relative file names are resolved against directory
+	void reset(const QString& directory);
+	void addData(const QByteArray& bytes);
+	// process a last, unterminated line
+	void finish();
+
+	const QList<Entry>& entries() const { return entryList; }
+	// page count from the engine's "Output written on" line, or -1
+	int outputPages() const { return pages; }
+	int count(EntryType type) const;
+
+signals:
+	void cleared();
+	void entryAdded(int index);
+
+private:
+	enum State {
+		Normal,
+		InError,		// between "! message" and the "l.<n>" context line
+		InWarning,		// continuation lines of a package/class warning
+		SkipToBlank		// box contents following a bad box message
+	};
+
+	void parseLine(const QString& line);
+	bool startEntry(const QString& line);
+	void addEntry(const Entry& entry);
+	void flushPending();
+	void scanParentheses(const QString& line);
+	QString currentFile() const;
+
+	QString directory;
+	QByteArray partial;
+	int segmentStart;
+	QVector<QString> fileStack;
+	State state;
+	int skipLines;
+	int errorLines;
+	QString continuation;
+	Entry pending;
+	QList<Entry> entryList;
+	int pages;
+};
+
+#endif
@@ -23,12 +23,35 @@
 
 #include "PDFDocks.h"
 #include "TWApp.h"
+#include "TWUtils.h"
 #include "PDFDocument.h"
+#include "PDFRenderer.h"
+#include "PDFFontScanner.h"
+#include "PDFOutline.h"
 
-#include <QTreeWidget>
+#include <QTreeView>
 #include <QHeaderView>
 #include <QListWidget>
-#include <QTableWidget>
+#include <QTableView>
+#include <QScrollBar>
+#include <QPixmap>
+#include <QBuffer>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QDataStream>
+#include <QCryptographicHash>
+
+const int kThumbnailSize = 128;	// pixels along the longer side of a page
+const int kThumbnailPrefetch = 4;	// rows above and below the visible ones
+const int kThumbnailUpdateDelay = 50;	// msecs; don't render what is only scrolled past
+const int kThumbnailSaveDelay = 5000;	// msecs
+const quint32 kThumbnailCacheMagic = 0x54577468;	// "TWth"
+const qint32 kThumbnailCacheVersion = 1;
+// cache files are rewritten when they are used after this long, so their
+// modification times tell which were used least recently
+const int kThumbnailCacheTouchSecs = 24 * 60 * 60;
 
 PDFDock::PDFDock(PDFDocument *doc)
 	: QDockWidget("", doc), document(doc), filled(false)
@@ -75,42 +98,25 @@ void PDFDock::changeLanguage()
 
 //////////////// OUTLINE ////////////////
 
-static void fillToc(const QDomNode &parent, QTreeWidget *tree, QTreeWidgetItem *parentItem)
-{
-	QTreeWidgetItem *newitem = 0;
-	for (QDomNode node = parent.firstChild(); !node.isNull(); node = node.nextSibling()) {
-		QDomElement e = node.toElement();
-
-		if (!parentItem)
-			newitem = new QTreeWidgetItem(tree, newitem);
-		else
-			newitem = new QTreeWidgetItem(parentItem, newitem);
-		newitem->setText(0, e.tagName());
-
-		bool isOpen = false;
-		if (e.hasAttribute("Open"))
-			isOpen = QVariant(e.attribute("Open")).toBool();
-		if (isOpen)
-			tree->expandItem(newitem);
-
-		if (e.hasAttribute("DestinationName"))
-			newitem->setText(1, e.attribute("DestinationName"));
-
-		if (e.hasChildNodes())
-			fillToc(node, tree, newitem);
-	}
-}
-
 PDFOutlineDock::PDFOutlineDock(PDFDocument *doc)
 	: PDFDock(doc)
 {
 	setObjectName("outline");
 	setWindowTitle(getTitle());
-	tree = new PDFDockTreeWidget(this);
+	model = new PDFOutlineModel(this);
+	model->setEmptyText(tr("No TOC"));
+	tree = new PDFDockTreeView(this);
+	tree->setModel(model);
 	tree->setAlternatingRowColors(true);
+	tree->setUniformRowHeights(true);
 	tree->header()->hide();
 	tree->setHorizontalScrollMode(QAbstractItemView::ScrollPerPixel);
 	setWidget(tree);
+	connect(tree->selectionModel(), SIGNAL(selectionChanged(const QItemSelection&, const QItemSelection&)),
+			this, SLOT(followTocSelection()));
+
+	loader = new PDFOutlineLoader(this);
+	connect(loader, SIGNAL(outlineLoaded(PDFOutlineNode*)), this, SLOT(outlineLoaded(PDFOutlineNode*)));
 }
 
 PDFOutlineDock::~PDFOutlineDock()
@@ -120,53 +126,106 @@ PDFOutlineDock::~PDFOutlineDock()
 void PDFOutlineDock::changeLanguage()
 {
 	PDFDock::changeLanguage();
-	if (filled)
-		fillInfo();
+	model->setEmptyText(tr("No TOC"));
 }
 
 void PDFOutlineDock::fillInfo()
 {
-	tree->clear();
-	const QDomDocument *toc = document->popplerDoc()->toc();
-	if (toc) {
-		fillToc(*toc, tree, 0);
-		connect(tree, SIGNAL(itemSelectionChanged()), this, SLOT(followTocSelection()));
-		delete toc;
-	} else {
-		QTreeWidgetItem *item = new QTreeWidgetItem();
-		item->setText(0, tr("No TOC"));
-		item->setFlags(item->flags() & ~Qt::ItemIsEnabled);
-		tree->addTopLevelItem(item);
+	// toc() and building the tree take seconds for huge outlines, so that
+	// is left to the loader's thread
+	loader->setFileName(document->loadedFile());
+}
+
+void PDFOutlineDock::outlineLoaded(PDFOutlineNode *root)
+{
+	const PDFOutlineNode *oldRoot = model->outline();
+	if (oldRoot == NULL) {
+		model->setOutline(root);
+		expandOpenEntries(root);
+		return;
+	}
+	// most reloads don't touch the outline; leave the view alone then
+	if (root->sameAs(*oldRoot)) {
+		delete root;
+		return;
+	}
+	// otherwise, entries keep their state if their titles and those of their
+	// parents are unchanged
+	QSet<QString> expanded;
+	collectExpanded(QModelIndex(), QString(), expanded);
+	int scrollPos = tree->verticalScrollBar()->value();
+	model->setOutline(root);
+	restoreExpanded(root, QString(), expanded);
+	tree->verticalScrollBar()->setValue(scrollPos);
+}
+
+void PDFOutlineDock::expandOpenEntries(const PDFOutlineNode *node)
+{
+	foreach (const PDFOutlineNode *child, node->children) {
+		if (child->open)
+			tree->expand(model->indexOf(child));
+		expandOpenEntries(child);
 	}
 }
 
+void PDFOutlineDock::collectExpanded(const QModelIndex& parent, const QString& parentPath, QSet<QString>& paths)
+{
+	for (int row = 0; row < model->rowCount(parent); ++row) {
+		QModelIndex index = model->index(row, 0, parent);
+		const PDFOutlineNode *node = model->node(index);
+		if (node == NULL || !tree->isExpanded(index))
+			continue;
+		QString path = parentPath + "\n" + node->title;
+		paths.insert(path);
+		collectExpanded(index, path, paths);
+	}
+}
+
+void PDFOutlineDock::restoreExpanded(const PDFOutlineNode *node, const QString& nodePath, const QSet<QString>& paths)
+{
+	foreach (const PDFOutlineNode *child, node->children) {
+		QString path = nodePath + "\n" + child->title;
+		if (paths.contains(path)) {
+			tree->expand(model->indexOf(child));
+			restoreExpanded(child, path, paths);
+		}
+	}
+}
+
+void PDFOutlineDock::documentLoaded()
+{
+	// if the dock is hidden, the outline is read when it is shown next
+	filled = false;
+	PDFDock::documentLoaded();
+}
+
 void PDFOutlineDock::documentClosed()
 {
-	tree->clear();
+	loader->cancel();
+	model->setOutline(NULL);
 	PDFDock::documentClosed();
 }
 
 void PDFOutlineDock::followTocSelection()
 {
-	QList<QTreeWidgetItem*> items = tree->selectedItems();
-	if (items.count() > 0) {
-		QTreeWidgetItem* item = items.first();
-		QString dest = item->text(1);
-		if (!dest.isEmpty())
-			document->goToDestination(dest);
+	QModelIndexList indexes = tree->selectionModel()->selectedIndexes();
+	if (indexes.count() > 0) {
+		const PDFOutlineNode *node = model->node(indexes.first());
+		if (node != NULL && !node->destination.isEmpty())
+			document->goToDestination(node->destination);
 	}
 }
 
-PDFDockTreeWidget::PDFDockTreeWidget(QWidget* parent)
-	: QTreeWidget(parent)
+PDFDockTreeView::PDFDockTreeView(QWidget* parent)
+	: QTreeView(parent)
 {
 }
 
-PDFDockTreeWidget::~PDFDockTreeWidget()
+PDFDockTreeView::~PDFDockTreeView()
 {
 }
 
-QSize PDFDockTreeWidget::sizeHint() const
+QSize PDFDockTreeView::sizeHint() const
 {
 	return QSize(120, 300);
 }
@@ -236,18 +295,18 @@ QSize PDFDockListWidget::sizeHint() const
 
 PDFFontsDock::PDFFontsDock(PDFDocument *doc)
 	: PDFDock(doc)
-	, scannedFonts(false)
+	, showingOldFonts(false)
 {
 	setObjectName("fonts");
 	setWindowTitle(getTitle());
-	table = new QTableWidget(this);
+	model = new PDFFontsModel(this);
+	table = new QTableView(this);
 #ifdef Q_WS_MAC /* don't do this on windows, as the font ends up too small */
 	QFont f(table->font());
 	f.setPointSize(f.pointSize() - 2);
 	table->setFont(f);
 #endif
-	table->setColumnCount(4);
-	setHorizontalHeaderLabels();
+	table->setModel(model);
 	table->setHorizontalScrollMode(QAbstractItemView::ScrollPerPixel);
 	table->setEditTriggers(QAbstractItemView::NoEditTriggers);
 	table->setAlternatingRowColors(true);
@@ -257,6 +316,11 @@ PDFFontsDock::PDFFontsDock(PDFDocument *doc)
 	table->horizontalHeader()->setStretchLastSection(true);
 	table->horizontalHeader()->setDefaultAlignment(Qt::AlignLeft);
 	setWidget(table);
+
+	scanner = new PDFFontScanner(this);
+	connect(scanner, SIGNAL(fontsFound(const QList<Poppler::FontInfo>&)),
+			this, SLOT(fontsFound(const QList<Poppler::FontInfo>&)));
+	connect(scanner, SIGNAL(scanFinished()), this, SLOT(scanFinished()));
 }
 
 PDFFontsDock::~PDFFontsDock()
@@ -266,58 +330,423 @@ PDFFontsDock::~PDFFontsDock()
 void PDFFontsDock::changeLanguage()
 {
 	PDFDock::changeLanguage();
-	setHorizontalHeaderLabels();
-	if (filled)
-		fillInfo();
+	model->changeLanguage();
+	resizeTable();
 }
 
-void PDFFontsDock::setHorizontalHeaderLabels()
+void PDFFontsDock::fillInfo()
 {
-	if (table)
-		table->setHorizontalHeaderLabels(QStringList() << tr("Name") << tr("Type") << tr("Subset") << tr("File"));
+	// fonts() would walk the resources of every page right here; the scanner
+	// does that on its own thread and hands in the fonts as it finds them
+	showingOldFonts = (model->rowCount() > 0);
+	newFonts.clear();
+	scanner->setFileName(document->loadedFile());
 }
 
-void PDFFontsDock::fillInfo()
+void PDFFontsDock::fontsFound(const QList<Poppler::FontInfo>& fonts)
 {
-	if (!scannedFonts) {
-		fonts = document->popplerDoc()->fonts();
-		scannedFonts = true;
+	if (showingOldFonts)
+		newFonts += fonts;
+	else {
+		model->appendFonts(fonts);
+		resizeTable();
 	}
-	table->clearContents();
-	table->setRowCount(0);
-	table->setRowCount(fonts.count());
-	int i = 0;
-	foreach (const Poppler::FontInfo &font, fonts) {
-		if (font.name().isNull()) {
-			table->setItem(i, 0, new QTableWidgetItem(tr("[none]")));
-		} else {
-			table->setItem(i, 0, new QTableWidgetItem(font.name()));
+}
+
+void PDFFontsDock::scanFinished()
+{
+	if (showingOldFonts) {
+		if (!PDFFontsModel::sameFonts(model->fonts(), newFonts)) {
+			model->setFonts(newFonts);
+			resizeTable();
 		}
-		table->setItem(i, 1, new QTableWidgetItem(font.typeName()));
-		table->setItem(i, 2, new QTableWidgetItem(font.isSubset() ? tr("yes") : tr("no")));
-		table->setItem(i, 3, new QTableWidgetItem(font.isEmbedded() ? tr("[embedded]") : font.file()));
-		++i;
+		showingOldFonts = false;
+		newFonts.clear();
 	}
+}
+
+void PDFFontsDock::resizeTable()
+{
 	table->resizeColumnsToContents();
 	table->resizeRowsToContents();
 }
 
 void PDFFontsDock::documentLoaded()
 {
-	scannedFonts = false;
-	fonts.clear();
+	// if the dock is hidden, the fonts are scanned when it is shown next
+	filled = false;
 	PDFDock::documentLoaded();
 }
 
 void PDFFontsDock::documentClosed()
 {
-	scannedFonts = false;
-	fonts.clear();
-	table->clear();
-	table->setRowCount(0);
+	scanner->cancel();
+	showingOldFonts = false;
+	newFonts.clear();
+	model->clear();
+	PDFDock::documentClosed();
+}
+
+PDFFontsModel::PDFFontsModel(QObject *parent)
+	: QAbstractTableModel(parent)
+{
+}
+
+PDFFontsModel::~PDFFontsModel()
+{
+}
+
+int PDFFontsModel::rowCount(const QModelIndex& parent) const
+{
+	return parent.isValid() ? 0 : fontList.count();
+}
+
+int PDFFontsModel::columnCount(const QModelIndex& parent) const
+{
+	return parent.isValid() ? 0 : 4;
+}
+
+QVariant PDFFontsModel::data(const QModelIndex& index, int role) const
+{
+	if (role != Qt::DisplayRole || !index.isValid() || index.row() >= fontList.count())
+		return QVariant();
+
+	// the strings are translated in the context of the dock they used to live in
+	const Poppler::FontInfo& font = fontList[index.row()];
+	switch (index.column()) {
+		case 0:
+			return font.name().isNull() ? PDFFontsDock::tr("[none]") : font.name();
+		case 1:
+			return font.typeName();
+		case 2:
+			return font.isSubset() ? PDFFontsDock::tr("yes") : PDFFontsDock::tr("no");
+		case 3:
+			return font.isEmbedded() ? PDFFontsDock::tr("[embedded]") : font.file();
+	}
+	return QVariant();
+}
+
+QVariant PDFFontsModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+		return QAbstractTableModel::headerData(section, orientation, role);
+	switch (section) {
+		case 0:
+			return PDFFontsDock::tr("Name");
+		case 1:
+			return PDFFontsDock::tr("Type");
+		case 2:
+			return PDFFontsDock::tr("Subset");
+		case 3:
+			return PDFFontsDock::tr("File");
+	}
+	return QVariant();
+}
+
+void PDFFontsModel::setFonts(const QList<Poppler::FontInfo>& fonts)
+{
+	fontList = fonts;
+	reset();
+}
+
+void PDFFontsModel::appendFonts(const QList<Poppler::FontInfo>& fonts)
+{
+	if (fonts.isEmpty())
+		return;
+	beginInsertRows(QModelIndex(), fontList.count(), fontList.count() + fonts.count() - 1);
+	fontList += fonts;
+	endInsertRows();
+}
+
+void PDFFontsModel::clear()
+{
+	setFonts(QList<Poppler::FontInfo>());
+}
+
+void PDFFontsModel::changeLanguage()
+{
+	emit headerDataChanged(Qt::Horizontal, 0, columnCount() - 1);
+	if (!fontList.isEmpty())
+		emit dataChanged(index(0, 0), index(fontList.count() - 1, columnCount() - 1));
+}
+
+bool PDFFontsModel::sameFonts(const QList<Poppler::FontInfo>& a, const QList<Poppler::FontInfo>& b)
+{
+	if (a.count() != b.count())
+		return false;
+	for (int i = 0; i < a.count(); ++i) {
+		if (a[i].name() != b[i].name() || a[i].type() != b[i].type() || a[i].file() != b[i].file()
+			|| a[i].isEmbedded() != b[i].isEmbedded() || a[i].isSubset() != b[i].isSubset())
+			return false;
+	}
+	return true;
+}
+
+//////////////// THUMBNAILS ////////////////
+
+PDFThumbnailDock::PDFThumbnailDock(PDFDocument *doc)
+	: PDFDock(doc)
+	, cacheDirty(false)
+{
+	setObjectName("thumbnails");
+	setWindowTitle(getTitle());
+	list = new PDFDockListWidget(this);
+	list->setIconSize(QSize(kThumbnailSize, kThumbnailSize));
+	list->setUniformItemSizes(true);
+	list->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+	setWidget(list);
+
+	// rows without a thumbnail yet must have the same height as the others
+	QPixmap blank(kThumbnailSize, kThumbnailSize);
+	blank.fill(Qt::transparent);
+	placeholder = QIcon(blank);
+
+	renderer = new PDFRenderer(this);
+	connect(renderer, SIGNAL(pageRendered(int, double, const QRect&, const QImage&)),
+			this, SLOT(thumbnailRendered(int, double, const QRect&, const QImage&)));
+
+	updateTimer.setSingleShot(true);
+	updateTimer.setInterval(kThumbnailUpdateDelay);
+	connect(&updateTimer, SIGNAL(timeout()), this, SLOT(updateVisibleThumbnails()));
+	saveTimer.setSingleShot(true);
+	saveTimer.setInterval(kThumbnailSaveDelay);
+	connect(&saveTimer, SIGNAL(timeout()), this, SLOT(saveCache()));
+
+	connect(list->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(scheduleUpdate()));
+	connect(list->verticalScrollBar(), SIGNAL(rangeChanged(int, int)), this, SLOT(scheduleUpdate()));
+	connect(this, SIGNAL(visibilityChanged(bool)), this, SLOT(scheduleUpdate()));
+	connect(list, SIGNAL(currentRowChanged(int)), this, SLOT(followSelection(int)));
+}
+
+PDFThumbnailDock::~PDFThumbnailDock()
+{
+	saveCache();
+}
+
+QString PDFThumbnailDock::cacheDirectory()
+{
+	return TWUtils::cachePath("thumbnails");
+}
+
+void PDFThumbnailDock::fillInfo()
+{
+	// write out what belongs to the previous version of the file
+	saveCache();
+
+	Poppler::Document *doc = document->popplerDoc();
+	int pageCount = (doc != NULL ? doc->numPages() : 0);
+	// the old thumbnails are shown until their pages have been rendered again
+	while (list->count() > pageCount)
+		delete list->takeItem(list->count() - 1);
+	while (list->count() < pageCount)
+		new QListWidgetItem(placeholder, QString::number(list->count() + 1), list);
+	upToDate.fill(false, pageCount);
+
+	loadCache();
+	renderer->setFileName(document->loadedFile());
+	pageChanged(document->widget()->getCurrentPageIndex());
+	scheduleUpdate();
+}
+
+void PDFThumbnailDock::documentLoaded()
+{
+	// if the dock is hidden, it is filled when it is shown next
+	filled = false;
+	PDFDock::documentLoaded();
+}
+
+void PDFThumbnailDock::documentClosed()
+{
+	saveCache();
+	renderer->cancelAll();
+	list->clear();
+	upToDate.clear();
+	cache.clear();
+	cacheFile.clear();
 	PDFDock::documentClosed();
 }
 
+void PDFThumbnailDock::pageChanged(int page)
+{
+	if (page < 0 || page >= list->count())
+		return;
+	list->blockSignals(true);
+	list->setCurrentRow(page);
+	list->blockSignals(false);
+	list->scrollToItem(list->item(page));
+}
+
+void PDFThumbnailDock::followSelection(int row)
+{
+	if (row >= 0 && document != NULL && document->widget() != NULL)
+		document->widget()->goToPage(row);
+}
+
+void PDFThumbnailDock::scheduleUpdate()
+{
+	if (!isHidden())
+		updateTimer.start();
+}
+
+void PDFThumbnailDock::updateVisibleThumbnails()
+{
+	Poppler::Document *doc = document->popplerDoc();
+	if (!filled || isHidden() || doc == NULL || list->count() == 0)
+		return;
+
+	QModelIndex index = list->indexAt(QPoint(1, 1));
+	int first = (index.isValid() ? index.row() : 0);
+	index = list->indexAt(QPoint(1, list->viewport()->height() - 2));
+	int last = (index.isValid() ? index.row() : list->count() - 1);
+	first = qMax(0, first - kThumbnailPrefetch);
+	last = qMin(list->count() - 1, last + kThumbnailPrefetch);
+
+	// forget about the pages that were only scrolled past
+	renderer->cancelAll();
+	// the renderer takes the newest request first, so ask for the top row last
+	for (int i = last; i >= first; --i) {
+		if (upToDate[i])
+			continue;
+		if (cache.contains(i)) {
+			QImage image;
+			if (image.loadFromData(cache.value(i), "PNG")) {
+				setThumbnail(i, image);
+				continue;
+			}
+			cache.remove(i);
+		}
+		Poppler::Page *page = doc->page(i);
+		if (page == NULL)
+			continue;
+		QSizeF size = page->pageSizeF();
+		delete page;
+		double longerSide = qMax(size.width(), size.height());
+		if (longerSide > 0)
+			renderer->requestPage(i, 72.0 * kThumbnailSize / longerSide);
+	}
+}
+
+void PDFThumbnailDock::thumbnailRendered(int pageIndex, double dpi, const QRect& region, const QImage& image)
+{
+	Q_UNUSED(dpi)
+	if (!region.isNull() || pageIndex < 0 || pageIndex >= list->count())
+		return;
+	setThumbnail(pageIndex, image);
+
+	if (!cacheFile.isEmpty()) {
+		QByteArray png;
+		QBuffer buffer(&png);
+		buffer.open(QIODevice::WriteOnly);
+		if (image.save(&buffer, "PNG")) {
+			cache.insert(pageIndex, png);
+			cacheDirty = true;
+			saveTimer.start();
+		}
+	}
+}
+
+void PDFThumbnailDock::setThumbnail(int pageIndex, const QImage& image)
+{
+	list->item(pageIndex)->setIcon(QIcon(QPixmap::fromImage(image)));
+	upToDate[pageIndex] = true;
+}
+
+void PDFThumbnailDock::loadCache()
+{
+	cache.clear();
+	cacheFile.clear();
+	cacheDirty = false;
+
+	QSETTINGS_OBJECT(settings);
+	if (!settings.value("pdfThumbnailCache", kDefault_ThumbnailCache).toBool() || document->showingLivePreview())
+		return;
+
+	QFileInfo fi(document->loadedFile());
+	QString path = fi.canonicalFilePath();
+	if (path.isEmpty())
+		return;
+	cacheFile = cacheDirectory() + "/"
+		+ QCryptographicHash::hash(path.toUtf8(), QCryptographicHash::Md5).toHex() + ".dat";
+	// a rewritten PDF has a new size or modification time; its pages may all
+	// have moved, so the whole cache is dropped then
+	cacheStamp = (path + "\n" + QString::number(fi.size()) + "\n"
+				  + QString::number(fi.lastModified().toTime_t())).toUtf8();
+
+	QFile file(cacheFile);
+	if (!file.open(QIODevice::ReadOnly))
+		return;
+	QDataStream in(&file);
+	in.setVersion(QDataStream::Qt_4_4);
+	quint32 magic;
+	qint32 version;
+	QByteArray stamp;
+	in >> magic >> version;
+	if (in.status() != QDataStream::Ok || magic != kThumbnailCacheMagic || version != kThumbnailCacheVersion)
+		return;
+	in >> stamp;
+	if (stamp != cacheStamp)
+		return;
+	in >> cache;
+	if (in.status() != QDataStream::Ok)
+		cache.clear();
+	else if (QFileInfo(file).lastModified().secsTo(QDateTime::currentDateTime()) > kThumbnailCacheTouchSecs) {
+		// keep it from being pruned as if it hadn't been used
+		cacheDirty = true;
+		saveTimer.start();
+	}
+}
+
+void PDFThumbnailDock::saveCache()
+{
+	saveTimer.stop();
+	if (!cacheDirty || cacheFile.isEmpty() || !TWUtils::makePrivateDirectory(cacheDirectory()))
+		return;
+	cacheDirty = false;
+
+	// write to a new file first so a crash can't leave a truncated cache behind
+	QString tempFile = cacheFile + ".new";
+	QFile file(tempFile);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return;
+	QDataStream out(&file);
+	out.setVersion(QDataStream::Qt_4_4);
+	out << kThumbnailCacheMagic << kThumbnailCacheVersion << cacheStamp << cache;
+	file.close();
+	if (out.status() != QDataStream::Ok || file.error() != QFile::NoError) {
+		QFile::remove(tempFile);
+		return;
+	}
+	QFile::remove(cacheFile);
+	QFile::rename(tempFile, cacheFile);
+	pruneCache(cacheFile);
+}
+
+void PDFThumbnailDock::pruneCache(const QString& keepFile)
+{
+	QSETTINGS_OBJECT(settings);
+	qint64 sizeLimit = settings.value("pdfThumbnailCacheSize", kDefault_ThumbnailCacheSize).toLongLong() * 1024 * 1024;
+	if (sizeLimit <= 0)
+		return;
+
+	QFileInfoList files = QDir(cacheDirectory()).entryInfoList(QStringList("*.dat"), QDir::Files, QDir::Time | QDir::Reversed);
+	qint64 totalBytes = 0;
+	foreach (const QFileInfo& fi, files)
+		totalBytes += fi.size();
+	if (totalBytes <= sizeLimit)
+		return;
+
+	// drop the least recently used files until there is some room again
+	qint64 target = sizeLimit - sizeLimit / 10;
+	foreach (const QFileInfo& fi, files) {
+		if (totalBytes <= target)
+			break;
+		if (fi.absoluteFilePath() == QFileInfo(keepFile).absoluteFilePath())
+			continue;
+		if (QFile::remove(fi.absoluteFilePath()))
+			totalBytes -= fi.size();
+	}
+}
+
 //////////////// SCROLL AREA ////////////////
 
 PDFScrollArea::PDFScrollArea(QWidget *parent)
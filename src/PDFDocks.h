@@ -23,16 +23,30 @@
 #define PDFDOCKS_H
 
 #include <QDockWidget>
-#include <QTreeWidget>
+#include <QTreeView>
 #include <QListWidget>
 #include <QScrollArea>
+#include <QTimer>
+#include <QVector>
+#include <QMap>
+#include <QIcon>
+#include <QAbstractTableModel>
+#include <QSet>
 
 #include "poppler-qt4.h"
 
+const bool kDefault_ThumbnailCache = true;
+const int kDefault_ThumbnailCacheSize = 32;	// megabytes
+
 class PDFDocument;
+class PDFRenderer;
+class PDFFontScanner;
+class PDFFontsModel;
+class PDFOutlineLoader;
+class PDFOutlineModel;
+struct PDFOutlineNode;
 class QListWidget;
-class QTableWidget;
-class QTreeWidgetItem;
+class QTableView;
 
 class PDFDock : public QDockWidget
 {
@@ -74,6 +88,7 @@ public:
 
 public slots:
 	virtual void documentClosed();
+	virtual void documentLoaded();
 
 protected:
 	virtual void fillInfo();
@@ -84,18 +99,25 @@ protected slots:
 	
 private slots:
 	void followTocSelection();
+	void outlineLoaded(PDFOutlineNode *root);
 
 private:
-	QTreeWidget *tree;
+	void expandOpenEntries(const PDFOutlineNode *node);
+	void collectExpanded(const QModelIndex& parent, const QString& parentPath, QSet<QString>& paths);
+	void restoreExpanded(const PDFOutlineNode *node, const QString& nodePath, const QSet<QString>& paths);
+
+	QTreeView *tree;
+	PDFOutlineModel *model;
+	PDFOutlineLoader *loader;
 };
 
-class PDFDockTreeWidget : public QTreeWidget
+class PDFDockTreeView : public QTreeView
 {
 	Q_OBJECT
 
 public:
-	PDFDockTreeWidget(QWidget* parent);
-	virtual ~PDFDockTreeWidget();
+	PDFDockTreeView(QWidget* parent);
+	virtual ~PDFDockTreeView();
 
 	virtual QSize sizeHint() const;
 };
@@ -147,15 +169,100 @@ public slots:
 protected:
 	virtual void fillInfo();
 	virtual QString getTitle() { return tr("Fonts"); }
-	void setHorizontalHeaderLabels();
 
 protected slots:
 	virtual void changeLanguage();
 
+private slots:
+	void fontsFound(const QList<Poppler::FontInfo>& fonts);
+	void scanFinished();
+
+private:
+	void resizeTable();
+
+	QTableView *table;
+	PDFFontsModel *model;
+	PDFFontScanner *scanner;
+	// while the fonts of a reloaded file are scanned, the table keeps showing
+	// the previous ones; it is only updated if the list has changed
+	bool showingOldFonts;
+	QList<Poppler::FontInfo> newFonts;
+};
+
+class PDFFontsModel : public QAbstractTableModel
+{
+	Q_OBJECT
+
+public:
+	PDFFontsModel(QObject *parent = NULL);
+	virtual ~PDFFontsModel();
+
+	virtual int rowCount(const QModelIndex& parent = QModelIndex()) const;
+	virtual int columnCount(const QModelIndex& parent = QModelIndex()) const;
+	virtual QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+	virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+	const QList<Poppler::FontInfo>& fonts() const { return fontList; }
+	void setFonts(const QList<Poppler::FontInfo>& fonts);
+	void appendFonts(const QList<Poppler::FontInfo>& fonts);
+	void clear();
+	void changeLanguage();
+
+	static bool sameFonts(const QList<Poppler::FontInfo>& a, const QList<Poppler::FontInfo>& b);
+
+private:
+	QList<Poppler::FontInfo> fontList;
+};
+
+
+// Thumbnails are rendered on a worker thread, and only for the rows that are
+// scrolled into view. After a reload the old thumbnails stay in place until
+// their pages have been rendered again. Unless the document is a live
+// preview, they are also kept in a file in the cache directory, so they show
+// up at once when the same version of the PDF is opened again. The files of
+// the documents that were opened least recently are removed when they take
+// up more than the cache's size limit.
+class PDFThumbnailDock : public PDFDock
+{
+	Q_OBJECT
+
+public:
+	PDFThumbnailDock(PDFDocument *doc = 0);
+	~PDFThumbnailDock();
+
+	static QString cacheDirectory();
+
+public slots:
+	virtual void documentClosed();
+	virtual void documentLoaded();
+	virtual void pageChanged(int page);
+
+protected:
+	virtual void fillInfo();
+	virtual QString getTitle() { return tr("Thumbnails"); }
+
+private slots:
+	void scheduleUpdate();
+	void updateVisibleThumbnails();
+	void thumbnailRendered(int pageIndex, double dpi, const QRect& region, const QImage& image);
+	void followSelection(int row);
+	void saveCache();
+
 private:
-	QTableWidget *table;
-	QList<Poppler::FontInfo> fonts;
-	bool scannedFonts;
+	void loadCache();
+	static void pruneCache(const QString& keepFile);
+	void setThumbnail(int pageIndex, const QImage& image);
+
+	QListWidget *list;
+	PDFRenderer *renderer;
+	QIcon placeholder;
+	QVector<bool> upToDate;	// the icon shows the page as it is in the loaded file
+	QMap<qint32, QByteArray> cache;	// PNG data of the thumbnails, by page index
+	QString cacheFile;	// empty if the thumbnails are not kept on disk
+	QByteArray cacheStamp;	// identifies the version of the PDF the cache belongs to
+	bool cacheDirty;
+	QTimer updateTimer;
+	QTimer saveTimer;
 };
 
 
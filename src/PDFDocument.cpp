@@ -26,6 +26,10 @@
 #include "PDFDocks.h"
 #include "FindDialog.h"
 #include "ClickableLabel.h"
+#include "BuildDirectory.h"
+#include "PDFPageStrip.h"
+#include "PDFRenderer.h"
+#include "PDFRenderCache.h"
 
 #include <QDockWidget>
 #include <QCloseEvent>
@@ -50,6 +54,7 @@
 #include <QFileSystemWatcher>
 #include <QToolTip>
 #include <QSignalMapper>
+#include <QActionGroup>
 
 #include <math.h>
 
@@ -63,6 +68,9 @@
 #define ROUND(x) floor((x)+0.5)
 
 const qreal kMaxScaleFactor = 8.0;
+
+// the low-resolution image shown around and behind the sharp part of a page
+const double kMaxCoarsePixels = 1024 * 1024;
 const qreal kMinScaleFactor = 0.125;
 
 const int magSizes[] = { 200, 300, 400 };
@@ -105,11 +113,11 @@ void PDFMagnifier::setPage(Poppler::Page *p, qreal scale)
 	else {
 		PDFWidget* parent = qobject_cast<PDFWidget*>(parentWidget());
 		if (parent != NULL) {
-			QWidget* viewport = parent->parentWidget();
-			if (viewport != NULL) {
+			QRect visible = parent->visibleRect();
+			if (visible.isValid()) {
 				qreal dpi = parentDpi * scaleFactor;
-				QPoint tl = parent->mapFromParent(viewport->rect().topLeft());
-				QPoint br = parent->mapFromParent(viewport->rect().bottomRight());
+				QPoint tl = visible.topLeft();
+				QPoint br = visible.bottomRight();
 				QSize  size = QSize(br.x() - tl.x(), br.y() - tl.y()) * kMagFactor;
 				QPoint loc = tl * kMagFactor;
 				if (page != imagePage || dpi != imageDpi || loc != imageLoc || size != imageSize)
@@ -159,6 +167,12 @@ PDFWidget::PDFWidget()
 	, scaleFactor(1.0)
 	, dpi(72.0)
 	, scaleOption(kFixedMag)
+	, imageDpi(0)
+	, imagePage(NULL)
+	, coarseDpi(0)
+	, pendingDpi(0)
+	, pendingCoarseDpi(0)
+	, renderer(NULL)
 	, magnifier(NULL)
 	, usingTool(kNone)
 {
@@ -226,6 +240,9 @@ PDFWidget::~PDFWidget()
 void PDFWidget::setDocument(Poppler::Document *doc)
 {
 	document = doc;
+	PDFPageStrip *strip = pageStrip();
+	if (strip != NULL)
+		strip->setDocument(doc);
 	reloadPage();
 }
 
@@ -249,17 +266,46 @@ void PDFWidget::paintEvent(QPaintEvent *event)
 	QPainter painter(this);
 	drawFrame(&painter);
 
-	qreal newDpi = dpi * scaleFactor;
-	QRect newRect = rect();
-	if (page != imagePage || newDpi != imageDpi || newRect != imageRect)
-		if (page != NULL)
-			image = page->renderToImage(dpi * scaleFactor, dpi * scaleFactor,
-						rect().x(), rect().y(), rect().width(), rect().height());
-	imagePage = page;
-	imageDpi = newDpi;
-	imageRect = newRect;
+	if (page != NULL) {
+		qreal newDpi = dpi * scaleFactor;
+		if (imagePage != page) {
+			image = QImage();
+			imagePage = page;
+		}
+		QRect visible = visibleRect() & rect();
+		if (visible.isEmpty())
+			visible = event->rect();
+
+		if (image.isNull() || imageDpi != newDpi || !imageRect.contains(visible)) {
+			if (renderer == NULL || (image.isNull() && coarseImage.isNull())) {
+				// nothing to show in the meantime, so take what's visible from the
+				// disk cache or render it right away
+				imageRect = renderRect(visible);
+				if (renderer == NULL || !renderer->cachedImage(pageIndex, newDpi, imageRect, image))
+					image = page->renderToImage(newDpi, newDpi, imageRect.x(), imageRect.y(),
+												imageRect.width(), imageRect.height());
+				imageDpi = newDpi;
+				if (renderer != NULL)
+					requestCoarseImage();
+			}
+			else
+				requestRender(visible);
+		}
 
-	painter.drawImage(event->rect(), image, event->rect());
+		// whatever the sharp image doesn't cover comes from the coarse one;
+		// after zooming, both are scaled until the new ones arrive
+		painter.fillRect(event->rect(), Qt::white);
+		if (!coarseImage.isNull())
+			drawScaledImage(painter, coarseImage, QRect(QPoint(0, 0), coarseImage.size()), coarseDpi);
+		if (!image.isNull()) {
+			if (imageDpi == newDpi) {
+				QRect r = event->rect() & imageRect;
+				painter.drawImage(r, image, r.translated(-imageRect.topLeft()));
+			}
+			else
+				drawScaledImage(painter, image, imageRect, imageDpi);
+		}
+	}
 
 	if (!highlightPath.isEmpty()) {
 		painter.setRenderHint(QPainter::Antialiasing);
@@ -345,16 +391,14 @@ void PDFWidget::mousePressEvent(QMouseEvent *event)
 	
 	// Context-specific behavior comes second
 	if (!handled && page) {
-		foreach (Poppler::Link* link, page->links()) {
-			// poppler's linkArea is relative to the page rect, it seems
-			QPointF scaledPos(event->pos().x() / scaleFactor / dpi * 72.0 / page->pageSizeF().width(),
-								event->pos().y() / scaleFactor / dpi * 72.0 / page->pageSizeF().height());
-			if (link->linkArea().contains(scaledPos)) {
-				clickedLink = link;
-				// opening the link is handled in mouseReleaseEvent
-				handled = true;
-				break;
-			}
+		// poppler's linkArea is relative to the page rect, it seems
+		QPointF scaledPos(event->pos().x() / scaleFactor / dpi * 72.0 / page->pageSizeF().width(),
+							event->pos().y() / scaleFactor / dpi * 72.0 / page->pageSizeF().height());
+		const Poppler::Link *link = linkIndex.linkAt(scaledPos);
+		if (link != NULL) {
+			clickedLink = link;
+			// opening the link is handled in mouseReleaseEvent
+			handled = true;
 		}
 	}
 	
@@ -443,13 +487,15 @@ void PDFWidget::goToDestination(const Poppler::LinkDestination& dest)
 		}
 		QScrollArea*	scrollArea = getScrollArea();
 		if (scrollArea) {
+			// in a page strip, the page doesn't start at the top of the scrolled area
+			QPoint origin = mapTo(scrollArea->widget(), QPoint(0, 0));
 			if (dest.isChangeLeft()) {
 				int destLeft = (int)floor(dest.left() * scaleFactor * dpi / 72.0 * page->pageSizeF().width());
-				scrollArea->horizontalScrollBar()->setValue(destLeft);
+				scrollArea->horizontalScrollBar()->setValue(origin.x() + destLeft);
 			}
 			if (dest.isChangeTop()) {
 				int destTop = (int)floor(dest.top() * scaleFactor * dpi / 72.0 * page->pageSizeF().height());
-				scrollArea->verticalScrollBar()->setValue(destTop);
+				scrollArea->verticalScrollBar()->setValue(origin.y() + destTop);
 			}
 		}
 	}
@@ -526,8 +572,7 @@ void PDFWidget::mouseMoveEvent(QMouseEvent *event)
 	switch (usingTool) {
 		case kMagnifier:
 			{
-				QRect viewportClip(mapFromParent(parentWidget()->rect().topLeft()),
-									mapFromParent(parentWidget()->rect().bottomRight() - QPoint(1, 1)));
+				QRect viewportClip = visibleRect().adjusted(0, 0, -1, -1);
 				QPoint constrainedLoc = event->pos();
 				if (constrainedLoc.x() < viewportClip.left())
 					constrainedLoc.setX(viewportClip.left());
@@ -628,7 +673,8 @@ void PDFWidget::jumpToSource()
 void PDFWidget::wheelEvent(QWheelEvent *event)
 {
 	static QTime lastScrollTime = QTime::currentTime();
-	bool mayChangePage = true;
+	// in a page strip, the other pages are simply scrolled into view
+	bool mayChangePage = (pageStrip() == NULL);
 	int numDegrees = event->delta() / 8;
 	int numSteps = numDegrees / 15;
 	QScrollBar *scrollBar = (event->orientation() == Qt::Horizontal)
@@ -697,27 +743,26 @@ void PDFWidget::updateCursor(const QPoint& pos)
 	// Context-specific behavior comes second
 	if(page) {
 		// check for link
-		foreach (Poppler::Link* link, page->links()) {
-			// poppler's linkArea is relative to the page rect
-			QPointF scaledPos(pos.x() / scaleFactor / dpi * 72.0 / page->pageSizeF().width(),
-								pos.y() / scaleFactor / dpi * 72.0 / page->pageSizeF().height());
-			if (link->linkArea().contains(scaledPos)) {
-				setCursor(Qt::PointingHandCursor);
-				if (link->linkType() == Poppler::Link::Browse) {
-					QPoint globalPos = mapToGlobal(pos);
-					const Poppler::LinkBrowse *browse = dynamic_cast<const Poppler::LinkBrowse*>(link);
-					Q_ASSERT(browse != NULL);
-					QRectF r = link->linkArea();
-					r.setWidth(r.width() * scaleFactor * dpi / 72.0 * page->pageSizeF().width());
-					r.setHeight(r.height() * scaleFactor * dpi / 72.0 * page->pageSizeF().height());
-					r.moveLeft(r.left() * scaleFactor * dpi / 72.0 * page->pageSizeF().width());
-					r.moveTop(r.top() * scaleFactor * dpi / 72.0 * page->pageSizeF().height());
-					QRect rr = r.toRect().normalized();
-					rr.setTopLeft(mapToGlobal(rr.topLeft()));
-					QToolTip::showText(globalPos, browse->url(), this, rr);
-				}
-				return;
+		// poppler's linkArea is relative to the page rect
+		QPointF scaledPos(pos.x() / scaleFactor / dpi * 72.0 / page->pageSizeF().width(),
+							pos.y() / scaleFactor / dpi * 72.0 / page->pageSizeF().height());
+		const Poppler::Link *link = linkIndex.linkAt(scaledPos);
+		if (link != NULL) {
+			setCursor(Qt::PointingHandCursor);
+			if (link->linkType() == Poppler::Link::Browse) {
+				QPoint globalPos = mapToGlobal(pos);
+				const Poppler::LinkBrowse *browse = dynamic_cast<const Poppler::LinkBrowse*>(link);
+				Q_ASSERT(browse != NULL);
+				QRectF r = link->linkArea();
+				r.setWidth(r.width() * scaleFactor * dpi / 72.0 * page->pageSizeF().width());
+				r.setHeight(r.height() * scaleFactor * dpi / 72.0 * page->pageSizeF().height());
+				r.moveLeft(r.left() * scaleFactor * dpi / 72.0 * page->pageSizeF().width());
+				r.moveTop(r.top() * scaleFactor * dpi / 72.0 * page->pageSizeF().height());
+				QRect rr = r.toRect().normalized();
+				rr.setTopLeft(mapToGlobal(rr.topLeft()));
+				QToolTip::showText(globalPos, browse->url(), this, rr);
 			}
+			return;
 		}
 	}
 
@@ -748,6 +793,100 @@ void PDFWidget::adjustSize()
 		if (pageSize != size())
 			resize(pageSize);
 	}
+	PDFPageStrip *strip = pageStrip();
+	if (strip != NULL)
+		strip->relayout();
+}
+
+void PDFWidget::adoptImage(const QImage& pageImage, qreal pageDpi)
+{
+	if (page == NULL || pageImage.isNull())
+		return;
+	if (pageDpi == dpi * scaleFactor) {
+		image = pageImage;
+		imagePage = page;
+		imageDpi = pageDpi;
+		imageRect = QRect(QPoint(0, 0), pageImage.size());
+	}
+	else {
+		coarseImage = pageImage;
+		coarseDpi = pageDpi;
+	}
+}
+
+void PDFWidget::setRenderer(PDFRenderer *pageRenderer)
+{
+	if (renderer != NULL)
+		disconnect(renderer, SIGNAL(pageRendered(int, double, const QRect&, const QImage&)),
+				   this, SLOT(pageRendered(int, double, const QRect&, const QImage&)));
+	renderer = pageRenderer;
+	if (renderer != NULL)
+		connect(renderer, SIGNAL(pageRendered(int, double, const QRect&, const QImage&)),
+				this, SLOT(pageRendered(int, double, const QRect&, const QImage&)));
+}
+
+QRect PDFWidget::renderRect(const QRect& visible)
+{
+	// a margin around the visible part, so scrolling a little needs no new image
+	int dx = visible.width() / 4;
+	int dy = visible.height() / 4;
+	return visible.adjusted(-dx, -dy, dx, dy) & rect();
+}
+
+void PDFWidget::drawScaledImage(QPainter& painter, const QImage& img, const QRect& region, qreal imgDpi)
+{
+	qreal f = dpi * scaleFactor / imgDpi;
+	painter.drawImage(QRectF(region.x() * f, region.y() * f, region.width() * f, region.height() * f), img);
+}
+
+void PDFWidget::requestRender(const QRect& visible)
+{
+	qreal newDpi = dpi * scaleFactor;
+	if (pendingDpi == newDpi && pendingRect.contains(visible))
+		return;
+
+	// anything still queued for this page is for an old position or scale
+	renderer->cancelPage(pageIndex);
+	pendingCoarseDpi = 0;
+	requestCoarseImage();
+	pendingRect = renderRect(visible);
+	pendingDpi = newDpi;
+	renderer->requestPage(pageIndex, pendingDpi, pendingRect);
+}
+
+void PDFWidget::requestCoarseImage()
+{
+	qreal newDpi = dpi * scaleFactor;
+	if (imageDpi == newDpi && imageRect == rect())
+		return; // the sharp image already covers the whole page
+	qreal wantedDpi = PDFRenderer::cappedDpi(page->pageSizeF(), newDpi, kMaxCoarsePixels);
+	if (wantedDpi < newDpi && coarseDpi != wantedDpi && pendingCoarseDpi != wantedDpi) {
+		pendingCoarseDpi = wantedDpi;
+		renderer->requestPage(pageIndex, wantedDpi, QRect(QPoint(0, 0), (page->pageSizeF() * wantedDpi / 72.0).toSize()));
+	}
+}
+
+void PDFWidget::pageRendered(int index, double renderedDpi, const QRect& region, const QImage& renderedImage)
+{
+	// whole pages are rendered for the views of a page strip
+	if (region.isNull() || index != pageIndex || page == NULL)
+		return;
+	qreal newDpi = dpi * scaleFactor;
+	if (renderedDpi == newDpi && region == pendingRect) {
+		image = renderedImage;
+		imagePage = page;
+		imageDpi = renderedDpi;
+		imageRect = region;
+		pendingRect = QRect();
+		pendingDpi = 0;
+		update();
+	}
+	else if (renderedDpi < newDpi && renderedDpi == PDFRenderer::cappedDpi(page->pageSizeF(), newDpi, kMaxCoarsePixels)) {
+		coarseImage = renderedImage;
+		coarseDpi = renderedDpi;
+		pendingCoarseDpi = 0;
+		update();
+	}
 }
 
 void PDFWidget::resetMagnifier()
@@ -773,8 +912,9 @@ void PDFWidget::setHighlightPath(const QPainterPath& path)
 		QScrollArea*	scrollArea = getScrollArea();
 		if (scrollArea) {
 			QRectF r = path.boundingRect();
-			scrollArea->ensureVisible((int)((r.left() + r.right()) / 2 * dpi / 72 * scaleFactor),
-										(int)((r.top() + r.bottom()) / 2 * dpi / 72 * scaleFactor));
+			QPoint origin = mapTo(scrollArea->widget(), QPoint(0, 0));
+			scrollArea->ensureVisible(origin.x() + (int)((r.left() + r.right()) / 2 * dpi / 72 * scaleFactor),
+										origin.y() + (int)((r.top() + r.bottom()) / 2 * dpi / 72 * scaleFactor));
 		}
 		if (kPDFHighlightDuration > 0)
 			highlightRemover.start(kPDFHighlightDuration);
@@ -789,6 +929,15 @@ void PDFWidget::clearHighlight()
 
 void PDFWidget::reloadPage()
 {
+	PDFPageStrip *strip = pageStrip();
+	if (strip != NULL && page != NULL) {
+		if (!coarseImage.isNull())
+			strip->keepImage(coarseImage, coarseDpi);
+		else if (imagePage == page && imageRect == rect())
+			strip->keepImage(image, imageDpi);
+	}
+	linkIndex.setPage(NULL);
+	clickedLink = NULL;
 	if (page != NULL)
 		delete page;
 	page = NULL;
@@ -796,6 +945,11 @@ void PDFWidget::reloadPage()
 		magnifier->setPage(NULL, 0);
 	imagePage = NULL;
 	image = QImage();
+	coarseImage = QImage();
+	coarseDpi = 0;
+	pendingRect = QRect();
+	pendingDpi = 0;
+	pendingCoarseDpi = 0;
 	highlightPath = QPainterPath();
 	if (document != NULL) {
 		if (pageIndex >= document->numPages())
@@ -803,6 +957,7 @@ void PDFWidget::reloadPage()
 		if (pageIndex >= 0)
 			page = document->page(pageIndex);
 	}
+	linkIndex.setPage(page);
 	adjustSize();
 	update();
 	updateStatusBar();
@@ -862,7 +1017,7 @@ void PDFWidget::upOrPrev()
 	QScrollBar*		scrollBar = getScrollArea()->verticalScrollBar();
 	if (scrollBar->value() > scrollBar->minimum())
 		scrollBar->triggerAction(QAbstractSlider::SliderSingleStepSub);
-	else {
+	else if (pageStrip() == NULL) {
 		if (pageIndex > 0) {
 			goPrev();
 			scrollBar->triggerAction(QAbstractSlider::SliderToMaximum);
@@ -878,7 +1033,7 @@ void PDFWidget::leftOrPrev()
 	QScrollBar*		scrollBar = getScrollArea()->horizontalScrollBar();
 	if (scrollBar->value() > scrollBar->minimum())
 		scrollBar->triggerAction(QAbstractSlider::SliderSingleStepSub);
-	else {
+	else if (pageStrip() == NULL) {
 		if (pageIndex > 0) {
 			goPrev();
 			scrollBar->triggerAction(QAbstractSlider::SliderToMaximum);
@@ -894,7 +1049,7 @@ void PDFWidget::downOrNext()
 	QScrollBar*		scrollBar = getScrollArea()->verticalScrollBar();
 	if (scrollBar->value() < scrollBar->maximum())
 		scrollBar->triggerAction(QAbstractSlider::SliderSingleStepAdd);
-	else {
+	else if (pageStrip() == NULL) {
 		if (pageIndex < document->numPages() - 1) {
 			goNext();
 			scrollBar->triggerAction(QAbstractSlider::SliderToMinimum);
@@ -910,7 +1065,7 @@ void PDFWidget::rightOrNext()
 	QScrollBar*		scrollBar = getScrollArea()->horizontalScrollBar();
 	if (scrollBar->value() < scrollBar->maximum())
 		scrollBar->triggerAction(QAbstractSlider::SliderSingleStepAdd);
-	else {
+	else if (pageStrip() == NULL) {
 		if (pageIndex < document->numPages() - 1) {
 			goNext();
 			scrollBar->triggerAction(QAbstractSlider::SliderToMinimum);
@@ -964,6 +1119,11 @@ void PDFWidget::fitWidth(bool checked)
 		if (scrollArea && page != NULL) {
 			qreal portWidth = scrollArea->viewport()->width();
 			QSizeF	pageSize = page->pageSizeF() * dpi / 72.0;
+			PDFPageStrip *strip = pageStrip();
+			if (strip != NULL) {
+				portWidth -= strip->horizontalSpacing();
+				pageSize.rwidth() *= strip->columns();
+			}
 			scaleFactor = portWidth / pageSize.width();
 			if (scaleFactor < kMinScaleFactor)
 				scaleFactor = kMinScaleFactor;
@@ -989,6 +1149,11 @@ void PDFWidget::fitWindow(bool checked)
 			qreal portWidth = scrollArea->viewport()->width();
 			qreal portHeight = scrollArea->viewport()->height();
 			QSizeF	pageSize = page->pageSizeF() * dpi / 72.0;
+			PDFPageStrip *strip = pageStrip();
+			if (strip != NULL) {
+				portWidth -= strip->horizontalSpacing();
+				pageSize.rwidth() *= strip->columns();
+			}
 			qreal sfh = portWidth / pageSize.width();
 			qreal sfv = portHeight / pageSize.height();
 			scaleFactor = sfh < sfv ? sfh : sfv;
@@ -1052,20 +1217,16 @@ void PDFWidget::doZoom(const QPoint& clickPos, int dir) // dir = 1 for in, -1 fo
 
 void PDFWidget::zoomIn()
 {
-	QWidget *parent = parentWidget();
-	if (parent != NULL) {
-		QPoint ctr = mapFromParent(QPoint(parent->width() / 2, parent->height() / 2));
-		doZoom(ctr, 1);
-	}
+	QRect visible = visibleRect();
+	if (visible.isValid())
+		doZoom(visible.center(), 1);
 }
 
 void PDFWidget::zoomOut()
 {
-	QWidget *parent = parentWidget();
-	if (parent != NULL) {
-		QPoint ctr = mapFromParent(QPoint(parent->width() / 2, parent->height() / 2));
-		doZoom(ctr, -1);
-	}
+	QRect visible = visibleRect();
+	if (visible.isValid())
+		doZoom(visible.center(), -1);
 }
 
 void PDFWidget::saveState()
@@ -1089,11 +1250,29 @@ void PDFWidget::restoreState()
 
 QScrollArea* PDFWidget::getScrollArea()
 {
+	// the viewport's parent; in a page strip there is one more level
 	QWidget* parent = parentWidget();
-	if (parent != NULL)
-		return qobject_cast<QScrollArea*>(parent->parentWidget());
-	else
-		return NULL;
+	while (parent != NULL) {
+		QScrollArea *scrollArea = qobject_cast<QScrollArea*>(parent);
+		if (scrollArea != NULL)
+			return scrollArea;
+		parent = parent->parentWidget();
+	}
+	return NULL;
+}
+
+PDFPageStrip* PDFWidget::pageStrip()
+{
+	return qobject_cast<PDFPageStrip*>(parentWidget());
+}
+
+QRect PDFWidget::visibleRect()
+{
+	QScrollArea*	scrollArea = getScrollArea();
+	if (scrollArea == NULL)
+		return QRect();
+	QWidget *viewport = scrollArea->viewport();
+	return QRect(mapFrom(viewport, QPoint(0, 0)), viewport->size());
 }
 
 
@@ -1195,6 +1374,9 @@ PDFDocument::init()
 	connect(scrollArea, SIGNAL(resized()), pdfWidget, SLOT(windowResized()));
 
 	document = NULL;
+	pageStrip = NULL;
+	renderer = new PDFRenderer(this);
+	pdfWidget->setRenderer(renderer);
 	
 	connect(actionAbout_TW, SIGNAL(triggered()), qApp, SLOT(about()));
 	connect(actionSettings_and_Resources, SIGNAL(triggered()), qApp, SLOT(doResourcesDialog()));
@@ -1223,6 +1405,15 @@ PDFDocument::init()
 	connect(actionZoom_In, SIGNAL(triggered()), pdfWidget, SLOT(zoomIn()));
 	connect(actionZoom_Out, SIGNAL(triggered()), pdfWidget, SLOT(zoomOut()));
 	connect(actionFull_Screen, SIGNAL(triggered()), this, SLOT(toggleFullScreen()));
+
+	QActionGroup *pageModeGroup = new QActionGroup(this);
+	actionSingle_Page->setData(kSinglePage);
+	pageModeGroup->addAction(actionSingle_Page);
+	actionContinuous->setData(kContinuous);
+	pageModeGroup->addAction(actionContinuous);
+	actionTwo_Pages->setData(kTwoPages);
+	pageModeGroup->addAction(actionTwo_Pages);
+	connect(pageModeGroup, SIGNAL(triggered(QAction*)), this, SLOT(pageModeSelected(QAction*)));
 	connect(pdfWidget, SIGNAL(changedZoom(qreal)), this, SLOT(enableZoomActions(qreal)));
 	connect(pdfWidget, SIGNAL(changedScaleOption(autoScaleOption)), this, SLOT(adjustScaleActions(autoScaleOption)));
 	connect(pdfWidget, SIGNAL(syncClick(int, const QPointF&)), this, SLOT(syncClick(int, const QPointF&)));
@@ -1242,12 +1433,12 @@ PDFDocument::init()
 	connect(actionFind_Again, SIGNAL(triggered()), this, SLOT(doFindAgain()));
 
 	menuRecent = new QMenu(tr("Open Recent"), this);
-	updateRecentFileActions();
 	menuFile->insertMenu(actionOpen_Recent, menuRecent);
 	menuFile->removeAction(actionOpen_Recent);
 
-	connect(qApp, SIGNAL(recentFileActionsChanged()), this, SLOT(updateRecentFileActions()));
-	connect(qApp, SIGNAL(windowListChanged()), this, SLOT(updateWindowMenu()));
+	// both lists are shared by all windows; fill them in only when needed
+	connect(menuRecent, SIGNAL(aboutToShow()), this, SLOT(updateRecentFileActions()));
+	connect(menuWindow, SIGNAL(aboutToShow()), this, SLOT(updateWindowMenu()));
 
 	connect(qApp, SIGNAL(hideFloatersExcept(QWidget*)), this, SLOT(hideFloatersUnlessThis(QWidget*)));
 	connect(this, SIGNAL(activatedWindow(QWidget*)), qApp, SLOT(activatedWindow(QWidget*)));
@@ -1268,6 +1459,13 @@ PDFDocument::init()
 	connect(this, SIGNAL(reloaded()), dw, SLOT(documentLoaded()));
 	connect(pdfWidget, SIGNAL(changedPage(int)), dw, SLOT(pageChanged(int)));
 
+	dw = new PDFThumbnailDock(this);
+	dw->hide();
+	addDockWidget(Qt::LeftDockWidgetArea, dw);
+	menuShow->addAction(dw->toggleViewAction());
+	connect(this, SIGNAL(reloaded()), dw, SLOT(documentLoaded()));
+	connect(pdfWidget, SIGNAL(changedPage(int)), dw, SLOT(pageChanged(int)));
+
 	dw = new PDFInfoDock(this);
 	dw->hide();
 	addDockWidget(Qt::LeftDockWidgetArea, dw);
@@ -1287,6 +1485,13 @@ PDFDocument::init()
 	QSETTINGS_OBJECT(settings);
 	TWUtils::applyToolbarOptions(this, settings.value("toolBarIconSize", 2).toInt(), settings.value("toolBarShowText", false).toBool());
 
+	int pageMode = settings.value("pdfPageMode", kDefault_PDFPageMode).toInt();
+	foreach (QAction *action, pageModeGroup->actions()) {
+		if (action->data().toInt() == pageMode)
+			action->setChecked(true);
+	}
+	setPageMode(pageMode);
+
 	TWApp::instance()->updateWindowMenus();
 	
 	initScriptable(menuScripts, actionAbout_Scripts, actionManage_Scripts,
@@ -1396,6 +1601,18 @@ void PDFDocument::loadFile(const QString &fileName)
 }
 
 void PDFDocument::reload()
+{
+	previewFile.clear();
+	loadPdf();
+}
+
+void PDFDocument::showLivePreview(const QString& pdfFile)
+{
+	previewFile = pdfFile;
+	loadPdf();
+}
+
+void PDFDocument::loadPdf()
 {
 	QApplication::setOverrideCursor(Qt::WaitCursor);
 
@@ -1407,7 +1624,7 @@ void PDFDocument::reload()
 	if (document != NULL)
 		delete document;
 
-	document = Poppler::Document::load(curFile);
+	document = Poppler::Document::load(loadedFile());
 	if (document != NULL) {
 		if (document->isLocked()) {
 			delete document;
@@ -1422,6 +1639,13 @@ void PDFDocument::reload()
 			document->setRenderHint(Poppler::Document::TextAntialiasing);
 //			globalParams->setScreenType(screenDispersed);
 
+			// live previews change with every keystroke; they are not worth keeping
+			QSETTINGS_OBJECT(settings);
+			bool diskCache = settings.value("pdfRenderCache", kDefault_RenderCache).toBool() && !showingLivePreview();
+			if (diskCache)
+				PDFRenderCache::instance()->setSizeLimit(settings.value("pdfRenderCacheSize", kDefault_RenderCacheSize).toLongLong() * 1024 * 1024);
+			renderer->setUseDiskCache(diskCache);
+			renderer->setFileName(loadedFile());
 			pdfWidget->setDocument(document);
 			pdfWidget->show();
 			pdfWidget->setFocus();
@@ -1453,7 +1677,7 @@ void PDFDocument::reloadWhenIdle()
 
 void PDFDocument::loadSyncData()
 {
-	scanner = synctex_scanner_new_with_output_file(curFile.toUtf8().data(), NULL, 1);
+	scanner = synctex_scanner_new_with_output_file(loadedFile().toUtf8().data(), NULL, 1);
 	if (scanner == NULL)
 		statusBar()->showMessage(tr("No SyncTeX data available"), kStatusMessageDuration);
 	else {
@@ -1462,6 +1686,26 @@ void PDFDocument::loadSyncData()
 	}
 }
 
+QString PDFDocument::syncSourcePath(const QString& name) const
+{
+	QFileInfo fi(QFileInfo(loadedFile()).absoluteDir(), name);
+	if (!previewFile.isEmpty()) {
+		// shadow copies of a live preview stand in for the files next to curFile
+		QString relPath = QFileInfo(previewFile).absoluteDir().relativeFilePath(fi.absoluteFilePath());
+		if (!relPath.startsWith(".."))
+			fi = QFileInfo(QFileInfo(curFile).absoluteDir(), relPath);
+	}
+	else {
+		// files read back from the directory of an in-memory build, if the
+		// document has a copy of them
+		QString relPath = QDir(BuildDirectory::pathFor(curFile)).relativeFilePath(fi.absoluteFilePath());
+		QFileInfo sourceInfo(QFileInfo(curFile).absoluteDir(), relPath);
+		if (!relPath.startsWith("..") && sourceInfo.exists())
+			fi = sourceInfo;
+	}
+	return fi.canonicalFilePath();
+}
+
 void PDFDocument::syncClick(int pageIndex, const QPointF& pos)
 {
 	if (scanner == NULL)
@@ -1472,8 +1716,7 @@ void PDFDocument::syncClick(int pageIndex, const QPointF& pos)
 		synctex_node_t node;
 		while ((node = synctex_next_result(scanner)) != NULL) {
 			QString filename = QString::fromUtf8(synctex_scanner_get_name(scanner, synctex_node_tag(node)));
-			QDir curDir(QFileInfo(curFile).canonicalPath());
-			TeXDocument::openDocument(QFileInfo(curDir, filename).canonicalFilePath(), true, true, synctex_node_line(node));
+			TeXDocument::openDocument(syncSourcePath(filename), true, true, synctex_node_line(node));
 			break; // FIXME: currently we just take the first hit
 		}
 	}
@@ -1486,13 +1729,12 @@ void PDFDocument::syncFromSource(const QString& sourceFile, int lineNo, bool act
 
 	// find the name synctex is using for this source file...
 	const QFileInfo sourceFileInfo(sourceFile);
-	QDir curDir(QFileInfo(curFile).canonicalPath());
 	synctex_node_t node = synctex_scanner_input(scanner);
 	QString name;
 	bool found = false;
 	while (node != NULL) {
 		name = QString::fromUtf8(synctex_scanner_get_name(scanner, synctex_node_tag(node)));
-		const QFileInfo fi(curDir, name);
+		const QFileInfo fi(syncSourcePath(name));
 		if (fi == sourceFileInfo) {
 			found = true;
 			break;
@@ -1613,6 +1855,43 @@ void PDFDocument::adjustScaleActions(autoScaleOption scaleOption)
 	actionFit_to_Width->setChecked(scaleOption == kFitWidth);
 }
 
+void PDFDocument::pageModeSelected(QAction *action)
+{
+	int mode = action->data().toInt();
+	QSETTINGS_OBJECT(settings);
+	settings.setValue("pdfPageMode", mode);
+	setPageMode(mode);
+}
+
+void PDFDocument::setPageMode(int mode)
+{
+	int columns = (mode == kTwoPages) ? 2 : (mode == kContinuous) ? 1 : 0;
+	if (pageStrip != NULL ? pageStrip->columns() == columns : columns == 0)
+		return;
+
+	bool hidden = pdfWidget->isHidden();
+	scrollArea->takeWidget();
+	if (pageStrip != NULL) {
+		pdfWidget->setParent(NULL);
+		delete pageStrip;
+		pageStrip = NULL;
+	}
+
+	if (columns > 0) {
+		pageStrip = new PDFPageStrip(pdfWidget, renderer, scrollArea, columns);
+		pageStrip->setDocument(document);
+		scrollArea->setWidget(pageStrip);
+	}
+	else
+		scrollArea->setWidget(pdfWidget);
+	pdfWidget->setHidden(hidden);
+	if (document != NULL) {
+		pdfWidget->windowResized();
+		// places the page in the strip and scrolls to it
+		pdfWidget->reloadPage();
+	}
+}
+
 void PDFDocument::toggleFullScreen()
 {
 	if (windowState() & Qt::WindowFullScreen) {
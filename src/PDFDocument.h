@@ -34,6 +34,7 @@
 #include <QMouseEvent>
 
 #include "FindDialog.h"
+#include "PDFLinkIndex.h"
 #include "poppler-qt4.h"
 #include "synctex_parser.h"
 
@@ -43,9 +44,19 @@ const int kDefault_MagnifierSize = 2;
 const bool kDefault_CircularMagnifier = true;
 const int kDefault_PreviewScaleOption = 1;
 const int kDefault_PreviewScale = 200;
+const bool kDefault_RenderCache = true;
+const int kDefault_RenderCacheSize = 256;	// megabytes
 
 const int kPDFWindowStateVersion = 1;
 
+// how the pages of a PDF are arranged in its window
+enum PDFPageMode {
+	kSinglePage = 0,
+	kContinuous = 1,
+	kTwoPages = 2
+};
+const int kDefault_PDFPageMode = kSinglePage;
+
 class QAction;
 class QMenu;
 class QToolBar;
@@ -53,6 +64,9 @@ class QScrollArea;
 class TeXDocument;
 class QShortcut;
 class QFileSystemWatcher;
+class QPainter;
+class PDFPageStrip;
+class PDFRenderer;
 
 class PDFMagnifier : public QLabel
 {
@@ -102,8 +116,15 @@ public:
 	void setHighlightPath(const QPainterPath& path);
 	void goToDestination(const QString& destName);
 	int getCurrentPageIndex() { return pageIndex; }
+	qreal getRenderDpi() const { return dpi * scaleFactor; }
 	void reloadPage();
 	void updateStatusBar();
+	// use an image of the whole current page rendered elsewhere; unless it
+	// has the current resolution, it's only shown until a sharp one is ready
+	void adoptImage(const QImage& pageImage, qreal pageDpi);
+	void setRenderer(PDFRenderer *pageRenderer);
+	// the part of the widget shown in the scroll area's viewport
+	QRect visibleRect();
 
 private slots:
 	void goFirst();
@@ -122,6 +143,8 @@ private slots:
 	void rightOrNext();
 
 	void clearHighlight();
+
+	void pageRendered(int index, double renderedDpi, const QRect& region, const QImage& renderedImage);
 	
 public slots:
 	void windowResized();
@@ -162,10 +185,16 @@ private:
 	void doLink(const Poppler::Link *link);
 	void doZoom(const QPoint& clickPos, int dir);
 	QScrollArea* getScrollArea();
+	PDFPageStrip* pageStrip();
+	QRect renderRect(const QRect& visible);
+	void requestRender(const QRect& visible);
+	void requestCoarseImage();
+	void drawScaledImage(QPainter& painter, const QImage& img, const QRect& region, qreal imgDpi);
 	
 	Poppler::Document	*document;
 	Poppler::Page		*page;
-	Poppler::Link		*clickedLink;
+	const Poppler::Link	*clickedLink;
+	PDFLinkIndex		linkIndex;
 
 	int pageIndex;
 	qreal	scaleFactor;
@@ -182,10 +211,18 @@ private:
 	QShortcut *shortcutDown;
 	QShortcut *shortcutRight;
 	
+	// only the visible part of the page (plus a margin) is rendered sharply;
+	// a low-resolution image of the whole page fills in while scrolling
 	QImage	image;
 	QRect	imageRect;
 	qreal	imageDpi;
 	Poppler::Page	*imagePage;
+	QImage	coarseImage;
+	qreal	coarseDpi;
+	QRect	pendingRect;	// requested from the renderer, not yet delivered
+	qreal	pendingDpi;
+	qreal	pendingCoarseDpi;
+	PDFRenderer	*renderer;
 
 	PDFMagnifier	*magnifier;
 	int		currentTool;	// the current tool selected in the toolbar
@@ -228,6 +265,14 @@ public:
 	void updateTypesettingAction(bool processRunning);
 	void goToDestination(const QString& destName);
 	void linkToSource(TeXDocument *texDoc);
+	// show a PDF typeset from unsaved buffers in place of fileName() until
+	// the next reload
+	void showLivePreview(const QString& pdfFile);
+	bool showingLivePreview() const
+		{ return !previewFile.isEmpty(); }
+	// the file actually shown, which is not fileName() during a live preview
+	QString loadedFile() const
+		{ return previewFile.isEmpty() ? curFile : previewFile; }
 	bool hasSyncData()
 		{
 			return scanner != NULL;
@@ -274,6 +319,7 @@ private slots:
 	void scaleLabelClick(QMouseEvent * event) { showScaleContextMenu(event->pos()); }
 	void showScaleContextMenu(const QPoint pos);
 	void setScaleFromContextMenu(const QString & strZoom);
+	void pageModeSelected(QAction *action);
 
 signals:
 	void reloaded();
@@ -283,15 +329,21 @@ private:
 	void init();
 	void loadFile(const QString &fileName);
 	void setCurrentFile(const QString &fileName);
+	void loadPdf();
 	void loadSyncData();
+	QString syncSourcePath(const QString& name) const;
 	void saveRecentFileInfo();
+	void setPageMode(int mode);
 
 	QString curFile;
+	QString previewFile;
 	
 	Poppler::Document	*document;
 	
 	PDFWidget	*pdfWidget;
 	QScrollArea	*scrollArea;
+	PDFPageStrip	*pageStrip;	// NULL in single page mode
+	PDFRenderer	*renderer;
 	QButtonGroup	*toolButtonGroup;
 
 	QList<TeXDocument*> sourceDocList;
@@ -0,0 +1,127 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+
+#include "PDFFontScanner.h"
+
+#include <QMutexLocker>
+#include <QMetaType>
+#include <QTime>
+
+const int kFontBatchInterval = 200;	// msecs between two batches of fonts
+
+PDFFontScanner::PDFFontScanner(QObject *parent)
+	: QThread(parent), generation(0), scannedGeneration(0), stopping(false)
+{
+	qRegisterMetaType< QList<Poppler::FontInfo> >("QList<Poppler::FontInfo>");
+	connect(this, SIGNAL(fontsScanned(int, const QList<Poppler::FontInfo>&)),
+			this, SLOT(deliverFonts(int, const QList<Poppler::FontInfo>&)), Qt::QueuedConnection);
+	connect(this, SIGNAL(scanDone(int)), this, SLOT(deliverFinished(int)), Qt::QueuedConnection);
+}
+
+PDFFontScanner::~PDFFontScanner()
+{
+	mutex.lock();
+	stopping = true;
+	condition.wakeAll();
+	mutex.unlock();
+	wait();
+}
+
+void PDFFontScanner::setFileName(const QString& newFileName)
+{
+	QMutexLocker locker(&mutex);
+	fileName = newFileName;
+	++generation;
+	if (!isRunning())
+		start(QThread::LowPriority);
+	condition.wakeOne();
+}
+
+void PDFFontScanner::cancel()
+{
+	QMutexLocker locker(&mutex);
+	++generation;
+	// nothing left to scan
+	scannedGeneration = generation;
+}
+
+bool PDFFontScanner::isCurrent(int scanGeneration)
+{
+	QMutexLocker locker(&mutex);
+	return scanGeneration == generation && !stopping;
+}
+
+void PDFFontScanner::deliverFonts(int scanGeneration, const QList<Poppler::FontInfo>& fonts)
+{
+	if (isCurrent(scanGeneration))
+		emit fontsFound(fonts);
+}
+
+void PDFFontScanner::deliverFinished(int scanGeneration)
+{
+	if (isCurrent(scanGeneration))
+		emit scanFinished();
+}
+
+void PDFFontScanner::run()
+{
+	mutex.lock();
+	while (!stopping) {
+		if (scannedGeneration == generation) {
+			condition.wait(&mutex);
+			continue;
+		}
+		int scanGeneration = generation;
+		QString scanFile = fileName;
+		scannedGeneration = scanGeneration;
+		mutex.unlock();
+
+		Poppler::Document *document = Poppler::Document::load(scanFile);
+		if (document != NULL && document->isLocked()) {
+			delete document;
+			document = NULL;
+		}
+		if (document != NULL) {
+			// the iterator reports each font only on the first page that uses it
+			Poppler::FontIterator *iterator = document->newFontIterator();
+			QList<Poppler::FontInfo> batch;
+			QTime timer;
+			timer.start();
+			while (iterator->hasNext() && isCurrent(scanGeneration)) {
+				batch += iterator->next();
+				if (!batch.isEmpty() && timer.elapsed() >= kFontBatchInterval) {
+					emit fontsScanned(scanGeneration, batch);
+					batch.clear();
+					timer.restart();
+				}
+			}
+			if (!batch.isEmpty())
+				emit fontsScanned(scanGeneration, batch);
+			delete iterator;
+			delete document;
+		}
+		emit scanDone(scanGeneration);
+
+		mutex.lock();
+	}
+	mutex.unlock();
+}
@@ -0,0 +1,74 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#ifndef PDFFontScanner_H
+#define PDFFontScanner_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+
+#include "poppler-qt4.h"
+
+// Lists the fonts of a PDF file on a worker thread. Like PDFRenderer, the
+// worker opens its own copy of the file. The fonts are passed on in batches
+// while the pages are scanned, each font only once; results of a scan that
+// was started before the last setFileName() or cancel() are never delivered.
+class PDFFontScanner : public QThread
+{
+	Q_OBJECT
+
+public:
+	PDFFontScanner(QObject *parent = NULL);
+	virtual ~PDFFontScanner();
+
+	// start scanning fileName, abandoning any scan that is still running
+	void setFileName(const QString& fileName);
+	void cancel();
+
+signals:
+	void fontsFound(const QList<Poppler::FontInfo>& fonts);
+	void scanFinished();
+
+	// emitted by the worker; only results of the current scan are passed on
+	void fontsScanned(int generation, const QList<Poppler::FontInfo>& fonts);
+	void scanDone(int generation);
+
+private slots:
+	void deliverFonts(int generation, const QList<Poppler::FontInfo>& fonts);
+	void deliverFinished(int generation);
+
+protected:
+	virtual void run();
+
+private:
+	bool isCurrent(int scanGeneration);
+
+	QMutex mutex;
+	QWaitCondition condition;
+	QString fileName;
+	int generation;
+	int scannedGeneration;	// the last generation the worker has started to scan
+	bool stopping;
+};
+
+#endif
@@ -0,0 +1,98 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#include "PDFLinkIndex.h"
+
+#include <math.h>
+
+const int kMaxGridSize = 64;
+
+PDFLinkIndex::PDFLinkIndex()
+	: page(NULL), built(false), gridSize(0)
+{
+}
+
+PDFLinkIndex::~PDFLinkIndex()
+{
+	clear();
+}
+
+void PDFLinkIndex::setPage(Poppler::Page *p)
+{
+	clear();
+	page = p;
+}
+
+void PDFLinkIndex::clear()
+{
+	qDeleteAll(links);
+	links.clear();
+	areas.clear();
+	cells.clear();
+	gridSize = 0;
+	built = false;
+}
+
+void PDFLinkIndex::build()
+{
+	built = true;
+	if (page == NULL)
+		return;
+
+	links = page->links();
+	if (links.isEmpty())
+		return;
+
+	// about one link per cell if they were evenly spread
+	gridSize = qBound(1, (int)ceil(sqrt((double)links.count())), kMaxGridSize);
+	cells.resize(gridSize * gridSize);
+	areas.reserve(links.count());
+
+	for (int i = 0; i < links.count(); ++i) {
+		QRectF r = links[i]->linkArea().normalized();
+		areas.append(r);
+		int left = qBound(0, (int)floor(r.left() * gridSize), gridSize - 1);
+		int right = qBound(0, (int)floor(r.right() * gridSize), gridSize - 1);
+		int top = qBound(0, (int)floor(r.top() * gridSize), gridSize - 1);
+		int bottom = qBound(0, (int)floor(r.bottom() * gridSize), gridSize - 1);
+		for (int y = top; y <= bottom; ++y)
+			for (int x = left; x <= right; ++x)
+				cells[y * gridSize + x].append(i);
+	}
+}
+
+const Poppler::Link *PDFLinkIndex::linkAt(const QPointF& pos)
+{
+	if (!built)
+		build();
+	if (gridSize == 0 || pos.x() < 0 || pos.x() > 1 || pos.y() < 0 || pos.y() > 1)
+		return NULL;
+
+	int x = qMin((int)(pos.x() * gridSize), gridSize - 1);
+	int y = qMin((int)(pos.y() * gridSize), gridSize - 1);
+	// indices are in page order, so the first hit is the one poppler lists first
+	const QVector<int>& cell = cells[y * gridSize + x];
+	for (int i = 0; i < cell.count(); ++i) {
+		if (areas[cell[i]].contains(pos))
+			return links[cell[i]];
+	}
+	return NULL;
+}
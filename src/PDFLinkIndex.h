@@ -0,0 +1,61 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#ifndef PDFLinkIndex_H
+#define PDFLinkIndex_H
+
+#include <QList>
+#include <QVector>
+#include <QRectF>
+
+#include "poppler-qt4.h"
+
+// The links of one PDF page, extracted once and bucketed into a uniform grid
+// over the page, so hovering or clicking only tests the few links near the
+// mouse. Positions and areas are relative to the page size (0..1), as in
+// Poppler::Link::linkArea().
+class PDFLinkIndex
+{
+public:
+	PDFLinkIndex();
+	~PDFLinkIndex();
+
+	// forget the current links; those of page are extracted on the next lookup
+	void setPage(Poppler::Page *page);
+
+	// the topmost link containing pos, or NULL; the link stays owned by the
+	// index and is valid until the next setPage()
+	const Poppler::Link *linkAt(const QPointF& pos);
+
+private:
+	void clear();
+	void build();
+
+	Poppler::Page *page;
+	bool built;
+
+	QList<Poppler::Link*> links;
+	QVector<QRectF> areas;			// normalized linkArea() of each link
+	QVector< QVector<int> > cells;	// indices into links, row by row
+	int gridSize;					// cells per row and per column
+};
+
+#endif
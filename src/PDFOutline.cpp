@@ -0,0 +1,253 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+
+#include "PDFOutline.h"
+
+#include "poppler-qt4.h"
+
+#include <QDomDocument>
+#include <QMutexLocker>
+#include <QMetaType>
+#include <QVariant>
+
+#pragma mark === PDFOutlineNode ===
+
+PDFOutlineNode::PDFOutlineNode(PDFOutlineNode *parentNode)
+	: open(false), parent(parentNode), row(0)
+{
+}
+
+PDFOutlineNode::~PDFOutlineNode()
+{
+	qDeleteAll(children);
+}
+
+void PDFOutlineNode::addEntries(const QDomNode& tocNode)
+{
+	for (QDomNode node = tocNode.firstChild(); !node.isNull(); node = node.nextSibling()) {
+		QDomElement e = node.toElement();
+
+		PDFOutlineNode *child = new PDFOutlineNode(this);
+		child->row = children.count();
+		children.append(child);
+		child->title = e.tagName();
+		if (e.hasAttribute("Open"))
+			child->open = QVariant(e.attribute("Open")).toBool();
+		if (e.hasAttribute("DestinationName"))
+			child->destination = e.attribute("DestinationName");
+
+		if (node.hasChildNodes())
+			child->addEntries(node);
+	}
+}
+
+bool PDFOutlineNode::sameAs(const PDFOutlineNode& other) const
+{
+	if (title != other.title || destination != other.destination || children.count() != other.children.count())
+		return false;
+	for (int i = 0; i < children.count(); ++i) {
+		if (!children[i]->sameAs(*other.children[i]))
+			return false;
+	}
+	return true;
+}
+
+#pragma mark === PDFOutlineLoader ===
+
+PDFOutlineLoader::PDFOutlineLoader(QObject *parent)
+	: QThread(parent), generation(0), loadedGeneration(0), stopping(false)
+{
+	qRegisterMetaType<PDFOutlineNode*>("PDFOutlineNode*");
+	connect(this, SIGNAL(loaded(int, PDFOutlineNode*)),
+			this, SLOT(deliver(int, PDFOutlineNode*)), Qt::QueuedConnection);
+}
+
+PDFOutlineLoader::~PDFOutlineLoader()
+{
+	mutex.lock();
+	stopping = true;
+	condition.wakeAll();
+	mutex.unlock();
+	wait();
+}
+
+void PDFOutlineLoader::setFileName(const QString& newFileName)
+{
+	QMutexLocker locker(&mutex);
+	fileName = newFileName;
+	++generation;
+	if (!isRunning())
+		start(QThread::LowPriority);
+	condition.wakeOne();
+}
+
+void PDFOutlineLoader::cancel()
+{
+	QMutexLocker locker(&mutex);
+	++generation;
+	// nothing left to read
+	loadedGeneration = generation;
+}
+
+void PDFOutlineLoader::deliver(int outlineGeneration, PDFOutlineNode *root)
+{
+	mutex.lock();
+	bool current = (outlineGeneration == generation && !stopping);
+	mutex.unlock();
+	if (current)
+		emit outlineLoaded(root);
+	else
+		delete root;
+}
+
+void PDFOutlineLoader::run()
+{
+	mutex.lock();
+	while (!stopping) {
+		if (loadedGeneration == generation) {
+			condition.wait(&mutex);
+			continue;
+		}
+		int outlineGeneration = generation;
+		QString outlineFile = fileName;
+		loadedGeneration = outlineGeneration;
+		mutex.unlock();
+
+		PDFOutlineNode *root = new PDFOutlineNode;
+		Poppler::Document *document = Poppler::Document::load(outlineFile);
+		if (document != NULL && !document->isLocked()) {
+			const QDomDocument *toc = document->toc();
+			if (toc != NULL) {
+				root->addEntries(*toc);
+				delete toc;
+			}
+		}
+		delete document;
+		emit loaded(outlineGeneration, root);
+
+		mutex.lock();
+	}
+	mutex.unlock();
+}
+
+#pragma mark === PDFOutlineModel ===
+
+PDFOutlineModel::PDFOutlineModel(QObject *parent)
+	: QAbstractItemModel(parent), rootNode(NULL)
+{
+}
+
+PDFOutlineModel::~PDFOutlineModel()
+{
+	delete rootNode;
+}
+
+bool PDFOutlineModel::showsEmptyText() const
+{
+	return rootNode != NULL && rootNode->children.isEmpty();
+}
+
+const PDFOutlineNode *PDFOutlineModel::node(const QModelIndex& index) const
+{
+	if (!index.isValid())
+		return NULL;
+	return static_cast<const PDFOutlineNode*>(index.internalPointer());
+}
+
+QModelIndex PDFOutlineModel::indexOf(const PDFOutlineNode *node) const
+{
+	if (node == NULL || node == rootNode)
+		return QModelIndex();
+	return createIndex(node->row, 0, const_cast<PDFOutlineNode*>(node));
+}
+
+QModelIndex PDFOutlineModel::index(int row, int column, const QModelIndex& parent) const
+{
+	if (column != 0 || row < 0)
+		return QModelIndex();
+	// the row with the empty text is the only one without a node
+	if (!parent.isValid() && showsEmptyText())
+		return (row == 0 ? createIndex(0, 0, (void*)NULL) : QModelIndex());
+
+	const PDFOutlineNode *parentNode = (parent.isValid() ? node(parent) : rootNode);
+	if (parentNode == NULL || row >= parentNode->children.count())
+		return QModelIndex();
+	return createIndex(row, 0, parentNode->children[row]);
+}
+
+QModelIndex PDFOutlineModel::parent(const QModelIndex& index) const
+{
+	const PDFOutlineNode *n = node(index);
+	if (n == NULL)
+		return QModelIndex();
+	return indexOf(n->parent);
+}
+
+int PDFOutlineModel::rowCount(const QModelIndex& parent) const
+{
+	if (parent.column() > 0)
+		return 0;
+	if (!parent.isValid()) {
+		if (rootNode == NULL)
+			return 0;
+		return (showsEmptyText() ? 1 : rootNode->children.count());
+	}
+	const PDFOutlineNode *n = node(parent);
+	return (n != NULL ? n->children.count() : 0);
+}
+
+int PDFOutlineModel::columnCount(const QModelIndex& parent) const
+{
+	Q_UNUSED(parent)
+	return 1;
+}
+
+QVariant PDFOutlineModel::data(const QModelIndex& index, int role) const
+{
+	if (role != Qt::DisplayRole || !index.isValid())
+		return QVariant();
+	const PDFOutlineNode *n = node(index);
+	return (n != NULL ? n->title : emptyText);
+}
+
+Qt::ItemFlags PDFOutlineModel::flags(const QModelIndex& index) const
+{
+	if (node(index) == NULL)
+		return Qt::NoItemFlags;
+	return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
+
+void PDFOutlineModel::setOutline(PDFOutlineNode *root)
+{
+	// views must not see the old nodes any more once they are deleted
+	PDFOutlineNode *oldRoot = rootNode;
+	rootNode = root;
+	reset();
+	delete oldRoot;
+}
+
+void PDFOutlineModel::setEmptyText(const QString& text)
+{
+	emptyText = text;
+	if (showsEmptyText())
+		emit dataChanged(index(0, 0), index(0, 0));
+}
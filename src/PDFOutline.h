@@ -0,0 +1,125 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+
+#ifndef PDFOutline_H
+#define PDFOutline_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QString>
+#include <QAbstractItemModel>
+
+class QDomNode;
+
+// One entry of a PDF outline. Unlike the QDomDocument Poppler returns, this
+// holds nothing but what the outline dock shows; the root node has no title.
+struct PDFOutlineNode
+{
+	PDFOutlineNode(PDFOutlineNode *parentNode = NULL);
+	~PDFOutlineNode();
+
+	// append the entries below tocNode (as returned by Poppler::Document::toc())
+	void addEntries(const QDomNode& tocNode);
+	// same titles, destinations and structure below this node
+	bool sameAs(const PDFOutlineNode& other) const;
+
+	QString title;
+	QString destination;
+	bool open;	// expanded unless the user has decided otherwise
+	PDFOutlineNode *parent;
+	int row;	// index in parent->children
+	QList<PDFOutlineNode*> children;
+};
+
+// Reads the outline of a PDF file on a worker thread that opens its own copy
+// of the file, in the manner of PDFFontScanner.
+class PDFOutlineLoader : public QThread
+{
+	Q_OBJECT
+
+public:
+	PDFOutlineLoader(QObject *parent = NULL);
+	virtual ~PDFOutlineLoader();
+
+	// start reading fileName, abandoning any outline that is still being read
+	void setFileName(const QString& fileName);
+	void cancel();
+
+signals:
+	// the receiver takes ownership of root, which has no children if the
+	// file has no outline
+	void outlineLoaded(PDFOutlineNode *root);
+
+	// emitted by the worker; only the current outline is passed on
+	void loaded(int generation, PDFOutlineNode *root);
+
+private slots:
+	void deliver(int generation, PDFOutlineNode *root);
+
+protected:
+	virtual void run();
+
+private:
+	QMutex mutex;
+	QWaitCondition condition;
+	QString fileName;
+	int generation;
+	int loadedGeneration;	// the last generation the worker has started to read
+	bool stopping;
+};
+
+// A single column model of PDFOutlineNodes; views only create what they show,
+// so large outlines cost nothing until they are expanded.
+class PDFOutlineModel : public QAbstractItemModel
+{
+	Q_OBJECT
+
+public:
+	PDFOutlineModel(QObject *parent = NULL);
+	virtual ~PDFOutlineModel();
+
+	virtual QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const;
+	virtual QModelIndex parent(const QModelIndex& index) const;
+	virtual int rowCount(const QModelIndex& parent = QModelIndex()) const;
+	virtual int columnCount(const QModelIndex& parent = QModelIndex()) const;
+	virtual QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+	virtual Qt::ItemFlags flags(const QModelIndex& index) const;
+
+	// takes ownership of root; NULL empties the model
+	void setOutline(PDFOutlineNode *root);
+	const PDFOutlineNode *outline() const { return rootNode; }
+	// shown in a disabled row if the outline has no entries
+	void setEmptyText(const QString& text);
+
+	const PDFOutlineNode *node(const QModelIndex& index) const;
+	QModelIndex indexOf(const PDFOutlineNode *node) const;
+
+private:
+	bool showsEmptyText() const;
+
+	PDFOutlineNode *rootNode;
+	QString emptyText;
+};
+
+#endif
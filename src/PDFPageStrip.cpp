@@ -0,0 +1,425 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#include "PDFPageStrip.h"
+#include "PDFDocument.h"
+#include "PDFRenderer.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
+#include <QScrollArea>
+#include <QScrollBar>
+#include <QtAlgorithms>
+
+const int kPageSpacing = 8; // gap between pages and around the strip, in pixels
+const int kMaxSpareViews = 8;
+const double kMaxViewPixels = 2 * 1024 * 1024;
+const int kMaxStripHeight = 8 * 1024 * 1024; // well below QWIDGETSIZE_MAX
+
+#pragma mark === PDFPageView ===
+
+PDFPageView::PDFPageView(QWidget *parent)
+	: QWidget(parent), page(-1), pageImageDpi(0)
+{
+	setAttribute(Qt::WA_OpaquePaintEvent, true);
+}
+
+PDFPageView::~PDFPageView()
+{
+}
+
+void PDFPageView::setPageIndex(int pageIndex)
+{
+	page = pageIndex;
+	pageImage = QImage();
+	pageImageDpi = 0;
+	update();
+}
+
+void PDFPageView::setImage(const QImage& newImage, double dpi)
+{
+	pageImage = newImage;
+	pageImageDpi = dpi;
+	update();
+}
+
+void PDFPageView::paintEvent(QPaintEvent *event)
+{
+	QPainter painter(this);
+	if (pageImage.isNull())
+		painter.fillRect(event->rect(), Qt::white);
+	else if (pageImage.size() == size())
+		painter.drawImage(event->rect(), pageImage, event->rect());
+	else
+		painter.drawImage(rect(), pageImage);
+}
+
+void PDFPageView::mousePressEvent(QMouseEvent *event)
+{
+	if (event->button() == Qt::LeftButton && page >= 0) {
+		emit clicked(page);
+		event->accept();
+	}
+	else
+		QWidget::mousePressEvent(event);
+}
+
+#pragma mark === PDFPageStrip ===
+
+PDFPageStrip::PDFPageStrip(PDFWidget *widget, PDFRenderer *pageRenderer, QScrollArea *area, int columns)
+	: QWidget()
+	, pdfWidget(widget)
+	, renderer(pageRenderer)
+	, scrollArea(area)
+	, document(NULL)
+	, numColumns(columns > 1 ? 2 : 1)
+	, columnWidth(0)
+	, renderDpi(0)
+	, windowTop(0)
+	, currentPage(-1)
+	, followingScroll(false)
+	, keepCurrentPage(false)
+	, movingWindow(false)
+{
+	setBackgroundRole(QPalette::Dark);
+
+	pdfWidget->setParent(this);
+	connect(pdfWidget, SIGNAL(changedPage(int)), this, SLOT(currentPageChanged(int)));
+	connect(renderer, SIGNAL(pageRendered(int, double, const QRect&, const QImage&)),
+			this, SLOT(pageRendered(int, double, const QRect&, const QImage&)));
+	connect(scrollArea->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(viewportScrolled()));
+	connect(scrollArea->horizontalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(viewportScrolled()));
+	connect(scrollArea, SIGNAL(resized()), this, SLOT(updateVisiblePages()));
+}
+
+PDFPageStrip::~PDFPageStrip()
+{
+}
+
+int PDFPageStrip::horizontalSpacing() const
+{
+	return (numColumns + 1) * kPageSpacing;
+}
+
+void PDFPageStrip::setDocument(Poppler::Document *doc)
+{
+	document = doc;
+
+	foreach (PDFPageView *view, views)
+		releaseView(view);
+	views.clear();
+	currentPage = -1;
+
+	pageSizes.clear();
+	if (document != NULL) {
+		int numPages = document->numPages();
+		pageSizes.reserve(numPages);
+		for (int i = 0; i < numPages; ++i) {
+			Poppler::Page *page = document->page(i);
+			pageSizes.append(page != NULL ? page->pageSizeF() : QSizeF());
+			delete page;
+		}
+	}
+
+	renderDpi = 0; // force a new layout
+	relayout();
+}
+
+QSize PDFPageStrip::pixelSize(int pageIndex) const
+{
+	return (pageSizes[pageIndex] * renderDpi / 72.0).toSize();
+}
+
+double PDFPageStrip::viewDpi(int pageIndex) const
+{
+	return PDFRenderer::cappedDpi(pageSizes[pageIndex], renderDpi, kMaxViewPixels);
+}
+
+void PDFPageStrip::relayout()
+{
+	double dpi = pdfWidget->getRenderDpi();
+	if (dpi == renderDpi) {
+		// only the current page (or its size) changed
+		placeCurrentPage();
+		return;
+	}
+	renderDpi = dpi;
+
+	int numPages = pageSizes.count();
+	columnWidth = 0;
+	for (int i = 0; i < numPages; ++i)
+		columnWidth = qMax(columnWidth, pixelSize(i).width());
+
+	int numRows = (numPages + numColumns - 1) / numColumns;
+	rowTops.resize(numRows + 1);
+	int y = kPageSpacing;
+	for (int row = 0; row < numRows; ++row) {
+		rowTops[row] = y;
+		int height = 0;
+		for (int i = row * numColumns; i < qMin(numPages, (row + 1) * numColumns); ++i)
+			height = qMax(height, pixelSize(i).height());
+		y += height + kPageSpacing;
+	}
+	rowTops[numRows] = y;
+	// in documents taller than the strip can be, it starts out centered on
+	// the current page
+	int stripHeight = qMin(y, kMaxStripHeight);
+	windowTop = 0;
+	if (y > stripHeight && currentPage >= 0)
+		windowTop = qBound(0, documentRect(currentPage).center().y() - stripHeight / 2, y - stripHeight);
+	// the scroll range adapts to the new size; that's no reason to change pages
+	keepCurrentPage = true;
+	resize(numColumns * columnWidth + horizontalSpacing(), stripHeight);
+	keepCurrentPage = false;
+
+	foreach (PDFPageView *view, views)
+		view->setGeometry(pageRect(view->pageIndex()));
+	placeCurrentPage();
+	updateVisiblePages();
+}
+
+QRect PDFPageStrip::documentRect(int pageIndex) const
+{
+	if (pageIndex < 0 || pageIndex >= pageSizes.count())
+		return QRect();
+	int row = pageIndex / numColumns;
+	int column = pageIndex % numColumns;
+	QSize size = pixelSize(pageIndex);
+	int x = kPageSpacing + column * (columnWidth + kPageSpacing) + (columnWidth - size.width()) / 2;
+	return QRect(QPoint(x, rowTops[row]), size);
+}
+
+QRect PDFPageStrip::pageRect(int pageIndex) const
+{
+	return documentRect(pageIndex).translated(0, -windowTop);
+}
+
+int PDFPageStrip::pageAt(const QPoint& pos) const
+{
+	int numPages = pageSizes.count();
+	if (numPages == 0)
+		return -1;
+	int numRows = rowTops.count() - 1;
+	// last row starting at or above pos; the gap below a row belongs to it
+	int row = qUpperBound(rowTops.constBegin(), rowTops.constBegin() + numRows, pos.y() + windowTop) - rowTops.constBegin() - 1;
+	row = qBound(0, row, numRows - 1);
+	int column = qBound(0, (pos.x() - kPageSpacing) / (columnWidth + kPageSpacing), numColumns - 1);
+	return qMin(row * numColumns + column, numPages - 1);
+}
+
+QRect PDFPageStrip::visibleArea() const
+{
+	QWidget *viewport = scrollArea->viewport();
+	return QRect(mapFrom(viewport, QPoint(0, 0)), viewport->size());
+}
+
+void PDFPageStrip::placeCurrentPage()
+{
+	QRect r = pageRect(currentPage);
+	if (r.isValid())
+		pdfWidget->move(r.topLeft());
+}
+
+void PDFPageStrip::moveWindow(int top)
+{
+	int delta = top - windowTop;
+	if (delta == 0)
+		return;
+	windowTop = top;
+	foreach (PDFPageView *view, views)
+		view->move(pageRect(view->pageIndex()).topLeft());
+	placeCurrentPage();
+	// scroll by the same amount, so the viewport shows what it did before
+	movingWindow = true;
+	QScrollBar *scrollBar = scrollArea->verticalScrollBar();
+	scrollBar->setValue(scrollBar->value() - delta);
+	movingWindow = false;
+}
+
+void PDFPageStrip::recenterWindow()
+{
+	int total = documentHeight();
+	if (total <= height())
+		return;
+	// once the viewport is within a screen of an end of the strip that isn't
+	// the end of the document, the strip moves on to have it in its middle
+	QRect visible = visibleArea();
+	if ((visible.top() >= visible.height() || windowTop == 0)
+		&& (visible.bottom() < height() - visible.height() || windowTop + height() >= total))
+		return;
+	moveWindow(qBound(0, windowTop + visible.center().y() - height() / 2, total - height()));
+}
+
+void PDFPageStrip::scrollToPage(int pageIndex)
+{
+	QRect r = documentRect(pageIndex);
+	if (r.isValid()) {
+		keepCurrentPage = true;
+		if (r.top() - kPageSpacing < windowTop || r.bottom() >= windowTop + height())
+			moveWindow(qBound(0, r.center().y() - height() / 2, documentHeight() - height()));
+		r = pageRect(pageIndex);
+		scrollArea->verticalScrollBar()->setValue(r.top() - kPageSpacing);
+		scrollArea->ensureVisible(r.center().x(), r.top(), r.width() / 2, 0);
+		keepCurrentPage = false;
+	}
+	updateVisiblePages();
+}
+
+void PDFPageStrip::viewportScrolled()
+{
+	if (!movingWindow)
+		recenterWindow();
+	updateVisiblePages();
+	if (keepCurrentPage || currentPage < 0)
+		return;
+
+	// the current page follows the middle of the viewport; in two-page
+	// mode it stays in its column
+	QRect current = pageRect(currentPage);
+	int middle = visibleArea().center().y();
+	if (middle >= current.top() - kPageSpacing && middle <= current.bottom() + kPageSpacing)
+		return;
+	int pageIndex = pageAt(QPoint(current.center().x(), middle));
+	if (pageIndex >= 0 && pageIndex != currentPage) {
+		followingScroll = true;
+		pdfWidget->goToPage(pageIndex);
+		followingScroll = false;
+	}
+}
+
+void PDFPageStrip::currentPageChanged(int pageIndex)
+{
+	currentPage = pageIndex;
+	// the page is drawn by the PDFWidget now; let it start out with the
+	// image that was shown so far instead of rendering it again
+	PDFPageView *view = views.take(pageIndex);
+	if (view != NULL) {
+		if (!view->image().isNull())
+			pdfWidget->adoptImage(view->image(), view->imageDpi());
+		releaseView(view);
+	}
+	placeCurrentPage();
+	if (followingScroll)
+		updateVisiblePages();
+	else
+		scrollToPage(pageIndex);
+}
+
+void PDFPageStrip::keepImage(const QImage& image, double dpi)
+{
+	if (currentPage < 0 || image.isNull())
+		return;
+	PDFPageView *view = viewForPage(currentPage);
+	view->setImage(image, dpi);
+	view->show();
+}
+
+PDFPageView *PDFPageStrip::viewForPage(int pageIndex)
+{
+	PDFPageView *view = views.value(pageIndex);
+	if (view == NULL) {
+		if (spareViews.isEmpty()) {
+			view = new PDFPageView(this);
+			connect(view, SIGNAL(clicked(int)), this, SLOT(pageViewClicked(int)));
+		}
+		else
+			view = spareViews.takeLast();
+		view->setPageIndex(pageIndex);
+		view->setGeometry(pageRect(pageIndex));
+		view->stackUnder(pdfWidget);
+		views.insert(pageIndex, view);
+	}
+	return view;
+}
+
+void PDFPageStrip::releaseView(PDFPageView *view)
+{
+	renderer->cancelPage(view->pageIndex());
+	view->hide();
+	view->setPageIndex(-1);
+	if (spareViews.count() < kMaxSpareViews)
+		spareViews.append(view);
+	else
+		view->deleteLater();
+}
+
+void PDFPageStrip::showPage(int pageIndex)
+{
+	if (pageIndex == currentPage)
+		return;
+	PDFPageView *view = viewForPage(pageIndex);
+	view->show();
+	double dpi = viewDpi(pageIndex);
+	if (view->imageDpi() != dpi)
+		renderer->requestPage(pageIndex, dpi);
+}
+
+void PDFPageStrip::updateVisiblePages()
+{
+	if (pageSizes.isEmpty() || parentWidget() != scrollArea->viewport())
+		return;
+
+	QRect visible = visibleArea();
+	int firstVisible = pageAt(visible.topLeft());
+	int lastVisible = pageAt(visible.bottomRight());
+	// pages within one screen above or below are prepared as well
+	QRect nearby = visible.adjusted(0, -visible.height(), 0, visible.height());
+	int first = pageAt(QPoint(0, nearby.top())) / numColumns * numColumns;
+	int last = qMin(pageAt(QPoint(width(), nearby.bottom())) / numColumns * numColumns + numColumns - 1,
+					pageSizes.count() - 1);
+
+	QMap<int, PDFPageView*>::iterator it = views.begin();
+	while (it != views.end()) {
+		if (it.key() < first || it.key() > last) {
+			releaseView(it.value());
+			it = views.erase(it);
+		}
+		else
+			++it;
+	}
+
+	// the renderer serves the latest requests first, so the visible pages
+	// are requested last, top to bottom in reverse
+	for (int i = first; i <= last; ++i) {
+		if (i < firstVisible || i > lastVisible)
+			showPage(i);
+	}
+	for (int i = lastVisible; i >= firstVisible; --i)
+		showPage(i);
+}
+
+void PDFPageStrip::pageRendered(int pageIndex, double dpi, const QRect& region, const QImage& image)
+{
+	// regions are requested by the PDFWidget for the current page
+	if (!region.isNull())
+		return;
+	PDFPageView *view = views.value(pageIndex);
+	if (view != NULL && dpi == viewDpi(pageIndex))
+		view->setImage(image, dpi);
+}
+
+void PDFPageStrip::pageViewClicked(int pageIndex)
+{
+	followingScroll = true;
+	pdfWidget->goToPage(pageIndex);
+	followingScroll = false;
+}
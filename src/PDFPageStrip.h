@@ -0,0 +1,149 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#ifndef PDFPageStrip_H
+#define PDFPageStrip_H
+
+#include <QWidget>
+#include <QImage>
+#include <QVector>
+#include <QMap>
+#include <QList>
+#include <QSizeF>
+
+#include "poppler-qt4.h"
+
+class QScrollArea;
+class PDFWidget;
+class PDFRenderer;
+
+// A page of the strip other than the current one; it only shows an image
+// from the PDFRenderer, scaled to the page size. At high zoom levels the
+// image has a lower resolution than the page, so views stay cheap.
+class PDFPageView : public QWidget
+{
+	Q_OBJECT
+
+public:
+	PDFPageView(QWidget *parent = NULL);
+	virtual ~PDFPageView();
+
+	// show pageIndex without an image; -1 frees the view for reuse
+	void setPageIndex(int pageIndex);
+	int pageIndex() const
+		{ return page; }
+
+	void setImage(const QImage& newImage, double dpi);
+	const QImage& image() const
+		{ return pageImage; }
+	double imageDpi() const
+		{ return pageImageDpi; }
+
+signals:
+	void clicked(int pageIndex);
+
+protected:
+	virtual void paintEvent(QPaintEvent *event);
+	virtual void mousePressEvent(QMouseEvent *event);
+
+private:
+	int page;
+	QImage pageImage;
+	double pageImageDpi;
+};
+
+// Lays out all pages of the document below each other, one or two per row,
+// as the widget of the PDF window's scroll area. The current page is the
+// PDFWidget itself, so all tools work as in single page mode; the pages
+// near the viewport are PDFPageViews that are recycled as they scroll out
+// of view, and all other pages have no widget at all.
+// Widgets can't be taller than QWIDGETSIZE_MAX, so in very long documents
+// (or at high zoom) the strip only covers part of the document and is moved
+// along as the viewport comes near one of its ends.
+class PDFPageStrip : public QWidget
+{
+	Q_OBJECT
+
+public:
+	PDFPageStrip(PDFWidget *widget, PDFRenderer *pageRenderer, QScrollArea *area, int columns);
+	virtual ~PDFPageStrip();
+
+	int columns() const
+		{ return numColumns; }
+	// horizontal space taken by the gaps around and between the pages
+	int horizontalSpacing() const;
+
+	void setDocument(Poppler::Document *doc);
+	// called by the PDFWidget when its size or scale changed
+	void relayout();
+	// the image of the current page, handed over when the PDFWidget moves on
+	void keepImage(const QImage& image, double dpi);
+
+	// in strip coordinates
+	QRect pageRect(int pageIndex) const;
+	int pageAt(const QPoint& pos) const;
+	void scrollToPage(int pageIndex);
+
+public slots:
+	void updateVisiblePages();
+
+private slots:
+	void currentPageChanged(int pageIndex);
+	void viewportScrolled();
+	void pageRendered(int pageIndex, double dpi, const QRect& region, const QImage& image);
+	void pageViewClicked(int pageIndex);
+
+private:
+	QSize pixelSize(int pageIndex) const;
+	double viewDpi(int pageIndex) const;
+	// in document coordinates, i.e. relative to the top of the first row
+	QRect documentRect(int pageIndex) const;
+	int documentHeight() const
+		{ return rowTops.isEmpty() ? 0 : rowTops.last(); }
+	QRect visibleArea() const;
+	void moveWindow(int top);
+	void recenterWindow();
+	void placeCurrentPage();
+	PDFPageView *viewForPage(int pageIndex);
+	void showPage(int pageIndex);
+	void releaseView(PDFPageView *view);
+
+	PDFWidget *pdfWidget;
+	PDFRenderer *renderer;
+	QScrollArea *scrollArea;
+	Poppler::Document *document;
+
+	int numColumns;
+	QVector<QSizeF> pageSizes;	// in points
+	QVector<int> rowTops;		// one more than there are rows; the last is the total height
+	int columnWidth;
+	double renderDpi;			// dpi the layout was computed for
+	int windowTop;				// document y coordinate of the strip's top edge
+
+	int currentPage;			// the page shown by pdfWidget
+	QMap<int, PDFPageView*> views;
+	QList<PDFPageView*> spareViews;
+	bool followingScroll;		// the current page changes because of scrolling
+	bool keepCurrentPage;
+	bool movingWindow;
+};
+
+#endif
@@ -0,0 +1,424 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+
+#include "PDFRenderCache.h"
+#include "TWUtils.h"
+
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QStringList>
+#include <QSet>
+#include <QMap>
+
+const quint32 kRenderCacheMagic = 0x54577263;	// "TWrc"
+const qint32 kRenderCacheVersion = 1;
+const int kSaveInterval = 16;	// entries added or dropped before the index is written
+const int kHashBufferSize = 1024 * 1024;
+const uint kStampSettleSecs = 2;	// younger modification times may not be final
+const int kMaxPendingWrites = 8;	// images waiting for the writer
+
+class PDFRenderCacheWriteJob : public QRunnable
+{
+public:
+	PDFRenderCacheWriteJob(PDFRenderCache *renderCache, const QString& key, const QRect& imageRegion,
+						   const QImage& pageImage, const QString& imageFile)
+		: cache(renderCache), pageKey(key), region(imageRegion), image(pageImage), file(imageFile)
+	{
+	}
+
+	virtual void run()
+	{
+		bool success = image.save(cache->directory + "/" + file, "PNG");
+		cache->written(pageKey, region, file, success);
+	}
+
+private:
+	PDFRenderCache *cache;
+	QString pageKey;
+	QRect region;
+	QImage image;
+	QString file;
+};
+
+PDFRenderCache *PDFRenderCache::theInstance = NULL;
+
+PDFRenderCache::PDFRenderCache()
+	: totalBytes(0), sizeLimit(0), unsavedChanges(0), loaded(false)
+{
+	directory = cacheDirectory();
+	writer.setMaxThreadCount(1);
+}
+
+PDFRenderCache::~PDFRenderCache()
+{
+}
+
+PDFRenderCache *PDFRenderCache::instance()
+{
+	// created on the GUI thread, by the first document that uses it
+	if (theInstance == NULL) {
+		theInstance = new PDFRenderCache;
+		qAddPostRoutine(saveOnExit);
+	}
+	return theInstance;
+}
+
+void PDFRenderCache::saveOnExit()
+{
+	if (theInstance != NULL) {
+		theInstance->writer.waitForDone();
+		theInstance->save();
+	}
+}
+
+QString PDFRenderCache::cacheDirectory()
+{
+	return TWUtils::cachePath("pages");
+}
+
+QString PDFRenderCache::indexPath() const
+{
+	return directory + "/index.dat";
+}
+
+void PDFRenderCache::setSizeLimit(qint64 bytes)
+{
+	QMutexLocker locker(&mutex);
+	load();
+	sizeLimit = bytes;
+	evict();
+}
+
+#pragma mark === Index ===
+
+// must be called with the mutex locked
+void PDFRenderCache::load()
+{
+	if (loaded)
+		return;
+	loaded = true;
+	// a directory someone else set up is not used at all
+	if (!TWUtils::makePrivateDirectory(directory))
+		return;
+
+	QFile file(indexPath());
+	if (file.open(QIODevice::ReadOnly)) {
+		QDataStream in(&file);
+		in.setVersion(QDataStream::Qt_4_4);
+		quint32 magic;
+		qint32 version;
+		in >> magic >> version;
+		if (in.status() == QDataStream::Ok && magic == kRenderCacheMagic && version == kRenderCacheVersion) {
+			qint32 count;
+			in >> count;
+			for (int i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+				QString path;
+				FileStamp stamp;
+				in >> path >> stamp.size >> stamp.modified >> stamp.hash;
+				hashes.insert(path, stamp);
+			}
+			in >> count;
+			for (int i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+				QString key;
+				Entry entry;
+				in >> key >> entry.region >> entry.file >> entry.bytes >> entry.lastUsed;
+				entries[key].append(entry);
+				totalBytes += entry.bytes;
+			}
+		}
+		if (in.status() != QDataStream::Ok) {
+			hashes.clear();
+			entries.clear();
+			totalBytes = 0;
+		}
+	}
+
+	// images written after the index was saved last are unknown; drop them
+	QSet<QString> known;
+	foreach (const QList<Entry>& list, entries) {
+		foreach (const Entry& entry, list)
+			known.insert(entry.file);
+	}
+	QDir dir(directory);
+	foreach (const QString& name, dir.entryList(QStringList("*.png"), QDir::Files)) {
+		if (!known.contains(name))
+			dir.remove(name);
+	}
+}
+
+// must be called with the mutex locked
+void PDFRenderCache::saveIndex()
+{
+	if (!loaded || !TWUtils::makePrivateDirectory(directory))
+		return;
+	unsavedChanges = 0;
+
+	// forget the hashes of files none of whose pages are cached any more
+	QSet<QString> cachedHashes;
+	foreach (const QString& key, entries.keys())
+		cachedHashes.insert(key.section('-', 0, 0));
+	QMutableHashIterator<QString, FileStamp> it(hashes);
+	while (it.hasNext()) {
+		if (!cachedHashes.contains(it.next().value().hash))
+			it.remove();
+	}
+
+	QString tempFile = indexPath() + ".new";
+	QFile file(tempFile);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return;
+	QDataStream out(&file);
+	out.setVersion(QDataStream::Qt_4_4);
+	out << kRenderCacheMagic << kRenderCacheVersion;
+	out << (qint32)hashes.count();
+	for (QHash<QString, FileStamp>::const_iterator i = hashes.constBegin(); i != hashes.constEnd(); ++i)
+		out << i.key() << i.value().size << i.value().modified << i.value().hash;
+	qint32 count = 0;
+	foreach (const QList<Entry>& list, entries)
+		count += list.count();
+	out << count;
+	for (QHash<QString, QList<Entry> >::const_iterator i = entries.constBegin(); i != entries.constEnd(); ++i) {
+		foreach (const Entry& entry, i.value())
+			out << i.key() << entry.region << entry.file << entry.bytes << entry.lastUsed;
+	}
+	file.close();
+	if (out.status() != QDataStream::Ok || file.error() != QFile::NoError) {
+		QFile::remove(tempFile);
+		return;
+	}
+	QFile::remove(indexPath());
+	QFile::rename(tempFile, indexPath());
+}
+
+void PDFRenderCache::save()
+{
+	QMutexLocker locker(&mutex);
+	if (unsavedChanges > 0)
+		saveIndex();
+}
+
+#pragma mark === Content hashes ===
+
+QString PDFRenderCache::contentHash(const QString& fileName)
+{
+	QFileInfo fi(fileName);
+	QString path = fi.canonicalFilePath();
+	if (path.isEmpty())
+		return QString();
+
+	uint modified = fi.lastModified().toTime_t();
+	if (modified + kStampSettleSecs > QDateTime::currentDateTime().toTime_t())
+		return QString();
+
+	QMutexLocker locker(&mutex);
+	load();
+	QHash<QString, FileStamp>::const_iterator i = hashes.constFind(path);
+	if (i == hashes.constEnd() || i.value().size != fi.size() || i.value().modified != modified)
+		return QString();
+	return i.value().hash;
+}
+
+QString PDFRenderCache::computeContentHash(const QString& fileName)
+{
+	QString hash = contentHash(fileName);
+	if (!hash.isEmpty())
+		return hash;
+
+	QFileInfo fi(fileName);
+	FileStamp stamp;
+	stamp.size = fi.size();
+	stamp.modified = fi.lastModified().toTime_t();
+	if (stamp.modified + kStampSettleSecs > QDateTime::currentDateTime().toTime_t())
+		return QString();
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+		return QString();
+	// the file is read without the mutex locked; it may take a while
+	QCryptographicHash md5(QCryptographicHash::Md5);
+	while (!file.atEnd()) {
+		QByteArray data = file.read(kHashBufferSize);
+		if (data.isEmpty())
+			return QString();
+		md5.addData(data);
+	}
+	file.close();
+	hash = md5.result().toHex();
+
+	// the hash only belongs to the stamp if nothing was written meanwhile
+	fi.refresh();
+	if (fi.size() != stamp.size || fi.lastModified().toTime_t() != stamp.modified)
+		return QString();
+	stamp.hash = hash;
+	QMutexLocker locker(&mutex);
+	hashes.insert(fi.canonicalFilePath(), stamp);
+	++unsavedChanges;
+	return hash;
+}
+
+QString PDFRenderCache::pageKey(const QString& contentHash, int pageIndex, double dpi, int renderHints)
+{
+	return contentHash + "-" + QString::number(pageIndex) + "-" + QString::number(dpi, 'g', 12)
+		+ "-" + QString::number(renderHints);
+}
+
+#pragma mark === Images ===
+
+bool PDFRenderCache::lookup(const QString& pageKey, const QRect& region, QImage& image)
+{
+	QString file;
+	QRect entryRegion;
+	{
+		QMutexLocker locker(&mutex);
+		load();
+		QHash<QString, QList<Entry> >::iterator it = entries.find(pageKey);
+		if (it == entries.end())
+			return false;
+		// any image that covers the region will do; a whole page covers everything
+		QList<Entry>& list = it.value();
+		for (int i = 0; i < list.count(); ++i) {
+			if (list[i].region.isNull() || (!region.isNull() && list[i].region.contains(region))) {
+				list[i].lastUsed = QDateTime::currentDateTime().toTime_t();
+				file = list[i].file;
+				entryRegion = list[i].region;
+				break;
+			}
+		}
+	}
+	if (file.isEmpty())
+		return false;
+
+	QImage cached;
+	if (!cached.load(directory + "/" + file, "PNG")) {
+		// the file has gone or is damaged
+		QMutexLocker locker(&mutex);
+		const QList<Entry> list = entries.value(pageKey);
+		for (int i = 0; i < list.count(); ++i) {
+			if (list[i].file == file) {
+				removeEntry(pageKey, i);
+				break;
+			}
+		}
+		return false;
+	}
+	if (region.isNull() || region == entryRegion)
+		image = cached;
+	else
+		image = cached.copy(region.translated(-entryRegion.topLeft()));
+	return true;
+}
+
+void PDFRenderCache::store(const QString& pageKey, const QRect& region, const QImage& image)
+{
+	if (image.isNull() || !TWUtils::makePrivateDirectory(directory))
+		return;
+	QString file = QCryptographicHash::hash((pageKey + QString("/%1,%2,%3,%4").arg(region.x()).arg(region.y())
+											 .arg(region.width()).arg(region.height())).toUtf8(),
+											QCryptographicHash::Md5).toHex() + ".png";
+	{
+		// the name is unique to the key and region, so a queued file already
+		// has the same contents
+		QMutexLocker locker(&mutex);
+		// images that aren't in the index yet are removed when it is loaded
+		load();
+		if (pendingFiles.contains(file) || pendingFiles.count() >= kMaxPendingWrites)
+			return;
+		pendingFiles.insert(file);
+	}
+	writer.start(new PDFRenderCacheWriteJob(this, pageKey, region, image, file));
+}
+
+void PDFRenderCache::written(const QString& pageKey, const QRect& region, const QString& file, bool success)
+{
+	QMutexLocker locker(&mutex);
+	pendingFiles.remove(file);
+	if (!success)
+		return;
+
+	load();
+	QList<Entry>& list = entries[pageKey];
+	for (int i = list.count() - 1; i >= 0; --i) {
+		// a tile inside the new one is of no further use
+		if (list[i].file == file || (!list[i].region.isNull() && (region.isNull() || region.contains(list[i].region)))) {
+			if (list[i].file != file)
+				QFile::remove(directory + "/" + list[i].file);
+			totalBytes -= list[i].bytes;
+			list.removeAt(i);
+		}
+	}
+	Entry entry;
+	entry.region = region;
+	entry.file = file;
+	entry.bytes = QFileInfo(directory + "/" + file).size();
+	entry.lastUsed = QDateTime::currentDateTime().toTime_t();
+	list.append(entry);
+	totalBytes += entry.bytes;
+
+	evict();
+	if (++unsavedChanges >= kSaveInterval)
+		saveIndex();
+}
+
+// must be called with the mutex locked
+void PDFRenderCache::removeEntry(const QString& pageKey, int i)
+{
+	QHash<QString, QList<Entry> >::iterator it = entries.find(pageKey);
+	if (it == entries.end() || i < 0 || i >= it.value().count())
+		return;
+	QFile::remove(directory + "/" + it.value()[i].file);
+	totalBytes -= it.value()[i].bytes;
+	it.value().removeAt(i);
+	if (it.value().isEmpty())
+		entries.erase(it);
+	++unsavedChanges;
+}
+
+// must be called with the mutex locked
+void PDFRenderCache::evict()
+{
+	if (sizeLimit <= 0 || totalBytes <= sizeLimit)
+		return;
+
+	// drop the least recently used images until there is some room again
+	QMap<uint, QPair<QString, QString> > byAge;	// last use -> (page key, file)
+	for (QHash<QString, QList<Entry> >::const_iterator i = entries.constBegin(); i != entries.constEnd(); ++i) {
+		foreach (const Entry& entry, i.value())
+			byAge.insertMulti(entry.lastUsed, qMakePair(i.key(), entry.file));
+	}
+	qint64 target = sizeLimit - sizeLimit / 10;
+	for (QMap<uint, QPair<QString, QString> >::const_iterator i = byAge.constBegin();
+		 i != byAge.constEnd() && totalBytes > target; ++i) {
+		const QList<Entry>& list = entries.value(i.value().first);
+		for (int j = 0; j < list.count(); ++j) {
+			if (list[j].file == i.value().second) {
+				removeEntry(i.value().first, j);
+				break;
+			}
+		}
+	}
+}
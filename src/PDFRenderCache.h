@@ -0,0 +1,114 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+
+#ifndef PDFRenderCache_H
+#define PDFRenderCache_H
+
+#include <QMutex>
+#include <QThreadPool>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QString>
+#include <QRect>
+#include <QImage>
+
+// Keeps rendered pages and parts of pages in the cache directory across
+// sessions, as PNG files. Entries are keyed by a hash of the PDF's contents,
+// the page, the resolution and the render hints. So that files needn't be
+// read again to find their hash, it is reused as long as the file's size and
+// modification time stay the same; a file rewritten with the same size and
+// time stamp would go unnoticed, so time stamps from the last couple of
+// seconds (when a writer may still be at work) are not trusted. The least
+// recently used entries are dropped when the cache grows beyond its size
+// limit. Images are encoded and written by a background thread, so storing
+// one doesn't hold up the renderer. All functions may be called from any
+// thread.
+class PDFRenderCache
+{
+public:
+	static PDFRenderCache *instance();
+	static QString cacheDirectory();
+
+	void setSizeLimit(qint64 bytes);
+
+	// the hash of fileName's contents if it is known for the file's current
+	// size and modification time, an empty string otherwise
+	QString contentHash(const QString& fileName);
+	// the same, but reads the whole file if needed; empty if the file was
+	// modified too recently or changed while it was read
+	QString computeContentHash(const QString& fileName);
+
+	static QString pageKey(const QString& contentHash, int pageIndex, double dpi, int renderHints);
+
+	// region is in pixels at the dpi of pageKey; a null region stands for the
+	// whole page. On success, image is set to exactly that region.
+	bool lookup(const QString& pageKey, const QRect& region, QImage& image);
+	// queue the image to be written; dropped if the writer is too far behind
+	void store(const QString& pageKey, const QRect& region, const QImage& image);
+
+	// write the index of the cache to disk
+	void save();
+
+private:
+	PDFRenderCache();
+	~PDFRenderCache();
+
+	struct Entry {
+		QRect region;
+		QString file;
+		qint64 bytes;
+		uint lastUsed;
+	};
+	struct FileStamp {
+		qint64 size;
+		uint modified;
+		QString hash;
+	};
+
+	void load();
+	void saveIndex();
+	// called by the writer once the image is on disk (or failed to get there)
+	void written(const QString& pageKey, const QRect& region, const QString& file, bool success);
+	void removeEntry(const QString& pageKey, int i);
+	void evict();
+	QString indexPath() const;
+
+	static void saveOnExit();
+
+	QMutex mutex;
+	QString directory;
+	QHash<QString, QList<Entry> > entries;	// by page key
+	QHash<QString, FileStamp> hashes;	// by canonical path of the PDF
+	qint64 totalBytes;
+	qint64 sizeLimit;
+	int unsavedChanges;
+	bool loaded;
+	QThreadPool writer;
+	QSet<QString> pendingFiles;	// queued for the writer
+
+	static PDFRenderCache *theInstance;
+
+	friend class PDFRenderCacheWriteJob;
+};
+
+#endif
@@ -0,0 +1,228 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#include "PDFRenderer.h"
+#include "PDFRenderCache.h"
+
+#include "poppler-qt4.h"
+
+#include <QMutexLocker>
+#include <QFileInfo>
+#include <QDateTime>
+
+#include <math.h>
+
+// the hints set in run(); part of the keys of cached pages
+const int kRenderHints = Poppler::Document::Antialiasing | Poppler::Document::TextAntialiasing;
+// files modified more recently are most likely the output of the last
+// typesetting run, which the next run replaces with a new hash; they are
+// neither read in full to hash them nor given space in the disk cache
+const int kFreshFileSecs = 10 * 60;
+
+PDFRenderer::PDFRenderer(QObject *parent)
+	: QThread(parent), useDiskCache(false), generation(0), stopping(false)
+{
+	connect(this, SIGNAL(rendered(int, int, double, const QRect&, const QImage&)),
+			this, SLOT(deliver(int, int, double, const QRect&, const QImage&)), Qt::QueuedConnection);
+}
+
+PDFRenderer::~PDFRenderer()
+{
+	mutex.lock();
+	stopping = true;
+	queue.clear();
+	condition.wakeAll();
+	mutex.unlock();
+	wait();
+}
+
+void PDFRenderer::setFileName(const QString& newFileName)
+{
+	QMutexLocker locker(&mutex);
+	fileName = newFileName;
+	// on a file seen before, the hash is known without reading it
+	contentHash = (useDiskCache ? PDFRenderCache::instance()->contentHash(fileName) : QString());
+	++generation;
+	queue.clear();
+	if (!isRunning())
+		start(QThread::LowPriority);
+}
+
+void PDFRenderer::setUseDiskCache(bool use)
+{
+	QMutexLocker locker(&mutex);
+	useDiskCache = use;
+	if (use)
+		PDFRenderCache::instance();
+}
+
+bool PDFRenderer::cachedImage(int pageIndex, double dpi, const QRect& region, QImage& image)
+{
+	mutex.lock();
+	QString hash = (useDiskCache ? contentHash : QString());
+	mutex.unlock();
+	if (hash.isEmpty())
+		return false;
+	return PDFRenderCache::instance()->lookup(PDFRenderCache::pageKey(hash, pageIndex, dpi, kRenderHints), region, image);
+}
+
+void PDFRenderer::requestPage(int pageIndex, double dpi, const QRect& region)
+{
+	QMutexLocker locker(&mutex);
+	for (int i = queue.count() - 1; i >= 0; --i) {
+		if (queue[i].pageIndex == pageIndex && queue[i].dpi == dpi && queue[i].region == region)
+			queue.removeAt(i);
+	}
+	Request request;
+	request.pageIndex = pageIndex;
+	request.dpi = dpi;
+	request.region = region;
+	queue.append(request);
+	condition.wakeOne();
+}
+
+double PDFRenderer::cappedDpi(const QSizeF& pageSize, double dpi, double maxPixels)
+{
+	double area = pageSize.width() * pageSize.height() / (72.0 * 72.0); // square inches
+	if (area > 0 && area * dpi * dpi > maxPixels)
+		return sqrt(maxPixels / area);
+	return dpi;
+}
+
+void PDFRenderer::cancelPage(int pageIndex)
+{
+	QMutexLocker locker(&mutex);
+	for (int i = queue.count() - 1; i >= 0; --i) {
+		if (queue[i].pageIndex == pageIndex)
+			queue.removeAt(i);
+	}
+}
+
+void PDFRenderer::cancelAll()
+{
+	QMutexLocker locker(&mutex);
+	queue.clear();
+}
+
+void PDFRenderer::deliver(int requestGeneration, int pageIndex, double dpi, const QRect& region, const QImage& image)
+{
+	mutex.lock();
+	bool current = (requestGeneration == generation);
+	mutex.unlock();
+	if (current)
+		emit pageRendered(pageIndex, dpi, region, image);
+}
+
+void PDFRenderer::run()
+{
+	Poppler::Document *document = NULL;
+	int documentGeneration = -1;
+	bool documentOpened = false;
+	bool hashTried = false;
+
+	mutex.lock();
+	while (!stopping) {
+		if (queue.isEmpty()) {
+			condition.wait(&mutex);
+			continue;
+		}
+		Request request = queue.takeLast();
+		int requestGeneration = generation;
+		QString requestFile = fileName;
+		bool requestCache = useDiskCache;
+		QString requestHash = contentHash;
+		mutex.unlock();
+
+		if (requestGeneration != documentGeneration) {
+			// opened when the first page that is not in the disk cache is needed
+			delete document;
+			document = NULL;
+			documentOpened = false;
+			hashTried = false;
+			documentGeneration = requestGeneration;
+		}
+		if (requestCache && requestHash.isEmpty() && !hashTried) {
+			// a file that is new to the cache is read once to hash it
+			hashTried = true;
+			if (QFileInfo(requestFile).lastModified().secsTo(QDateTime::currentDateTime()) >= kFreshFileSecs)
+				requestHash = PDFRenderCache::instance()->computeContentHash(requestFile);
+			mutex.lock();
+			if (generation == requestGeneration)
+				contentHash = requestHash;
+			mutex.unlock();
+		}
+		QString cacheKey;
+		if (requestCache && !requestHash.isEmpty())
+			cacheKey = PDFRenderCache::pageKey(requestHash, request.pageIndex, request.dpi, kRenderHints);
+
+		QImage image;
+		if (!cacheKey.isEmpty() && PDFRenderCache::instance()->lookup(cacheKey, request.region, image)) {
+			emit rendered(requestGeneration, request.pageIndex, request.dpi, request.region, image);
+			mutex.lock();
+			continue;
+		}
+		if (!documentOpened) {
+			document = Poppler::Document::load(requestFile);
+			if (document != NULL && document->isLocked()) {
+				delete document;
+				document = NULL;
+			}
+			if (document != NULL) {
+				// the same settings as PDFDocument::loadPdf()
+				document->setRenderBackend(Poppler::Document::SplashBackend);
+				document->setRenderHint(Poppler::Document::Antialiasing);
+				document->setRenderHint(Poppler::Document::TextAntialiasing);
+			}
+			documentOpened = true;
+			// if the file was written after it was hashed, Poppler may have read
+			// the new version; none of its pages belong under the old hash
+			if (!requestHash.isEmpty() && PDFRenderCache::instance()->contentHash(requestFile) != requestHash) {
+				mutex.lock();
+				if (generation == requestGeneration)
+					contentHash = QString();
+				mutex.unlock();
+				hashTried = true;
+				cacheKey = QString();
+			}
+		}
+		if (document != NULL && request.pageIndex >= 0 && request.pageIndex < document->numPages()) {
+			Poppler::Page *page = document->page(request.pageIndex);
+			if (page != NULL) {
+				if (request.region.isNull())
+					image = page->renderToImage(request.dpi, request.dpi);
+				else
+					image = page->renderToImage(request.dpi, request.dpi, request.region.x(), request.region.y(),
+												request.region.width(), request.region.height());
+				delete page;
+			}
+		}
+		if (!image.isNull()) {
+			emit rendered(requestGeneration, request.pageIndex, request.dpi, request.region, image);
+			if (!cacheKey.isEmpty())
+				PDFRenderCache::instance()->store(cacheKey, request.region, image);
+		}
+
+		mutex.lock();
+	}
+	mutex.unlock();
+
+	delete document;
+}
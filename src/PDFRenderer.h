@@ -0,0 +1,93 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#ifndef PDFRenderer_H
+#define PDFRenderer_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QImage>
+#include <QList>
+#include <QRect>
+#include <QSizeF>
+
+// Renders PDF pages on a worker thread. Poppler documents must not be used
+// from two threads at once, so the worker opens its own copy of the file.
+// Requests are served newest first: views ask again for whatever they show
+// after every scroll, so that is what gets rendered next. Results of
+// requests made before the last setFileName() are never delivered.
+class PDFRenderer : public QThread
+{
+	Q_OBJECT
+
+public:
+	PDFRenderer(QObject *parent = NULL);
+	virtual ~PDFRenderer();
+
+	// (re)open fileName in the worker and drop all pending requests
+	void setFileName(const QString& fileName);
+	// take pages from and add them to the PDFRenderCache; applies from the
+	// next setFileName() on
+	void setUseDiskCache(bool use);
+	// the image from the disk cache, if it is there; doesn't involve Poppler
+	// and can be used on the GUI thread
+	bool cachedImage(int pageIndex, double dpi, const QRect& region, QImage& image);
+
+	// region is in pixels at dpi; a null region stands for the whole page
+	void requestPage(int pageIndex, double dpi, const QRect& region = QRect());
+
+	// dpi, lowered as far as needed for a page of pageSize (in points) to
+	// fit into maxPixels
+	static double cappedDpi(const QSizeF& pageSize, double dpi, double maxPixels);
+	void cancelPage(int pageIndex);
+	void cancelAll();
+
+signals:
+	void pageRendered(int pageIndex, double dpi, const QRect& region, const QImage& image);
+
+	// emitted by the worker; only results for the current file are passed on
+	void rendered(int generation, int pageIndex, double dpi, const QRect& region, const QImage& image);
+
+private slots:
+	void deliver(int generation, int pageIndex, double dpi, const QRect& region, const QImage& image);
+
+protected:
+	virtual void run();
+
+private:
+	struct Request {
+		int pageIndex;
+		double dpi;
+		QRect region;
+	};
+
+	QMutex mutex;
+	QWaitCondition condition;
+	QList<Request> queue;
+	QString fileName;
+	bool useDiskCache;
+	QString contentHash;	// of fileName, empty until known
+	int generation;
+	bool stopping;
+};
+
+#endif
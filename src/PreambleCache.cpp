@@ -0,0 +1,279 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#include "PreambleCache.h"
+#include "TWUtils.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSettings>
+#include <QDateTime>
+#include <QTextStream>
+#include <QCryptographicHash>
+
+// position of the comment character in a line of TeX source, or -1
+static int commentStart(const QByteArray& line)
+{
+	int backslashes = 0;
+	for (int i = 0; i < line.size(); ++i) {
+		if (line[i] == '\\')
+			++backslashes;
+		else {
+			if (line[i] == '%' && backslashes % 2 == 0)
+				return i;
+			backslashes = 0;
+		}
+	}
+	return -1;
+}
+
+PreambleCache::PreambleCache(const QString& rootFile, const QString& program)
+	: rootFilePath(rootFile), exeFilePath(program), endOfDump(false), dumping(false)
+{
+	QFile file(rootFile);
+	if (!file.open(QIODevice::ReadOnly))
+		return;
+	// work on the raw bytes so the dumped preamble keeps the file's encoding
+	const QByteArray text = file.readAll();
+
+	bool hasClass = false;
+	int pos = 0;
+	while (pos < text.size()) {
+		int eol = text.indexOf('\n', pos);
+		if (eol < 0)
+			eol = text.size();
+		QByteArray line = text.mid(pos, eol - pos);
+		int comment = commentStart(line);
+		if (comment >= 0)
+			line.truncate(comment);
+		if (line.contains("\\documentclass"))
+			hasClass = true;
+		int end = line.indexOf("\\endofdump");
+		if (end >= 0) {
+			preamble = text.left(pos + end);
+			endOfDump = true;
+			break;
+		}
+		end = line.indexOf("\\begin{document}");
+		if (end >= 0) {
+			preamble = text.left(pos + end);
+			break;
+		}
+		pos = eol + 1;
+	}
+	// only LaTeX documents can skip their preamble
+	if (!hasClass) {
+		preamble.clear();
+		return;
+	}
+
+	baseFormat = QFileInfo(program).completeBaseName();
+	formatName = "tw-" + baseFormat + "-"
+		+ QCryptographicHash::hash(rootFile.toUtf8(), QCryptographicHash::Md5).toHex().left(12);
+
+	QCryptographicHash h(QCryptographicHash::Sha1);
+	h.addData(QFile::encodeName(program));
+	h.addData("\n", 1);
+	h.addData(preamble);
+	hash = h.result().toHex();
+}
+
+QString PreambleCache::cacheDirectory()
+{
+	return TWUtils::cachePath("formats");
+}
+
+QString PreambleCache::manifestPath() const
+{
+	return cacheDirectory() + "/" + formatName + ".ini";
+}
+
+QString PreambleCache::formatPath() const
+{
+	return cacheDirectory() + "/" + formatName + ".fmt";
+}
+
+QString PreambleCache::driverPath() const
+{
+	return cacheDirectory() + "/" + formatName + ".ltx";
+}
+
+bool PreambleCache::isValid() const
+{
+	if (!hasPreamble() || !QFileInfo(formatPath()).exists())
+		return false;
+	// the engine loads whatever format it finds there; a directory someone
+	// else could have written to is not used at all
+	if (!TWUtils::makePrivateDirectory(cacheDirectory()))
+		return false;
+
+	QSettings manifest(manifestPath(), QSettings::IniFormat);
+	if (manifest.value("hash").toByteArray() != hash || manifest.value("failed", false).toBool())
+		return false;
+
+	// the format is stale as soon as anything it was built from has changed
+	const QStringList files = manifest.value("files").toStringList();
+	const QStringList times = manifest.value("modified").toStringList();
+	if (files.count() != times.count())
+		return false;
+	for (int i = 0; i < files.count(); ++i) {
+		QFileInfo fi(files[i]);
+		if (!fi.exists() || QString::number(fi.lastModified().toTime_t()) != times[i])
+			return false;
+	}
+	return true;
+}
+
+bool PreambleCache::hasFailed() const
+{
+	if (!hasPreamble())
+		return false;
+	QSettings manifest(manifestPath(), QSettings::IniFormat);
+	return manifest.value("hash").toByteArray() == hash && manifest.value("failed", false).toBool();
+}
+
+bool PreambleCache::prepareDump()
+{
+	if (!hasPreamble() || !TWUtils::makePrivateDirectory(cacheDirectory()))
+		return false;
+	QFile::remove(formatPath());
+
+	QFile driver(driverPath());
+	if (!driver.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+	driver.write(preamble);
+	// when the document is typeset with the format, \documentclass skips
+	// the part of the preamble that is already loaded
+	driver.write("\n\\makeatletter\n");
+	if (endOfDump) {
+		driver.write("\\long\\def\\tw@skippreamble#1\\endofdump{}\n"
+					 "\\let\\endofdump\\relax\n");
+	}
+	else {
+		driver.write("\\def\\tw@document{document}\n"
+					 "\\long\\def\\tw@skippreamble#1\\begin#2{\\def\\tw@arg{#2}%\n"
+					 "  \\ifx\\tw@arg\\tw@document\\expandafter\\tw@begindocument\n"
+					 "  \\else\\expandafter\\tw@skippreamble\\fi}\n"
+					 "\\def\\tw@begindocument{\\begin{document}}\n");
+	}
+	driver.write("\\let\\documentclass\\tw@skippreamble\n"
+				 "\\makeatother\n"
+				 "\\dump\n");
+	if (!driver.flush())
+		return false;
+
+	dumping = true;
+	dumpTimer.start();
+	return true;
+}
+
+QStringList PreambleCache::dumpArguments() const
+{
+	return QStringList() << "-ini" << "-interaction=nonstopmode" << "-recorder"
+						 << "-output-directory=" + cacheDirectory()
+						 << "-jobname=" + formatName
+						 << "&" + baseFormat << driverPath();
+}
+
+bool PreambleCache::dumpFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+	dumping = false;
+	int elapsed = dumpTimer.elapsed();
+
+	QSettings manifest(manifestPath(), QSettings::IniFormat);
+	manifest.clear();
+	manifest.setValue("hash", hash);
+	if (exitStatus != QProcess::NormalExit || exitCode != 0 || !QFileInfo(formatPath()).exists()) {
+		manifest.setValue("failed", true);
+		return false;
+	}
+
+	// collect everything the ini run read from the recorder file
+	QStringList files, times;
+	QFile fls(cacheDirectory() + "/" + formatName + ".fls");
+	if (fls.open(QIODevice::ReadOnly | QIODevice::Text)) {
+		QTextStream in(&fls);
+		QDir pwd(QFileInfo(rootFilePath).absolutePath());
+		const QString driver = QFileInfo(driverPath()).absoluteFilePath();
+		while (!in.atEnd()) {
+			QString line = in.readLine();
+			if (line.startsWith("PWD "))
+				pwd.setPath(line.mid(4));
+			else if (line.startsWith("INPUT ")) {
+				QFileInfo fi(pwd, line.mid(6));
+				QString path = fi.absoluteFilePath();
+				if (path == driver || files.contains(path))
+					continue;
+				files << path;
+				times << QString::number(fi.lastModified().toTime_t());
+			}
+		}
+	}
+	manifest.setValue("files", files);
+	manifest.setValue("modified", times);
+	manifest.setValue("dumpTime", elapsed);
+	manifest.setValue("hits", 0);
+	return true;
+}
+
+QStringList PreambleCache::formatArguments(const QStringList& args) const
+{
+	return QStringList("-fmt=" + formatName) + args;
+}
+
+QStringList PreambleCache::formatEnvironment(const QStringList& env) const
+{
+#ifdef Q_WS_WIN
+	const QString sep(";");
+#else
+	const QString sep(":");
+#endif
+	QStringList result;
+	QString texFormats = cacheDirectory() + sep;
+	foreach (const QString& var, env) {
+		if (var.startsWith("TEXFORMATS=", Qt::CaseInsensitive))
+			texFormats += var.mid(11);
+		else
+			result << var;
+	}
+	result << "TEXFORMATS=" + texFormats;
+	return result;
+}
+
+int PreambleCache::recordHit()
+{
+	QSettings manifest(manifestPath(), QSettings::IniFormat);
+	manifest.setValue("hits", manifest.value("hits", 0).toInt() + 1);
+	return manifest.value("dumpTime", 0).toInt();
+}
+
+int PreambleCache::hits() const
+{
+	QSettings manifest(manifestPath(), QSettings::IniFormat);
+	return manifest.value("hits", 0).toInt();
+}
+
+int PreambleCache::dumpTime() const
+{
+	QSettings manifest(manifestPath(), QSettings::IniFormat);
+	return manifest.value("dumpTime", 0).toInt();
+}
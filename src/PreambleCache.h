@@ -0,0 +1,89 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#ifndef PreambleCache_H
+#define PreambleCache_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QTime>
+#include <QProcess>
+
+// Keeps a format file with the preamble of a LaTeX root document already
+// loaded. The format is dumped in ini mode (in the style of mylatexformat)
+// whenever the preamble text changes or any file read while dumping it
+// (classes, packages, the base format) has changed on disk; later runs load
+// it with -fmt and skip the preamble of the document itself. Everything up
+// to \begin{document} is cached, or up to \endofdump if the preamble
+// contains that marker; the rest of the preamble is then executed normally.
+class PreambleCache
+{
+public:
+	PreambleCache(const QString& rootFile, const QString& program);
+
+	// false if the root file has no recognizable preamble
+	bool hasPreamble() const { return !preamble.isEmpty(); }
+	// the format exists and is up to date, in a cache directory that only
+	// the current user can write to
+	bool isValid() const;
+	// the preamble is known to fail in ini mode; don't try again until it changes
+	bool hasFailed() const;
+
+	const QString& program() const { return exeFilePath; }
+
+	// prepare the ini run; returns false if the cache directory isn't private
+	// or the dump driver cannot be written
+	bool prepareDump();
+	QStringList dumpArguments() const;
+	bool isDumping() const { return dumping; }
+	// record the outcome of the ini run; returns true if the format is usable
+	bool dumpFinished(int exitCode, QProcess::ExitStatus exitStatus);
+
+	// arguments and environment for a run that uses the format
+	QStringList formatArguments(const QStringList& args) const;
+	QStringList formatEnvironment(const QStringList& env) const;
+
+	// count a run that used the format; returns the time an uncached
+	// preamble took to load
+	int recordHit();
+	int hits() const;
+	int dumpTime() const;
+
+	static QString cacheDirectory();
+
+private:
+	QString manifestPath() const;
+	QString formatPath() const;
+	QString driverPath() const;
+
+	QString rootFilePath;
+	QString exeFilePath;
+	QString baseFormat;
+	QString formatName;
+	QByteArray preamble;
+	QByteArray hash;
+	bool endOfDump;
+	bool dumping;
+	QTime dumpTimer;
+};
+
+#endif
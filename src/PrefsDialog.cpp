@@ -834,6 +834,9 @@ QDialog::DialogCode ToolConfig::doToolConfig(QWidget *parent, Engine &engine)
 		item->setFlags(item->flags() | Qt::ItemIsEditable);
 	}
 	dlg.viewPdf->setChecked(engine.showPdf());
+	dlg.cachePreamble->setChecked(engine.cachePreamble());
+	dlg.buildDriver->setChecked(engine.buildDriver());
+	dlg.buildInMemory->setChecked(engine.buildInMemory());
 	
 	dlg.show();
 
@@ -847,6 +850,9 @@ QDialog::DialogCode ToolConfig::doToolConfig(QWidget *parent, Engine &engine)
 			args << dlg.arguments->item(i)->text();
 		engine.setArguments(args);
 		engine.setShowPdf(dlg.viewPdf->isChecked());
+		engine.setCachePreamble(dlg.cachePreamble->isChecked());
+		engine.setBuildDriver(dlg.buildDriver->isChecked());
+		engine.setBuildInMemory(dlg.buildInMemory->isChecked());
 	}
 
 	return result;
@@ -31,7 +31,7 @@ ResourcesDialog::ResourcesDialog(QWidget *parent)
 
 void ResourcesDialog::init()
 {
-	QSETTINGS_OBJECT(s);
+	QSETTINGS_BACKEND(s);
 
 	setupUi(this);
 	
@@ -0,0 +1,136 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#include "SettingsStore.h"
+#include "ConfigurableApp.h"
+
+// changes made in quick succession (e.g., by the Preferences dialog) are
+// written together
+const int kSyncDelay = 2000;
+
+SettingsStore *SettingsStore::theInstance = NULL;
+
+SettingsStore *SettingsStore::instance()
+{
+	if (theInstance == NULL)
+		theInstance = new SettingsStore(QCoreApplication::instance());
+	return theInstance;
+}
+
+SettingsStore::SettingsStore(QObject *parent)
+	: QObject(parent)
+{
+	syncTimer.setSingleShot(true);
+	syncTimer.setInterval(kSyncDelay);
+	connect(&syncTimer, SIGNAL(timeout()), this, SLOT(sync()));
+	if (QCoreApplication::instance() != NULL)
+		connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), this, SLOT(sync()));
+
+	ConfigurableApp *app = ConfigurableApp::instance();
+	format = app->getSettingsFormat();
+#ifdef Q_WS_MAC
+	organization = app->organizationDomain();
+#else
+	organization = app->organizationName();
+#endif
+	application = app->applicationName();
+	load();
+}
+
+SettingsStore::~SettingsStore()
+{
+	sync();
+	if (theInstance == this)
+		theInstance = NULL;
+}
+
+void SettingsStore::load()
+{
+	QSettings settings(format, QSettings::UserScope, organization, application);
+	values.clear();
+	foreach (const QString& key, settings.allKeys())
+		values.insert(key, settings.value(key));
+}
+
+QVariant SettingsStore::value(const QString& key, const QVariant& defaultValue) const
+{
+	QHash<QString, QVariant>::const_iterator i = values.constFind(key);
+	return (i != values.constEnd() ? i.value() : defaultValue);
+}
+
+void SettingsStore::setValue(const QString& key, const QVariant& value)
+{
+	QHash<QString, QVariant>::iterator i = values.find(key);
+	if (i != values.end()) {
+		if (i.value() == value && i.value().type() == value.type())
+			return;
+		i.value() = value;
+	}
+	else
+		values.insert(key, value);
+	dirtyKeys.insert(key);
+	syncTimer.start();
+	emit valueChanged(key, value);
+}
+
+bool SettingsStore::contains(const QString& key) const
+{
+	return values.contains(key);
+}
+
+void SettingsStore::remove(const QString& key)
+{
+	QString prefix = key + "/";
+	QStringList keys;
+	foreach (const QString& k, values.keys()) {
+		if (k == key || k.startsWith(prefix))
+			keys << k;
+	}
+	foreach (const QString& k, keys) {
+		values.remove(k);
+		dirtyKeys.remove(k);
+	}
+	removedKeys << key;
+	syncTimer.start();
+	foreach (const QString& k, keys)
+		emit valueChanged(k, QVariant());
+}
+
+void SettingsStore::sync()
+{
+	syncTimer.stop();
+	if (dirtyKeys.isEmpty() && removedKeys.isEmpty())
+		return;
+	QSettings settings(format, QSettings::UserScope, organization, application);
+	// removals first: a key may have been removed and set again since the last sync
+	foreach (const QString& key, removedKeys)
+		settings.remove(key);
+	foreach (const QString& key, dirtyKeys)
+		settings.setValue(key, values.value(key));
+	removedKeys.clear();
+	dirtyKeys.clear();
+}
+
+void SettingsStore::reload()
+{
+	sync();
+	load();
+}
@@ -0,0 +1,82 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#ifndef SettingsStore_H
+#define SettingsStore_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QVariant>
+#include <QStringList>
+#include <QTimer>
+#include <QSettings>
+
+// The application preferences, read from disk once and then served from
+// memory. Changes take effect immediately for all readers, are announced
+// through valueChanged(), and are written back in batches a moment later
+// (and when the application quits). All access to the preferences should go
+// through QSETTINGS_OBJECT, which yields this store; code that must talk to
+// QSettings directly (e.g., for arrays) calls reload() when it's done.
+class SettingsStore : public QObject
+{
+	Q_OBJECT
+
+public:
+	static SettingsStore *instance();
+
+	QVariant value(const QString& key, const QVariant& defaultValue = QVariant()) const;
+	void setValue(const QString& key, const QVariant& value);
+	bool contains(const QString& key) const;
+	// removes key and everything below it (like QSettings::remove)
+	void remove(const QString& key);
+
+public slots:
+	// write pending changes to disk now
+	void sync();
+	// sync, then read everything from disk again
+	void reload();
+
+signals:
+	// value is invalid if the key was removed
+	void valueChanged(const QString& key, const QVariant& value);
+
+private:
+	SettingsStore(QObject *parent = NULL);
+	virtual ~SettingsStore();
+
+	void load();
+
+	// where the preferences live, taken from the application when the store
+	// is created; the store may outlive the application object
+	QSettings::Format format;
+	QString organization;
+	QString application;
+
+	QHash<QString, QVariant> values;
+	QSet<QString> dirtyKeys;
+	QStringList removedKeys;
+	QTimer syncTimer;
+
+	static SettingsStore *theInstance;
+};
+
+#endif
@@ -30,6 +30,10 @@
 #include "TWVersion.h"
 #include "SvnRev.h"
 #include "ResourcesDialog.h"
+#include "DictionaryManager.h"
+#include "EngineResolver.h"
+#include "TypesetScheduler.h"
+#include "FilePropertyStore.h"
 
 #ifdef Q_WS_WIN
 #include "DefaultBinaryPathsWin.h"
@@ -86,6 +90,8 @@ TWApp::TWApp(int &argc, char **argv)
 	, defaultBinPaths(NULL)
 	, engineList(NULL)
 	, defaultEngineIndex(0)
+	, recentGeneration(1)
+	, windowGeneration(1)
 	, scriptManager(NULL)
 #ifdef Q_WS_WIN
 	, messageTargetWindow(NULL)
@@ -100,6 +106,9 @@ TWApp::~TWApp()
 		scriptManager->saveDisabledList();
 		delete scriptManager;
 	}
+	// the store is only destroyed after the application; write what was
+	// changed since aboutToQuit() now
+	SettingsStore::instance()->sync();
 }
 
 void TWApp::init()
@@ -190,6 +199,15 @@ void TWApp::init()
 
 	TWUtils::readConfig();
 
+	// start loading the spelling dictionaries we're likely to need, so that
+	// opening the first document doesn't have to wait for them
+	QStringList preloadDicts = settings.value("preloadDictionaries").toStringList();
+	QString defDict = settings.value("language", "None").toString();
+	if (defDict != "None")
+		preloadDicts.prepend(defDict);
+	DictionaryManager::instance()->preload(preloadDicts);
+	EngineResolver::instance()->probeAll();
+
 	scriptManager = new TWScriptManager;
 
 #ifdef Q_WS_MAC
@@ -222,7 +240,7 @@ void TWApp::init()
 	connect(actionOpen, SIGNAL(triggered()), this, SLOT(open()));
 
 	menuRecent = new QMenu(tr("Open Recent"));
-	updateRecentFileActions();
+	connect(menuRecent, SIGNAL(aboutToShow()), this, SLOT(updateRecentFileMenu()));
 	menuFile->addMenu(menuRecent);
 
 	menuHelp = menuBar->addMenu(tr("Help"));
@@ -716,15 +734,22 @@ void TWApp::setMaxRecentFiles(int value)
 }
 
 void TWApp::updateRecentFileActions()
+{
+	// the menus catch up when they are shown next
+	++recentGeneration;
+	emit recentFileActionsChanged();
+}
+
+void TWApp::updateRecentFileMenu()
 {
 #ifdef Q_WS_MAC
-	TWUtils::updateRecentFileActions(this, recentFileActions, menuRecent);	
+	TWUtils::updateRecentFileActions(this, recentFileActions, menuRecent);
 #endif
-	emit recentFileActionsChanged();
 }
 
 void TWApp::updateWindowMenus()
 {
+	++windowGeneration;
 	emit windowListChanged();
 }
 
@@ -824,6 +849,7 @@ void TWApp::setBinaryPaths(const QStringList& paths)
 	*binaryPaths = paths;
 	QSETTINGS_OBJECT(settings);
 	settings.setValue("binaryPaths", paths);
+	emit binaryPathsChanged();
 }
 
 void TWApp::setDefaultEngineList()
@@ -844,6 +870,9 @@ void TWApp::setDefaultEngineList()
 		<< Engine("ConTeXt (XeTeX)", "texexec" EXE, QStringList("--synctex") << "--xtx" << "$fullname", true)
 		<< Engine("BibTeX", "bibtex" EXE, QStringList("$basename"), false)
 		<< Engine("MakeIndex", "makeindex" EXE, QStringList("$basename"), false);
+	Engine build("pdfLaTeX (auto)", "pdflatex" EXE, QStringList("$synctexoption") << "$fullname", true);
+	build.setBuildDriver(true);
+	engineList->insert(3, build);
 	defaultEngineIndex = 1;
 }
 
@@ -854,23 +883,30 @@ const QList<Engine> TWApp::getEngineList()
 		bool foundList = false;
 		// check for old engine list in Preferences
 		QSETTINGS_OBJECT(settings);
-		int count = settings.beginReadArray("engines");
-		if (count > 0) {
-			for (int i = 0; i < count; ++i) {
-				settings.setArrayIndex(i);
-				Engine eng;
-				eng.setName(settings.value("name").toString());
-				eng.setProgram(settings.value("program").toString());
-				eng.setArguments(settings.value("arguments").toStringList());
-				eng.setShowPdf(settings.value("showPdf").toBool());
-				engineList->append(eng);
-				settings.remove("");
+		if (settings.contains("engines/size")) {
+			// arrays aren't supported by the SettingsStore
+			settings.sync();
+			QSETTINGS_BACKEND(legacySettings);
+			int count = legacySettings.beginReadArray("engines");
+			if (count > 0) {
+				for (int i = 0; i < count; ++i) {
+					legacySettings.setArrayIndex(i);
+					Engine eng;
+					eng.setName(legacySettings.value("name").toString());
+					eng.setProgram(legacySettings.value("program").toString());
+					eng.setArguments(legacySettings.value("arguments").toStringList());
+					eng.setShowPdf(legacySettings.value("showPdf").toBool());
+					engineList->append(eng);
+					legacySettings.remove("");
+				}
+				foundList = true;
+				saveEngineList();
 			}
-			foundList = true;
-			saveEngineList();
+			legacySettings.endArray();
+			legacySettings.remove("engines");
+			legacySettings.sync();
+			settings.reload();
 		}
-		settings.endArray();
-		settings.remove("engines");
 
 		if (!foundList) { // read engine list from config file
 			QDir configDir(TWUtils::getLibraryPath("configuration"));
@@ -885,6 +921,9 @@ const QList<Engine> TWApp::getEngineList()
 					eng.setProgram(toolsSettings.value("program").toString());
 					eng.setArguments(toolsSettings.value("arguments").toStringList());
 					eng.setShowPdf(toolsSettings.value("showPdf").toBool());
+					eng.setCachePreamble(toolsSettings.value("cachePreamble", false).toBool());
+					eng.setBuildDriver(toolsSettings.value("buildDriver", false).toBool());
+					eng.setBuildInMemory(toolsSettings.value("buildInMemory", false).toBool());
 					engineList->append(eng);
 					toolsSettings.endGroup();
 				}
@@ -912,6 +951,9 @@ void TWApp::saveEngineList()
 		toolsSettings.setValue("program", e.program());
 		toolsSettings.setValue("arguments", e.arguments());
 		toolsSettings.setValue("showPdf", e.showPdf());
+		toolsSettings.setValue("cachePreamble", e.cachePreamble());
+		toolsSettings.setValue("buildDriver", e.buildDriver());
+		toolsSettings.setValue("buildInMemory", e.buildInMemory());
 		toolsSettings.endGroup();
 	}
 }
@@ -1028,44 +1070,22 @@ void TWApp::applyTranslation(const QString& locale)
 
 void TWApp::addToRecentFiles(const QMap<QString,QVariant>& fileProperties)
 {
-	QSETTINGS_OBJECT(settings);
-
 	QString fileName = fileProperties.value("path").toString();
 	if (fileName.isEmpty())
 		return;
 	
-	QList<QVariant> fileList = settings.value("recentFiles").toList();
-	QList<QVariant>::iterator i = fileList.begin();
-	while (i != fileList.end()) {
-		QMap<QString,QVariant> h = i->toMap();
-		if (h.value("path").toString() == fileName)
-			i = fileList.erase(i);
-		else
-			++i;
-	}
-
-	fileList.prepend(fileProperties);
+	FilePropertyStore *store = FilePropertyStore::instance();
+	QStringList oldList = store->recentFiles(maxRecentFiles());
+	store->setProperties(fileName, fileProperties);
 
-	while (fileList.size() > maxRecentFiles())
-		fileList.removeLast();
-
-	settings.setValue("recentFiles", QVariant::fromValue(fileList));
-
-	updateRecentFileActions();
+	// saving or closing the most recent file again doesn't change the menus
+	if (store->recentFiles(maxRecentFiles()) != oldList)
+		updateRecentFileActions();
 }
 
 QMap<QString,QVariant> TWApp::getFileProperties(const QString& path)
 {
-	QSETTINGS_OBJECT(settings);
-	QList<QVariant> fileList = settings.value("recentFiles").toList();
-	QList<QVariant>::iterator i = fileList.begin();
-	while (i != fileList.end()) {
-		QMap<QString,QVariant> h = i->toMap();
-		if (h.value("path").toString() == path)
-			return h;
-		++i;
-	}
-	return QMap<QString,QVariant>();
+	return FilePropertyStore::instance()->properties(path);
 }
 
 void TWApp::openHelpFile(const QString& helpDirName)
@@ -1178,6 +1198,11 @@ QList<QVariant> TWApp::getOpenWindows() const
 	return result;
 }
 
+QList<QVariant> TWApp::getTypesetJobs() const
+{
+	return TypesetScheduler::instance()->jobs();
+}
+
 void TWApp::setGlobal(const QString& key, const QVariant& val)
 {
 	QVariant v = val;
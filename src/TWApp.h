@@ -74,6 +74,10 @@ public:
 	virtual ~TWApp();
 
 	int maxRecentFiles() const;
+	// bumped whenever the recent files or the open windows change; menus
+	// listing them compare this when they are about to be shown
+	int recentFilesGeneration() const { return recentGeneration; }
+	int windowListGeneration() const { return windowGeneration; }
 	void setMaxRecentFiles(int value);
 	void addToRecentFiles(const QMap<QString,QVariant>& fileProperties);
 
@@ -87,7 +91,7 @@ public:
 	const QStringList getBinaryPaths(QStringList& sysEnv);
 		// runtime paths, including $PATH;
 		// also modifies passed-in sysEnv to include paths from prefs
-	QString findProgram(const QString& program, const QStringList& binPaths);
+	static QString findProgram(const QString& program, const QStringList& binPaths);
 
 	const QStringList getPrefsBinaryPaths(); // only paths from prefs
 	const QList<Engine> getEngineList();
@@ -125,6 +129,9 @@ public:
 	QMap<QString, QVariant> openFileFromScript(const QString& fileName, QObject * scriptApiObj, const int pos = -1, const bool askUser = false);
 
 	Q_INVOKABLE QList<QVariant> getOpenWindows() const;
+
+	// typesetting jobs that are running or waiting (see TypesetScheduler::jobs())
+	Q_INVOKABLE QList<QVariant> getTypesetJobs() const;
 	
 	// return the version of Tw (0xMMNNPP)
 	Q_INVOKABLE
@@ -210,6 +217,9 @@ signals:
 	// emitted when the engine list is changed from Preferences, so docs can update their menus
 	void engineListChanged();
 	
+	// emitted when the binary search paths are changed from Preferences
+	void binaryPathsChanged();
+	
 	void scriptListChanged();
 	
 	void syncPdf(const QString& sourceFile, int lineNo, bool activatePreview);
@@ -223,6 +233,7 @@ signals:
 private slots:	
 	void newFromTemplate();
 	void openRecentFile();
+	void updateRecentFileMenu();
 	void preferences();
 
 	void changeLanguage();
@@ -238,6 +249,8 @@ private:
 	void arrangeWindows(TWUtils::WindowArrangementFunction func);
 
 	int recentFilesLimit;
+	int recentGeneration;
+	int windowGeneration;
 
 	QTextCodec *defaultCodec;
 
@@ -21,6 +21,7 @@
 
 #include "TWScriptAPI.h"
 #include "TWSystemCmd.h"
+#include "BuildStatistics.h"
 
 #include <QObject>
 #include <QString>
@@ -340,3 +341,10 @@ QMap<QString, QVariant> TWScriptAPI::readFile(const QString& filename) const
 	return retVal;
 }
 
+QList<QVariant> TWScriptAPI::getBuildHistory(const QString& rootFile) const
+{
+	QList<QVariant> result;
+	foreach (const BuildRecord& build, BuildStatistics::instance()->history(rootFile))
+		result << build.toMap();
+	return result;
+}
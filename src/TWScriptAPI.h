@@ -100,6 +100,12 @@ public:
 	// Content is read in text-mode in utf8 encoding
 	Q_INVOKABLE
 	QMap<QString, QVariant> readFile(const QString& filename) const;
+
+	// Build history of a root document, oldest first; one map per build with
+	// the fields "finished", "engine", "wallMsecs", "cpuMsecs", "peakRssKB",
+	// "passes", "pages", "pdfSize" and "exitCode" (-1 where not available)
+	Q_INVOKABLE
+	QList<QVariant> getBuildHistory(const QString& rootFile) const;
 	
 	// QMessageBox functions to display alerts
 	Q_INVOKABLE
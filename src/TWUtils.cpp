@@ -23,6 +23,7 @@
 #include "TWApp.h"
 #include "TeXDocument.h"
 #include "PDFDocument.h"
+#include "FilePropertyStore.h"
 
 #include <QFileDialog>
 #include <QString>
@@ -39,6 +40,14 @@
 #include <QSignalMapper>
 #include <QCryptographicHash>
 #include <QTextStream>
+#include <QDesktopServices>
+
+#ifdef Q_OS_UNIX
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
 
 #pragma mark === TWUtils ===
 
@@ -418,31 +427,6 @@ QHash<QString, QString>* TWUtils::getDictionaryList(const bool forceReload /* =
 	return dictionaryList;
 }
 
-QHash<const QString,Hunhandle*> *TWUtils::dictionaries = NULL;
-
-Hunhandle* TWUtils::getDictionary(const QString& language)
-{
-	if (language.isEmpty())
-		return NULL;
-	
-	if (dictionaries == NULL)
-		dictionaries = new QHash<const QString,Hunhandle*>;
-	
-	if (dictionaries->contains(language))
-		return dictionaries->value(language);
-	
-	Hunhandle *h = NULL;
-	const QString dictPath = getLibraryPath("dictionaries");
-	QFileInfo affFile(dictPath + "/" + language + ".aff");
-	QFileInfo dicFile(dictPath + "/" + language + ".dic");
-	if (affFile.isReadable() && dicFile.isReadable()) {
-		h = Hunspell_create(affFile.canonicalFilePath().toLocal8Bit().data(),
-							dicFile.canonicalFilePath().toLocal8Bit().data());
-		(*dictionaries)[language] = h;
-	}
-	return h;
-}
-
 QStringList* TWUtils::filters;
 QStringList* TWUtils::filterList()
 {
@@ -489,32 +473,26 @@ QString TWUtils::strippedName(const QString &fullFileName)
 	return QFileInfo(fullFileName).fileName();
 }
 
+// menus remember the generation of the list they show, so they are only
+// updated when they are about to be shown and the list has changed since
+static const char * const kMenuGenerationProperty = "TWListGeneration";
+// marks the actions that make up the window list
+static const char * const kWindowListProperty = "TWWindowListItem";
+
+static bool menuIsCurrent(QMenu *menu, int generation)
+{
+	if (menu->property(kMenuGenerationProperty).toInt() == generation)
+		return true;
+	menu->setProperty(kMenuGenerationProperty, generation);
+	return false;
+}
+
 void TWUtils::updateRecentFileActions(QObject *parent, QList<QAction*> &actions, QMenu *menu) /* static */
 {
-	QSETTINGS_OBJECT(settings);
-	QStringList fileList;
-	if (settings.contains("recentFiles")) {
-		QList<QVariant> files = settings.value("recentFiles").toList();
-		foreach (const QVariant& v, files) {
-			QMap<QString,QVariant> map = v.toMap();
-			if (map.contains("path"))
-				fileList.append(map.value("path").toString());
-		}
-	}
-	else {
-		// check for an old "recentFilesList" entry, and migrate it
-		if (settings.contains("recentFileList")) {
-			fileList = settings.value("recentFileList").toStringList();
-			QList<QVariant> files;
-			foreach (const QString& path, fileList) {
-				QMap<QString,QVariant> map;
-				map.insert("path", path);
-				files.append(QVariant(map));
-			}
-			settings.remove("recentFileList");
-			settings.setValue("recentFiles", files);
-		}
-	}
+	if (menuIsCurrent(menu, TWApp::instance()->recentFilesGeneration()))
+		return;
+
+	QStringList fileList = FilePropertyStore::instance()->recentFiles(TWApp::instance()->maxRecentFiles());
 	
 	int numRecentFiles = fileList.size();
 
@@ -533,59 +511,94 @@ void TWUtils::updateRecentFileActions(QObject *parent, QList<QAction*> &actions,
 
 	for (int i = 0; i < numRecentFiles; ++i) {
 		QString path = fileList[i];
-		QString text = TWUtils::strippedName(path);
-		actions[i]->setText(text);
+		if (actions[i]->data().toString() == path)
+			continue;
+		actions[i]->setText(TWUtils::strippedName(path));
 		actions[i]->setData(path);
 		actions[i]->setVisible(true);
 	}
 }
 
+// one line of the window list: a separator, or a window to select
+struct WindowMenuItem {
+	QObject *window;	// NULL for a separator
+	QString fileName;
+	bool modified;
+	bool current;
+};
+
+static bool windowMenuItemMatches(QAction *action, const WindowMenuItem& item)
+{
+	if (item.window == NULL)
+		return action->isSeparator();
+	SelWinAction *selWin = qobject_cast<SelWinAction*>(action);
+	return (selWin != NULL && selWin->target() == item.window);
+}
+
 void TWUtils::updateWindowMenu(QWidget *window, QMenu *menu) /* static */
 {
-	// shorten the menu by removing everything from the first "selectWindow" action onwards
-	QList<QAction*> actions = menu->actions();
-	for (QList<QAction*>::iterator i = actions.begin(); i != actions.end(); ++i) {
-		SelWinAction *selWin = qobject_cast<SelWinAction*>(*i);
-		if (selWin)
-			menu->removeAction(*i);
-	}
-	while (!menu->actions().isEmpty() && menu->actions().last()->isSeparator())
-		menu->removeAction(menu->actions().last());
-	
-	// append an item for each TeXDocument
-	bool first = true;
+	if (menuIsCurrent(menu, TWApp::instance()->windowListGeneration()))
+		return;
+
+	// what the list should look like: the TeXDocuments, then the PDFDocuments,
+	// each group preceded by a separator
+	QList<WindowMenuItem> items;
+	WindowMenuItem separator;
+	separator.window = NULL;
+	separator.modified = separator.current = false;
 	foreach (TeXDocument *texDoc, TeXDocument::documentList()) {
-		if (first && !menu->actions().isEmpty())
-			menu->addSeparator();
-		first = false;
-		QString label = texDoc->fileName();
-		SelWinAction *selWin = new SelWinAction(menu, label);
-		if (texDoc->isModified()) {
-			QFont f(selWin->font());
-			f.setItalic(true);
-			selWin->setFont(f);
-		}
-		if (texDoc == qobject_cast<TeXDocument*>(window)) {
-			selWin->setCheckable(true);
-			selWin->setChecked(true);
-		}
-		QObject::connect(selWin, SIGNAL(triggered()), texDoc, SLOT(selectWindow()));
-		menu->addAction(selWin);
+		if (items.isEmpty())
+			items << separator;
+		WindowMenuItem item;
+		item.window = texDoc;
+		item.fileName = texDoc->fileName();
+		item.modified = texDoc->isModified();
+		item.current = (texDoc == qobject_cast<TeXDocument*>(window));
+		items << item;
 	}
-	
-	// append an item for each PDFDocument
-	first = true;
+	bool first = true;
 	foreach (PDFDocument *pdfDoc, PDFDocument::documentList()) {
-		if (first && !menu->actions().isEmpty())
-			menu->addSeparator();
+		if (first)
+			items << separator;
 		first = false;
-		SelWinAction *selWin = new SelWinAction(menu, pdfDoc->fileName());
-		if (pdfDoc == qobject_cast<PDFDocument*>(window)) {
-			selWin->setCheckable(true);
-			selWin->setChecked(true);
+		WindowMenuItem item;
+		item.window = pdfDoc;
+		item.fileName = pdfDoc->fileName();
+		item.modified = false;
+		item.current = (pdfDoc == qobject_cast<PDFDocument*>(window));
+		items << item;
+	}
+
+	// the actions added last time are at the end of the menu; keep those that
+	// still stand for the same window and replace the rest
+	QList<QAction*> listActions;
+	foreach (QAction *action, menu->actions()) {
+		if (action->property(kWindowListProperty).toBool())
+			listActions << action;
+	}
+	int i = 0;
+	while (i < items.count() && i < listActions.count() && windowMenuItemMatches(listActions[i], items[i])) {
+		SelWinAction *selWin = qobject_cast<SelWinAction*>(listActions[i]);
+		if (selWin)
+			selWin->update(items[i].fileName, items[i].modified, items[i].current);
+		++i;
+	}
+	for (int j = i; j < listActions.count(); ++j)
+		delete listActions[j];
+	for (; i < items.count(); ++i) {
+		QAction *action;
+		if (items[i].window == NULL) {
+			action = new QAction(menu);
+			action->setSeparator(true);
 		}
-		QObject::connect(selWin, SIGNAL(triggered()), pdfDoc, SLOT(selectWindow()));
-		menu->addAction(selWin);
+		else {
+			SelWinAction *selWin = new SelWinAction(menu, items[i].fileName);
+			selWin->setTarget(items[i].window);
+			selWin->update(items[i].fileName, items[i].modified, items[i].current);
+			action = selWin;
+		}
+		action->setProperty(kWindowListProperty, true);
+		menu->addAction(action);
 	}
 }
 
@@ -947,6 +960,59 @@ const QString& TWUtils::cleanupPatterns()
 	return sCleanupPatterns;
 }
 
+QString TWUtils::cachePath(const QString& subdir)
+{
+	QString dir = QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+	if (dir.isEmpty())
+		return privatePath(QDir::tempPath(), "texworks-" + subdir);
+	return dir + "/" + subdir;
+}
+
+QString TWUtils::privatePath(const QString& dir, const QString& name)
+{
+#ifdef Q_OS_UNIX
+	return dir + "/" + name + "-" + QString::number(::getuid());
+#else
+	// the temporary directory is per user already
+	return dir + "/" + name;
+#endif
+}
+
+bool TWUtils::makePrivateDirectory(const QString& dirPath)
+{
+	if (!QDir().mkpath(QFileInfo(dirPath).absolutePath()))
+		return false;
+#ifdef Q_OS_UNIX
+	QByteArray path = QFile::encodeName(dirPath);
+	if (::mkdir(path.constData(), 0700) != 0 && errno != EEXIST)
+		return false;
+	// in a shared directory, someone else may have created it first, or put
+	// a link to somewhere else in its place
+	struct stat info;
+	if (::lstat(path.constData(), &info) != 0 || !S_ISDIR(info.st_mode) || info.st_uid != ::getuid())
+		return false;
+	if ((info.st_mode & 077) != 0 && ::chmod(path.constData(), 0700) != 0)
+		return false;
+	return true;
+#else
+	return QDir().mkpath(dirPath);
+#endif
+}
+
+bool TWUtils::removeDirectory(const QString& dirPath)
+{
+	QDir dir(dirPath);
+	bool ok = true;
+	// links are removed, never followed
+	foreach (const QFileInfo& info, dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System)) {
+		if (info.isDir() && !info.isSymLink())
+			ok = removeDirectory(info.absoluteFilePath()) && ok;
+		else
+			ok = dir.remove(info.fileName()) && ok;
+	}
+	return dir.rmdir(dirPath) && ok;
+}
+
 void TWUtils::readConfig()
 {
 	pairOpeners.clear();
@@ -1036,35 +1102,6 @@ void TWUtils::readConfig()
 		setDefaultFilters();
 }
 
-int TWUtils::balanceDelim(const QString& text, int pos, QChar delim, int direction)
-{
-	int len = text.length();
-	QChar c;
-	while ((c = text[pos]) != delim) {
-		if (openerMatching(c) != 0)
-			pos = (direction < 0) ? balanceDelim(text, pos - 1, openerMatching(c), -1) : -1;
-		else if (closerMatching(c) != 0)
-			pos = (direction > 0) ? balanceDelim(text, pos + 1, closerMatching(c), 1) : -1;
-		if (pos < 0)
-			return -1;
-		pos += direction;
-		if (pos < 0 || pos >= len)
-			return -1;
-	}
-	return pos;
-}
-
-int TWUtils::findOpeningDelim(const QString& text, int pos)
-	// find the first opening delimiter before offset /pos/
-{
-	while (--pos >= 0) {
-		QChar c = text[pos];
-		if (closerMatching(c) != 0)
-			return pos;
-	}
-	return -1;
-}
-
 void TWUtils::installCustomShortcuts(QWidget * widget, bool recursive /* = true */, QSettings * map /* = NULL */)
 {
 	bool deleteMap = false;
@@ -1117,6 +1154,30 @@ SelWinAction::SelWinAction(QObject *parent, const QString &fileName)
 	setData(fileName);
 }
 
+void SelWinAction::setTarget(QObject *window)
+{
+	if (targetWindow)
+		disconnect(this, SIGNAL(triggered()), targetWindow, SLOT(selectWindow()));
+	targetWindow = window;
+	if (targetWindow)
+		connect(this, SIGNAL(triggered()), targetWindow, SLOT(selectWindow()));
+}
+
+void SelWinAction::update(const QString &fileName, bool modified, bool current)
+{
+	if (data().toString() != fileName) {
+		setText(TWUtils::strippedName(fileName));
+		setData(fileName);
+	}
+	if (font().italic() != modified) {
+		QFont f(font());
+		f.setItalic(modified);
+		setFont(f);
+	}
+	setCheckable(current);
+	setChecked(current);
+}
+
 #pragma mark === CmdKeyFilter ===
 
 // on OS X only, the singleton CmdKeyFilter object is attached to all TeXDocument editor widgets
@@ -1153,17 +1214,19 @@ bool CmdKeyFilter::eventFilter(QObject *obj, QEvent *event)
 #pragma mark === Engine ===
 
 Engine::Engine()
-	: QObject()
+	: QObject(), f_cachePreamble(false), f_buildDriver(false), f_buildInMemory(false)
 {
 }
 
 Engine::Engine(const QString& name, const QString& program, const QStringList arguments, bool showPdf)
-	: QObject(), f_name(name), f_program(program), f_arguments(arguments), f_showPdf(showPdf)
+	: QObject(), f_name(name), f_program(program), f_arguments(arguments), f_showPdf(showPdf), f_cachePreamble(false),
+	  f_buildDriver(false), f_buildInMemory(false)
 {
 }
 
 Engine::Engine(const Engine& orig)
-	: QObject(), f_name(orig.f_name), f_program(orig.f_program), f_arguments(orig.f_arguments), f_showPdf(orig.f_showPdf)
+	: QObject(), f_name(orig.f_name), f_program(orig.f_program), f_arguments(orig.f_arguments), f_showPdf(orig.f_showPdf),
+	  f_cachePreamble(orig.f_cachePreamble), f_buildDriver(orig.f_buildDriver), f_buildInMemory(orig.f_buildInMemory)
 {
 }
 
@@ -1173,6 +1236,9 @@ Engine& Engine::operator=(const Engine& rhs)
 	f_program = rhs.f_program;
 	f_arguments = rhs.f_arguments;
 	f_showPdf = rhs.f_showPdf;
+	f_cachePreamble = rhs.f_cachePreamble;
+	f_buildDriver = rhs.f_buildDriver;
+	f_buildInMemory = rhs.f_buildInMemory;
 	return *this;
 }
 
@@ -1196,6 +1262,21 @@ bool Engine::showPdf() const
 	return f_showPdf;
 }
 
+bool Engine::cachePreamble() const
+{
+	return f_cachePreamble;
+}
+
+bool Engine::buildDriver() const
+{
+	return f_buildDriver;
+}
+
+bool Engine::buildInMemory() const
+{
+	return f_buildInMemory;
+}
+
 void Engine::setName(const QString& name)
 {
 	f_name = name;
@@ -1216,6 +1297,21 @@ void Engine::setShowPdf(bool showPdf)
 	f_showPdf = showPdf;
 }
 
+void Engine::setCachePreamble(bool cachePreamble)
+{
+	f_cachePreamble = cachePreamble;
+}
+
+void Engine::setBuildDriver(bool buildDriver)
+{
+	f_buildDriver = buildDriver;
+}
+
+void Engine::setBuildInMemory(bool buildInMemory)
+{
+	f_buildInMemory = buildInMemory;
+}
+
 /*static*/
 FileVersionDatabase FileVersionDatabase::load(const QString & path)
 {
@@ -25,6 +25,7 @@
 #include "SvnRev.h"
 
 #include <QAction>
+#include <QPointer>
 #include <QString>
 #include <QList>
 #include <QDir>
@@ -65,9 +66,6 @@ public:
 	// get list of available dictionaries
 	static QHash<QString, QString> *getDictionaryList(const bool forceReload = false);
 	
-	// get dictionary for a given language
-	static Hunhandle *getDictionary(const QString& language);
-
 	// list of filename filters for the Open/Save dialogs
 	static QStringList* filterList();
 	static void setDefaultFilters();
@@ -100,9 +98,6 @@ public:
 	static QChar closerMatching(QChar c);
 	static QChar openerMatching(QChar c);
 	static void readConfig();
-	
-	static int balanceDelim(const QString& text, int pos, QChar delim, int direction);
-	static int findOpeningDelim(const QString& text, int pos);
 
 	static const QString& includeTextCommand();
 	static const QString& includePdfCommand();
@@ -110,6 +105,17 @@ public:
 	static const QString& includePostscriptCommand();
 	
 	static const QString& cleanupPatterns();
+
+	// subdir of the user's cache location; if the system has none, a
+	// per-user directory in the temporary directory
+	static QString cachePath(const QString& subdir);
+	// name in the shared directory dir, made unique to the current user
+	static QString privatePath(const QString& dir, const QString& name);
+	// create dirPath (and its parents) for the current user only; an existing
+	// directory is only accepted if it belongs to the user and is no link
+	static bool makePrivateDirectory(const QString& dirPath);
+	// delete dirPath and everything below it
+	static bool removeDirectory(const QString& dirPath);
 	
 	static void installCustomShortcuts(QWidget * widget, bool recursive = true, QSettings * map = NULL);
 
@@ -120,8 +126,6 @@ private:
 	static QHash<QString, QString>	*dictionaryList;
 	static QStringList				*translationList;
 
-	static QHash<const QString,Hunhandle*>	*dictionaries;
-
 	static QStringList			*filters;
 
 	static QMap<QChar,QChar>	pairOpeners;
@@ -141,6 +145,15 @@ class SelWinAction : public QAction
 	
 public:
 	SelWinAction(QObject *parent, const QString &fileName);
+
+	// the window (a TeXDocument or PDFDocument) whose selectWindow() is triggered
+	QObject *target() const { return targetWindow; }
+	void setTarget(QObject *window);
+	// show fileName, in italics if modified, checked if it is the menu's own window
+	void update(const QString &fileName, bool modified, bool current);
+
+private:
+	QPointer<QObject> targetWindow;
 };
 
 // filter used to stop Command-keys getting inserted into edit text items
@@ -174,17 +187,29 @@ public:
 	const QString program() const;
 	const QStringList arguments() const;
 	bool showPdf() const;
+	// dump the document preamble into a format and reuse it (LaTeX engines only)
+	bool cachePreamble() const;
+	// rerun the engine and BibTeX/Biber/MakeIndex until the document is complete
+	bool buildDriver() const;
+	// write the outputs to a scratch directory in memory; copy back PDF and SyncTeX
+	bool buildInMemory() const;
 
 	void setName(const QString& name);
 	void setProgram(const QString& program);
 	void setArguments(const QStringList& arguments);
 	void setShowPdf(bool showPdf);
+	void setCachePreamble(bool cachePreamble);
+	void setBuildDriver(bool buildDriver);
+	void setBuildInMemory(bool buildInMemory);
 
 private:
 	QString f_name;
 	QString f_program;
 	QStringList f_arguments;
 	bool f_showPdf;
+	bool f_cachePreamble;
+	bool f_buildDriver;
+	bool f_buildInMemory;
 };
 
 class FileVersionDatabase
@@ -0,0 +1,85 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#include "TeXBlockData.h"
+#include "TWUtils.h"
+#include "CompletionStore.h"
+
+TeXBlockData::TeXBlockData()
+	: net(0), minPrefix(0), maxSuffix(0), delimitersValid(false), highlightPending(false)
+{
+}
+
+TeXBlockData::~TeXBlockData()
+{
+	// the block is going away, so its words no longer count
+	CompletionStore *store = CompletionStore::existingInstance();
+	if (store && !words.isEmpty())
+		store->removeWords(words);
+}
+
+TeXBlockData *TeXBlockData::forBlock(QTextBlock block)
+{
+	TeXBlockData *data = static_cast<TeXBlockData*>(block.userData());
+	if (data == NULL) {
+		data = new TeXBlockData;
+		block.setUserData(data);
+	}
+	return data;
+}
+
+void TeXBlockData::scanDelimiters(const QString& text)
+{
+	delims.clear();
+	net = minPrefix = maxSuffix = 0;
+	for (int i = 0; i < text.length(); ++i) {
+		QChar c = text[i];
+		Delim d;
+		if (TWUtils::closerMatching(c) != 0)
+			d.sign = 1;
+		else if (TWUtils::openerMatching(c) != 0)
+			d.sign = -1;
+		else
+			continue;
+		d.offset = i;
+		delims.append(d);
+		net += d.sign;
+		if (net < minPrefix)
+			minPrefix = net;
+	}
+	int suffix = 0;
+	for (int i = delims.count() - 1; i >= 0; --i) {
+		suffix += delims[i].sign;
+		if (suffix > maxSuffix)
+			maxSuffix = suffix;
+	}
+	delimitersValid = true;
+}
+
+void TeXBlockData::setHarvestedWords(const QStringList& newWords)
+{
+	CompletionStore *store = CompletionStore::instance();
+	if (!words.isEmpty())
+		store->removeWords(words);
+	words = newWords;
+	if (!words.isEmpty())
+		store->addWords(words);
+}
@@ -0,0 +1,63 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#ifndef TeXBlockData_H
+#define TeXBlockData_H
+
+#include <QTextBlockUserData>
+#include <QTextBlock>
+#include <QVector>
+#include <QStringList>
+
+// Cached per-block information about the text of a TeXDocument; a block
+// can only hold one QTextBlockUserData, so everything that wants to keep
+// state per block shares this class.
+class TeXBlockData : public QTextBlockUserData
+{
+public:
+	TeXBlockData();
+	virtual ~TeXBlockData();
+
+	// returns the data attached to block, creating it if necessary
+	static TeXBlockData *forBlock(QTextBlock block);
+
+	// paired delimiters (as configured in delimiter-pairs.txt), see DelimiterIndex
+	void scanDelimiters(const QString& text);
+
+	struct Delim {
+		int offset;	// position within the block
+		int sign;	// +1 for openers, -1 for closers
+	};
+	QVector<Delim> delims;
+	int net;		// sum of all signs
+	int minPrefix;	// lowest running depth when reading forwards (<= 0)
+	int maxSuffix;	// highest sum of any trailing run (>= 0)
+	bool delimitersValid;
+
+	// words, labels and control sequences contributed to the CompletionStore
+	void setHarvestedWords(const QStringList& newWords);
+	QStringList words;
+
+	// set while the block still waits for TeXHighlighter's idle pass
+	bool highlightPending;
+};
+
+#endif
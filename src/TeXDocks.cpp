@@ -22,11 +22,15 @@
 #include "TeXDocks.h"
 
 #include "TeXDocument.h"
+#include "LogParser.h"
 
 #include <QTreeWidget>
 #include <QHeaderView>
 #include <QScrollBar>
 #include <QDomNode>
+#include <QLabel>
+#include <QVBoxLayout>
+#include <QPainter>
 
 TeXDock::TeXDock(const QString& title, TeXDocument *doc)
 	: QDockWidget(title, doc), document(doc), filled(false)
@@ -142,6 +146,214 @@ void TagsDock::followTagSelection()
 	}
 }
 
+//////////////// ISSUES ////////////////
+
+IssuesDock::IssuesDock(TeXDocument *doc)
+	: TeXDock(tr("Errors and Warnings"), doc)
+{
+	setObjectName("issues");
+	tree = new TeXDockTreeWidget(this);
+	tree->setRootIsDecorated(false);
+	tree->setHeaderLabels(QStringList() << tr("Type") << tr("File") << tr("Line") << tr("Message") << QString());
+	// the hidden last column holds the position in the log, the initial sort order
+	tree->setColumnHidden(4, true);
+	tree->setSortingEnabled(true);
+	tree->sortByColumn(4, Qt::AscendingOrder);
+	setWidget(tree);
+	connect(doc->logParser(), SIGNAL(cleared()), this, SLOT(clear()));
+	connect(doc->logParser(), SIGNAL(entryAdded(int)), this, SLOT(addEntry(int)));
+	connect(tree, SIGNAL(itemActivated(QTreeWidgetItem*, int)), this, SLOT(goToIssue(QTreeWidgetItem*)));
+	addTimer.setSingleShot(true);
+	addTimer.setInterval(0);
+	connect(&addTimer, SIGNAL(timeout()), this, SLOT(addPendingItems()));
+}
+
+IssuesDock::~IssuesDock()
+{
+	qDeleteAll(pendingItems);
+}
+
+void IssuesDock::fillInfo()
+{
+	clear();
+	for (int i = 0; i < document->logParser()->entries().count(); ++i)
+		pendingItems << createItem(i);
+	addPendingItems();
+}
+
+void IssuesDock::clear()
+{
+	qDeleteAll(pendingItems);
+	pendingItems.clear();
+	addTimer.stop();
+	tree->clear();
+}
+
+void IssuesDock::addEntry(int index)
+{
+	// the list is built when the dock is first shown
+	if (!filled)
+		return;
+	// entries come in one by one while the log is parsed; add them in batches
+	pendingItems << createItem(index);
+	addTimer.start();
+}
+
+void IssuesDock::addPendingItems()
+{
+	// a sorted tree would re-sort for every single item
+	tree->setSortingEnabled(false);
+	tree->addTopLevelItems(pendingItems);
+	pendingItems.clear();
+	tree->setSortingEnabled(true);
+}
+
+QTreeWidgetItem *IssuesDock::createItem(int index)
+{
+	const LogParser::Entry& entry = document->logParser()->entries().at(index);
+	QTreeWidgetItem *item = new QTreeWidgetItem();
+	switch (entry.type) {
+		case LogParser::Error:
+			item->setText(0, tr("Error"));
+			item->setForeground(0, Qt::red);
+			break;
+		case LogParser::Warning:
+			item->setText(0, tr("Warning"));
+			break;
+		case LogParser::BadBox:
+			item->setText(0, tr("Bad box"));
+			item->setForeground(0, Qt::gray);
+			break;
+	}
+	item->setText(1, QFileInfo(entry.file).fileName());
+	item->setToolTip(1, entry.file);
+	item->setData(1, Qt::UserRole, entry.file);
+	if (entry.line > 0)
+		item->setData(2, Qt::DisplayRole, entry.line);
+	item->setText(3, entry.message);
+	item->setToolTip(3, entry.message);
+	item->setData(4, Qt::DisplayRole, index);
+	return item;
+}
+
+void IssuesDock::goToIssue(QTreeWidgetItem *item)
+{
+	QString file = item->data(1, Qt::UserRole).toString();
+	if (!file.isEmpty())
+		TeXDocument::openDocument(file, true, true, item->data(2, Qt::DisplayRole).toInt());
+}
+
+//////////////// BUILD STATISTICS ////////////////
+
+BuildTimeChart::BuildTimeChart(QWidget *parent)
+	: QWidget(parent)
+{
+	setMinimumHeight(80);
+}
+
+BuildTimeChart::~BuildTimeChart()
+{
+}
+
+QSize BuildTimeChart::sizeHint() const
+{
+	return QSize(180, 120);
+}
+
+void BuildTimeChart::setRecords(const QList<BuildRecord>& newRecords)
+{
+	records = newRecords;
+	update();
+}
+
+void BuildTimeChart::paintEvent(QPaintEvent * /*event*/)
+{
+	QPainter painter(this);
+	painter.fillRect(rect(), palette().base());
+	if (records.isEmpty()) {
+		painter.setPen(palette().color(QPalette::Disabled, QPalette::Text));
+		painter.drawText(rect(), Qt::AlignCenter, tr("No builds in this session"));
+		return;
+	}
+
+	int maxMsecs = 1;
+	foreach (const BuildRecord& build, records)
+		maxMsecs = qMax(maxMsecs, qMax(build.wallMsecs, build.cpuMsecs));
+
+	const int labelHeight = fontMetrics().height();
+	QRect chartRect = rect().adjusted(4, labelHeight + 4, -4, -4);
+	painter.setPen(palette().color(QPalette::Text));
+	painter.drawText(rect().adjusted(4, 2, -4, 0), Qt::AlignLeft | Qt::AlignTop,
+					 tr("%1 s").arg(maxMsecs / 1000.0, 0, 'f', 1));
+
+	// wall time as a full bar, CPU time as a narrower bar inside it
+	qreal barWidth = qreal(chartRect.width()) / records.count();
+	for (int i = 0; i < records.count(); ++i) {
+		const BuildRecord& build = records[i];
+		qreal x = chartRect.left() + i * barWidth;
+		qreal h = qreal(chartRect.height()) * build.wallMsecs / maxMsecs;
+		QRectF bar(x + 1, chartRect.bottom() - h, qMax(barWidth - 2, qreal(1)), h);
+		painter.fillRect(bar, build.exitCode == 0 ? palette().highlight() : QBrush(Qt::red));
+		if (build.cpuMsecs >= 0) {
+			qreal c = qreal(chartRect.height()) * build.cpuMsecs / maxMsecs;
+			painter.fillRect(QRectF(bar.left() + bar.width() / 4, chartRect.bottom() - c, bar.width() / 2, c),
+							 palette().dark());
+		}
+	}
+}
+
+BuildStatisticsDock::BuildStatisticsDock(TeXDocument *doc)
+	: TeXDock(tr("Build Statistics"), doc)
+{
+	setObjectName("buildStatistics");
+	QWidget *w = new QWidget(this);
+	QVBoxLayout *layout = new QVBoxLayout(w);
+	layout->setContentsMargins(0, 0, 0, 0);
+	chart = new BuildTimeChart(w);
+	layout->addWidget(chart, 1);
+	details = new QLabel(w);
+	details->setWordWrap(true);
+	layout->addWidget(details);
+	setWidget(w);
+	connect(BuildStatistics::instance(), SIGNAL(buildRecorded(const QString&)), this, SLOT(buildRecorded(const QString&)));
+}
+
+BuildStatisticsDock::~BuildStatisticsDock()
+{
+}
+
+void BuildStatisticsDock::fillInfo()
+{
+	QList<BuildRecord> records = BuildStatistics::instance()->sessionRecords(document->getRootFilePath());
+	chart->setRecords(records);
+	if (records.isEmpty()) {
+		details->clear();
+		return;
+	}
+	const BuildRecord& last = records.last();
+	QStringList lines;
+	lines << tr("Last build: %1 s wall time, %2 pass(es)").arg(last.wallMsecs / 1000.0, 0, 'f', 2).arg(last.passes);
+	if (last.cpuMsecs >= 0)
+		lines << tr("CPU time: %1 s, peak memory: %2 MB").arg(last.cpuMsecs / 1000.0, 0, 'f', 2)
+				 .arg(last.peakRssKB / 1024.0, 0, 'f', 1);
+	if (last.pages >= 0)
+		lines << tr("%1 page(s)").arg(last.pages);
+	if (last.pdfSize >= 0)
+		lines << tr("PDF size: %1 kB").arg(last.pdfSize / 1024);
+	details->setText(lines.join("\n"));
+}
+
+void BuildStatisticsDock::buildRecorded(const QString& rootFile)
+{
+	if (!document || rootFile != document->getRootFilePath())
+		return;
+	filled = false;
+	if (isVisible()) {
+		fillInfo();
+		filled = true;
+	}
+}
+
 TeXDockTreeWidget::TeXDockTreeWidget(QWidget* parent)
 	: QTreeWidget(parent)
 {
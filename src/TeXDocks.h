@@ -26,11 +26,15 @@
 #include <QTreeWidget>
 #include <QListWidget>
 #include <QScrollArea>
+#include <QTimer>
+
+#include "BuildStatistics.h"
 
 class TeXDocument;
 class QListWidget;
 class QTableWidget;
 class QTreeWidgetItem;
+class QLabel;
 
 class TeXDock : public QDockWidget
 {
@@ -74,6 +78,69 @@ private:
 	int saveScrollValue;
 };
 
+class IssuesDock : public TeXDock
+{
+	Q_OBJECT
+
+public:
+	IssuesDock(TeXDocument *doc = 0);
+	virtual ~IssuesDock();
+
+protected:
+	virtual void fillInfo();
+
+private slots:
+	void clear();
+	void addEntry(int index);
+	void addPendingItems();
+	void goToIssue(QTreeWidgetItem *item);
+
+private:
+	QTreeWidgetItem *createItem(int index);
+
+	QTreeWidget *tree;
+	QList<QTreeWidgetItem*> pendingItems;	// not in the tree yet
+	QTimer addTimer;
+};
+
+// bar chart of the wall (and CPU) time of the builds in this session
+class BuildTimeChart : public QWidget
+{
+	Q_OBJECT
+
+public:
+	BuildTimeChart(QWidget *parent = NULL);
+	virtual ~BuildTimeChart();
+
+	void setRecords(const QList<BuildRecord>& records);
+	virtual QSize sizeHint() const;
+
+protected:
+	virtual void paintEvent(QPaintEvent *event);
+
+private:
+	QList<BuildRecord> records;
+};
+
+class BuildStatisticsDock : public TeXDock
+{
+	Q_OBJECT
+
+public:
+	BuildStatisticsDock(TeXDocument *doc = 0);
+	virtual ~BuildStatisticsDock();
+
+protected:
+	virtual void fillInfo();
+
+private slots:
+	void buildRecorded(const QString& rootFile);
+
+private:
+	BuildTimeChart *chart;
+	QLabel *details;
+};
+
 class TeXDockTreeWidget : public QTreeWidget
 {
 	Q_OBJECT
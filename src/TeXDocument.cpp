@@ -30,6 +30,17 @@
 #include "ConfirmDelete.h"
 #include "HardWrapDialog.h"
 #include "PrefsDialog.h"
+#include "DocumentSaver.h"
+#include "DelimiterIndex.h"
+#include "DictionaryManager.h"
+#include "TypesetScheduler.h"
+#include "LivePreview.h"
+#include "PreambleCache.h"
+#include "BuildDriver.h"
+#include "BuildDirectory.h"
+#include "EngineResolver.h"
+#include "LogParser.h"
+#include "BuildStatistics.h"
 
 #include <QCloseEvent>
 #include <QFileDialog>
@@ -72,6 +83,22 @@ const int kHardWrapDefaultWidth = 64;
 
 QList<TeXDocument*> TeXDocument::docList;
 
+static bool isUnicodeCodec(QTextCodec *codec)
+{
+	// UTF-8, UTF-16 (BE/LE), UTF-32 (BE/LE)
+	switch (codec->mibEnum()) {
+		case 106:
+		case 1013:
+		case 1014:
+		case 1015:
+		case 1017:
+		case 1018:
+		case 1019:
+			return true;
+	}
+	return false;
+}
+
 TeXDocument::TeXDocument()
 {
 	init();
@@ -86,8 +113,13 @@ TeXDocument::TeXDocument(const QString &fileName, bool asTemplate)
 
 TeXDocument::~TeXDocument()
 {
+	TypesetScheduler::instance()->cancel(this);
+	TypesetScheduler::instance()->cancel(this, TypesetScheduler::PreviewJob);
+	DictionaryManager::instance()->release(spellingLanguage);
+	delete preambleCache;
+	delete buildDriver;
+	delete buildDirectory;
 	docList.removeAll(this);
-	updateWindowMenu();
 }
 
 static bool dictActionLessThan(const QAction * a1, const QAction * a2) {
@@ -219,12 +251,12 @@ void TeXDocument::init()
 	connect(actionTypeset, SIGNAL(triggered()), this, SLOT(typeset()));
 
 	menuRecent = new QMenu(tr("Open Recent"), this);
-	updateRecentFileActions();
 	menuFile->insertMenu(actionOpen_Recent, menuRecent);
 	menuFile->removeAction(actionOpen_Recent);
 
-	connect(qApp, SIGNAL(recentFileActionsChanged()), this, SLOT(updateRecentFileActions()));
-	connect(qApp, SIGNAL(windowListChanged()), this, SLOT(updateWindowMenu()));
+	// both lists are shared by all windows; fill them in only when needed
+	connect(menuRecent, SIGNAL(aboutToShow()), this, SLOT(updateRecentFileActions()));
+	connect(menuWindow, SIGNAL(aboutToShow()), this, SLOT(updateWindowMenu()));
 	
 	connect(qApp, SIGNAL(hideFloatersExcept(QWidget*)), this, SLOT(hideFloatersUnlessThis(QWidget*)));
 	connect(this, SIGNAL(activatedWindow(QWidget*)), qApp, SLOT(activatedWindow(QWidget*)));
@@ -275,6 +307,7 @@ void TeXDocument::init()
 	setLineNumbers(b);
 	
 	highlighter = new TeXHighlighter(textEdit->document(), this);
+	highlighter->setTextEdit(textEdit);
 	connect(textEdit, SIGNAL(rehighlight()), highlighter, SLOT(rehighlight()));
 
 	QString syntaxOption = settings.value("syntaxColoring").toString();
@@ -371,6 +404,8 @@ void TeXDocument::init()
 	connect(actionNone, SIGNAL(triggered()), mapper, SLOT(map()));
 	mapper->setMapping(actionNone, QString());
 	connect(mapper, SIGNAL(mapped(const QString&)), this, SLOT(setLangInternal(const QString&)));
+	connect(DictionaryManager::instance(), SIGNAL(dictionaryLoaded(const QString&, int)),
+			this, SLOT(dictionaryLoaded(const QString&, int)));
 
 	QActionGroup *group = new QActionGroup(this);
 	group->addAction(actionNone);
@@ -417,15 +452,45 @@ void TeXDocument::init()
 
 	TWUtils::zoomToHalfScreen(this);
 
+	parser = new LogParser(this);
+	monitor = new ProcessMonitor(this);
+
 	QDockWidget *dw = new TagsDock(this);
 	dw->hide();
 	addDockWidget(Qt::LeftDockWidgetArea, dw);
 	menuShow->addAction(dw->toggleViewAction());
+
+	dw = new IssuesDock(this);
+	dw->hide();
+	addDockWidget(Qt::BottomDockWidgetArea, dw);
+	menuShow->addAction(dw->toggleViewAction());
+
+	dw = new BuildStatisticsDock(this);
+	dw->hide();
+	addDockWidget(Qt::RightDockWidgetArea, dw);
+	menuShow->addAction(dw->toggleViewAction());
 	deferTagListChanges = false;
 
 	watcher = new QFileSystemWatcher(this);
 	connect(watcher, SIGNAL(fileChanged(const QString&)), this, SLOT(reloadIfChangedOnDisk()), Qt::QueuedConnection);
 	connect(watcher, SIGNAL(directoryChanged(const QString&)), this, SLOT(reloadIfChangedOnDisk()), Qt::QueuedConnection);
+
+	typesetAfterSaving = false;
+	preambleCache = NULL;
+	buildDriver = NULL;
+	buildDirectory = NULL;
+	connect(TypesetScheduler::instance(), SIGNAL(queueChanged()), this, SLOT(updateTypesettingAction()));
+
+	livePreview = new LivePreview(this);
+	livePreview->setEnabled(settings.value("livePreview", false).toBool());
+	actionLive_Preview->setChecked(livePreview->isEnabled());
+	connect(actionLive_Preview, SIGNAL(toggled(bool)), this, SLOT(setLivePreview(bool)));
+	connect(textEdit->document(), SIGNAL(contentsChanged()), livePreview, SLOT(documentChanged()));
+	connect(livePreview, SIGNAL(updateRequested()), this, SLOT(requestLivePreview()));
+	connect(livePreview, SIGNAL(finished(bool, const QString&)), this, SLOT(livePreviewFinished(bool, const QString&)));
+	connect(DocumentSaver::instance(), SIGNAL(saveFinished(const QString&, bool, const QString&)),
+			this, SLOT(saveFinished(const QString&, bool, const QString&)));
+	connect(DocumentSaver::instance(), SIGNAL(allSavesFinished()), this, SLOT(pendingSavesFinished()));
 	
 	docList.append(this);
 	
@@ -456,14 +521,41 @@ void TeXDocument::setLangInternal(const QString& lang)
 {
 	// called internally by the spelling menu actions;
 	// not for use from scripts as it won't update the menu
+	DictionaryManager *dictionaries = DictionaryManager::instance();
+	if (lang != spellingLanguage) {
+		dictionaries->release(spellingLanguage);
+		spellingLanguage = lang;
+		dictionaries->acquire(spellingLanguage);
+	}
+
+	// if the dictionary isn't loaded yet, spell checking is switched on in
+	// dictionaryLoaded() once it is
+	Hunhandle *h = dictionaries->dictionary(lang);
+	if (h == NULL && dictionaries->isLoading(lang))
+		statusBar()->showMessage(tr("Loading dictionary %1...").arg(lang));
+	setSpellChecker(h);
+}
+
+void TeXDocument::dictionaryLoaded(const QString& lang, int msecs)
+{
+	if (spellingLanguage.isEmpty() || pHunspell != NULL)
+		return;
+	Hunhandle *h = DictionaryManager::instance()->dictionary(spellingLanguage);
+	if (h == NULL)
+		return;
+	statusBar()->showMessage(tr("Dictionary %1 loaded (%2 ms)").arg(lang).arg(msecs), kStatusMessageDuration);
+	setSpellChecker(h);
+}
+
+void TeXDocument::setSpellChecker(Hunhandle *h)
+{
 	QTextCodec *spellingCodec;
-	Hunhandle* pOldHunspell = pHunspell;
-	pHunspell = TWUtils::getDictionary(lang);
 	// if the dictionary hasn't change, don't reset the spell checker as that
 	// can result in a serious delay for long documents
-	// NB: Don't delete the hunspell handles; the pointers are kept by TWUtils
-	if (pOldHunspell == pHunspell)
+	// NB: Don't delete the hunspell handles; they are owned by the DictionaryManager
+	if (pHunspell == h)
 		return;
+	pHunspell = h;
 	
 	if (pHunspell != NULL) {
 		spellingCodec = QTextCodec::codecForName(Hunspell_get_dic_encoding(pHunspell));
@@ -646,6 +738,14 @@ void TeXDocument::closeEvent(QCloseEvent *event)
 	}
 */
 	if (maybeSave()) {
+		// make sure the file really made it to disk before the window goes away
+		if (DocumentSaver::instance()->isSaving(curFile)) {
+			DocumentSaver::instance()->waitForDone();
+			if (isModified()) {
+				event->ignore();
+				return;
+			}
+		}
 		event->accept();
 		saveRecentFileInfo();
 		deleteLater();
@@ -1089,6 +1189,8 @@ void TeXDocument::reloadIfChangedOnDisk()
 {
 	if (isUntitled || !lastModified.isValid())
 		return;
+	if (DocumentSaver::instance()->isSaving(curFile))
+		return;
 
 	QDateTime fileModified = QFileInfo(curFile).lastModified();
 	if (!fileModified.isValid() || fileModified == lastModified)
@@ -1250,7 +1352,10 @@ bool TeXDocument::saveFile(const QString &fileName)
 {
 	QFileInfo fileInfo(fileName);
 	QDateTime fileModified = fileInfo.lastModified();
-	if (fileName == curFile && fileModified.isValid() && fileModified != lastModified) {
+	// while one of our own saves is still in flight, the timestamp on disk is
+	// expected to differ from lastModified
+	if (fileName == curFile && fileModified.isValid() && fileModified != lastModified
+		&& !DocumentSaver::instance()->isSaving(fileName)) {
 		if (QMessageBox::warning(this, tr("File changed on disk"),
 								 tr("%1 has been modified by another program.\n\n"
 									"Do you want to proceed with saving this file, overwriting the version on disk?")
@@ -1264,21 +1369,25 @@ bool TeXDocument::saveFile(const QString &fileName)
 		}
 	}
 	
+	// only take a snapshot here; conversion, encoding and writing are done
+	// by the DocumentSaver on a worker thread
 	QString theText = textEdit->toPlainText();
+	QString lineEnding = "\n";
 	switch (lineEndings & kLineEnd_Mask) {
 		case kLineEnd_CR:
-			theText.replace("\n", "\r");
+			lineEnding = "\r";
 			break;
 		case kLineEnd_LF:
 			break;
 		case kLineEnd_CRLF:
-			theText.replace("\n", "\r\n");
+			lineEnding = "\r\n";
 			break;
 	}
 	
 	if (!codec)
 		codec = TWApp::instance()->getDefaultCodec();
-	if (!codec->canEncode(theText)) {
+	// Unicode encodings can represent anything, so skip the (expensive) check
+	if (!isUnicodeCodec(codec) && !codec->canEncode(theText)) {
 		if (QMessageBox::warning(this, tr("Text cannot be converted"),
 				tr("This document contains characters that cannot be represented in the encoding %1.\n\n"
 				   "If you proceed, they will be replaced with default codes. "
@@ -1288,9 +1397,13 @@ bool TeXDocument::saveFile(const QString &fileName)
 			goto notSaved;
 	}
 
+	// don't let the watcher report our own write; it is set up again once
+	// the save has finished
 	clearFileWatcher();
 
-	{
+	if (!fileInfo.exists()) {
+		// create the file right away so it has a canonical path, and so that
+		// an unwritable location is reported before we claim to have saved
 		QFile file(fileName);
 		if (!file.open(QFile::WriteOnly)) {
 			QMessageBox::warning(this, tr(TEXWORKS_NAME),
@@ -1300,28 +1413,56 @@ bool TeXDocument::saveFile(const QString &fileName)
 			setupFileWatcher();
 			goto notSaved;
 		}
-
-		QApplication::setOverrideCursor(Qt::WaitCursor);
-		if (file.write(codec->fromUnicode(theText)) == -1) {
-			QApplication::restoreOverrideCursor();
-			QMessageBox::warning(this, tr("Error writing file"),
-								 tr("An error may have occurred while saving the file. "
-									"You might like to save a copy in a different location."),
-								 QMessageBox::Ok);
-			goto notSaved;
-		}
-		QApplication::restoreOverrideCursor();
 	}
 
 	setCurrentFile(fileName);
-	statusBar()->showMessage(tr("File \"%1\" saved")
+	DocumentSaver::instance()->save(curFile, theText, codec, lineEnding);
+	statusBar()->showMessage(tr("Saving \"%1\"...")
 								.arg(TWUtils::strippedName(curFile)),
 								kStatusMessageDuration);
-	
-	QTimer::singleShot(0, this, SLOT(setupFileWatcher()));
 	return true;
 }
 
+void TeXDocument::saveFinished(const QString& fileName, bool success, const QString& errorString)
+{
+	if (fileName != curFile)
+		return;
+
+	if (success)
+		statusBar()->showMessage(tr("File \"%1\" saved")
+									.arg(TWUtils::strippedName(curFile)),
+									kStatusMessageDuration);
+	else {
+		// the buffer no longer corresponds to what's on disk
+		setModified(true);
+		QMessageBox::warning(this, tr(TEXWORKS_NAME),
+							 tr("Cannot write file \"%1\":\n%2")
+							 .arg(fileName)
+							 .arg(errorString));
+		statusBar()->showMessage(tr("Document \"%1\" was not saved")
+									.arg(TWUtils::strippedName(curFile)),
+									kStatusMessageDuration);
+	}
+
+	if (!DocumentSaver::instance()->isSaving(curFile))
+		setupFileWatcher();
+}
+
+void TeXDocument::pendingSavesFinished()
+{
+	if (!typesetAfterSaving)
+		return;
+	typesetAfterSaving = false;
+	// if one of the files couldn't be written, don't try again in a loop
+	foreach (TeXDocument* doc, docList) {
+		if (doc->getRootFilePath() == rootFilePath && doc->isModified()) {
+			statusBar()->showMessage(tr("Cannot process unsaved document"), kStatusMessageDuration);
+			return;
+		}
+	}
+	typeset();
+}
+
 void TeXDocument::clearFileWatcher()
 {
 	const QStringList files = watcher->files();
@@ -1413,7 +1554,7 @@ void TeXDocument::updateWindowMenu()
 void TeXDocument::updateEngineList()
 {
 	engine->disconnect(this);
-	while (menuRun->actions().count() > 2)
+	while (menuRun->actions().count() > 3)
 		menuRun->removeAction(menuRun->actions().last());
 	while (engineActions->actions().count() > 0)
 		engineActions->removeAction(engineActions->actions().last());
@@ -1824,25 +1965,20 @@ void TeXDocument::insertText(const QString& text)
 
 void TeXDocument::balanceDelimiters()
 {
-	const QString text = textEdit->toPlainText();
+	DelimiterIndex *delimiters = textEdit->delimiterIndex();
 	QTextCursor cursor = textEdit->textCursor();
-	int openPos = TWUtils::findOpeningDelim(text, cursor.selectionStart());
-	if (openPos >= 0 && openPos < text.length() - 1) {
-		do {
-			int closePos = TWUtils::balanceDelim(text, openPos + 1, TWUtils::closerMatching(text[openPos]), 1);
-			if (closePos < 0)
-				break;
-			if (closePos >= cursor.selectionEnd()) {
-				cursor.setPosition(openPos);
-				cursor.setPosition(closePos + 1, QTextCursor::KeepAnchor);
-				textEdit->setTextCursor(cursor);
-				return;
-			}
-			if (openPos > 0)
-				openPos = TWUtils::findOpeningDelim(text, openPos - 1);
-			else
-				break;
-		} while (openPos >= 0);
+	int openPos = delimiters->enclosingOpener(cursor.selectionStart());
+	while (openPos >= 0) {
+		int closePos = delimiters->matchingDelim(openPos);
+		if (closePos < 0)
+			break;
+		if (closePos >= cursor.selectionEnd()) {
+			cursor.setPosition(openPos);
+			cursor.setPosition(closePos + 1, QTextCursor::KeepAnchor);
+			textEdit->setTextCursor(cursor);
+			return;
+		}
+		openPos = delimiters->enclosingOpener(openPos);
 	}
 	QApplication::beep();
 }
@@ -2407,9 +2543,6 @@ void TeXDocument::zoomToLeft(QWidget *otherWindow)
 
 void TeXDocument::typeset()
 {
-	if (process)
-		return;	// this shouldn't happen if we disable the command at the right time
-
 	if (isUntitled || textEdit->document()->isModified())
 		if (!save()) {
 			statusBar()->showMessage(tr("Cannot process unsaved document"), kStatusMessageDuration);
@@ -2420,20 +2553,39 @@ void TeXDocument::typeset()
 	if (!saveFilesHavingRoot(rootFilePath))
 		return;
 
+	// the engine must not see half-written files; start once all saves are done
+	if (DocumentSaver::instance()->hasPendingSaves()) {
+		typesetAfterSaving = true;
+		return;
+	}
+
+	TypesetScheduler *scheduler = TypesetScheduler::instance();
+	scheduler->request(this, rootFilePath);
+	if (scheduler->state(this) == TypesetScheduler::Queued && scheduler->runningCount() >= scheduler->maxConcurrentJobs())
+		statusBar()->showMessage(tr("Waiting for other typesetting jobs to finish (position %1 in queue)")
+								 .arg(scheduler->queuePosition(this)), kStatusMessageDuration);
+}
+
+bool TeXDocument::startTypesetting()
+{
+	// called by the TypesetScheduler when it's our turn
+	findRootFilePath();
 	QFileInfo fileInfo(rootFilePath);
 	if (!fileInfo.isReadable()) {
 		statusBar()->showMessage(tr("Root document %1 is not readable").arg(rootFilePath), kStatusMessageDuration);
-		return;
+		return false;
 	}
 
 	Engine e = TWApp::instance()->getNamedEngine(engine->currentText());
 	if (e.program() == "") {
 		statusBar()->showMessage(tr("%1 is not properly configured").arg(engine->currentText()), kStatusMessageDuration);
-		return;
+		return false;
 	}
 
 	process = new QProcess(this);
 	updateTypesettingAction();
+	monitor->watch(process);
+	buildTimer.start();
 
 	QString workingDir = fileInfo.canonicalPath();	// Note that fileInfo refers to the root file
 #ifdef Q_WS_WIN
@@ -2445,10 +2597,9 @@ void TeXDocument::typeset()
 #endif
 	process->setWorkingDirectory(workingDir);
 
-	QStringList env = QProcess::systemEnvironment();
-	QStringList binPaths = TWApp::instance()->getBinaryPaths(env);
-	
-	QString exeFilePath = TWApp::instance()->findProgram(e.program(), binPaths);
+	EngineResolver *resolver = EngineResolver::instance();
+	QStringList env = resolver->environment();
+	QString exeFilePath = resolver->resolve(e.program());
 	
 #ifndef Q_WS_MAC // not supported on OS X yet :(
 	// Add a (customized) TEXEDIT environment variable
@@ -2460,29 +2611,10 @@ void TeXDocument::typeset()
 #endif
 	
 	if (!exeFilePath.isEmpty()) {
-		QStringList args = e.arguments();
-		
-		// for old MikTeX versions: delete $synctexoption if it causes an error
-		static bool checkedForSynctex = false;
-		static bool synctexSupported = true;
-		if (!checkedForSynctex) {
-			QString pdftex = TWApp::instance()->findProgram("pdftex", binPaths);
-			if (!pdftex.isEmpty()) {
-				int result = QProcess::execute(pdftex, QStringList() << "-synctex=1" << "-version");
-				synctexSupported = (result == 0);
-			}
-			checkedForSynctex = true;
-		}
-		if (!synctexSupported)
-			args.removeAll("$synctexoption");
-		
-		args.replaceInStrings("$synctexoption", "-synctex=1");
-		args.replaceInStrings("$fullname", fileInfo.fileName());
-		args.replaceInStrings("$basename", fileInfo.completeBaseName());
-		args.replaceInStrings("$suffix", fileInfo.suffix());
-		args.replaceInStrings("$directory", fileInfo.absoluteDir().absolutePath());
+		QStringList args = engineArguments(e, fileInfo);
 		
 		textEdit_console->clear();
+		parser->reset(workingDir);
 		if (consoleTabs->isHidden()) {
 			keepConsoleOpen = false;
 			showConsole();
@@ -2507,17 +2639,96 @@ void TeXDocument::typeset()
 		else
 			oldPdfTime = QDateTime();
 		
+		delete buildDirectory;
+		buildDirectory = NULL;
+		if (e.buildInMemory()) {
+			buildDirectory = new BuildDirectory(fileInfo.absoluteFilePath());
+			if (buildDirectory->prepare()) {
+				args = buildDirectory->arguments(args);
+				env = buildDirectory->environment(env);
+				process->setEnvironment(env);
+			}
+			else {
+				textEdit_console->append(tr("Cannot create the build directory %1; building next to the document")
+										 .arg(buildDirectory->path()));
+				delete buildDirectory;
+				buildDirectory = NULL;
+			}
+		}
+		
+		delete buildDriver;
+		buildDriver = NULL;
+		if (e.buildDriver()) {
+			buildDriver = new BuildDriver(fileInfo.absoluteFilePath(), exeFilePath);
+			if (buildDirectory)
+				buildDriver->setOutputDirectory(buildDirectory->path());
+		}
+		
+		delete preambleCache;
+		preambleCache = NULL;
+		if (e.cachePreamble()) {
+			preambleCache = new PreambleCache(fileInfo.absoluteFilePath(), exeFilePath);
+			if (preambleCache->isValid()) {
+				int saved = preambleCache->recordHit();
+				textEdit_console->append(tr("Using cached preamble format (hit %1, about %2 s saved)")
+										 .arg(preambleCache->hits()).arg(saved / 1000.0, 0, 'f', 1));
+				process->setEnvironment(preambleCache->formatEnvironment(env));
+				args = preambleCache->formatArguments(args);
+			}
+			else if (preambleCache->hasPreamble() && !preambleCache->hasFailed() && preambleCache->prepareDump()) {
+				// dump the format first; processFinished() then starts the real run
+				textEdit_console->append(tr("Dumping the preamble into a format..."));
+				typesetArguments = args;
+				process->start(exeFilePath, preambleCache->dumpArguments());
+				return true;
+			}
+		}
+		
+		if (buildDriver)
+			buildDriver->start(args);
 		process->start(exeFilePath, args);
+		return true;
 	}
 	else {
 		process->deleteLater();
 		process = NULL;
+		updateTypesettingAction();
 		QMessageBox::critical(this, tr("Unable to execute %1").arg(e.name()),
 							  "<p>" + tr("The program \"%1\" was not found.").arg(e.program()) +
 							  "<p><small>" + tr("Searched in directories:") +
-							  "<ul><li>" + binPaths.join("<li>") + "</ul></small>" +
+							  "<ul><li>" + resolver->binaryPaths().join("<li>") + "</ul></small>" +
 							  "<p>" + tr("Check configuration of the %1 tool and path settings in the Preferences dialog.").arg(e.name()),
 							  QMessageBox::Cancel);
+		return false;
+	}
+}
+
+QStringList TeXDocument::engineArguments(const Engine& e, const QFileInfo& fileInfo)
+{
+	QStringList args = e.arguments();
+	
+	// for old MikTeX versions: delete $synctexoption if it causes an error
+	if (!EngineResolver::instance()->supportsSynctex())
+		args.removeAll("$synctexoption");
+	
+	args.replaceInStrings("$synctexoption", "-synctex=1");
+	args.replaceInStrings("$fullname", fileInfo.fileName());
+	args.replaceInStrings("$basename", fileInfo.completeBaseName());
+	args.replaceInStrings("$suffix", fileInfo.suffix());
+	args.replaceInStrings("$directory", fileInfo.absoluteDir().absolutePath());
+	return args;
+}
+
+void TeXDocument::abortTypesetting()
+{
+	// the scheduler is restarting our root file; drop the current run quietly
+	if (process != NULL) {
+		disconnect(process, 0, this, 0);
+		process->kill();
+		process->deleteLater();
+		process = NULL;
+		textEdit_console->append(tr("Process restarted"));
+		inputLine->hide();
 		updateTypesettingAction();
 	}
 }
@@ -2528,11 +2739,89 @@ void TeXDocument::interrupt()
 		userInterrupt = true;
 		process->kill();
 	}
+	else
+		TypesetScheduler::instance()->cancel(this);
+}
+
+#pragma mark === live preview ===
+
+void TeXDocument::setLivePreview(bool enable)
+{
+	livePreview->setEnabled(enable);
+	if (enable)
+		livePreview->documentChanged();
+	else
+		TypesetScheduler::instance()->cancel(this, TypesetScheduler::PreviewJob);
+	QSETTINGS_OBJECT(settings);
+	settings.setValue("livePreview", enable);
+}
+
+void TeXDocument::requestLivePreview()
+{
+	// a clean buffer is already reflected in the real PDF
+	if (isUntitled || !isModified())
+		return;
+	findRootFilePath();
+	if (rootFilePath.isEmpty())
+		return;
+	TypesetScheduler::instance()->request(this, rootFilePath, TypesetScheduler::PreviewJob);
+}
+
+bool TeXDocument::startLivePreview()
+{
+	findRootFilePath();
+	QFileInfo rootInfo(rootFilePath);
+	if (!rootInfo.isReadable())
+		return false;
+
+	Engine e = TWApp::instance()->getNamedEngine(engine->currentText());
+	QStringList env = EngineResolver::instance()->environment();
+	QString exeFilePath = EngineResolver::instance()->resolve(e.program());
+	if (e.program().isEmpty() || exeFilePath.isEmpty())
+		return false;
+
+	// shadow the unsaved buffers of all files belonging to this root
+	QMap<QString, QByteArray> shadows;
+	QDir rootDir = rootInfo.absoluteDir();
+	foreach (TeXDocument* doc, docList) {
+		if (doc->isUntitled || !doc->isModified() || doc->getRootFilePath() != rootFilePath)
+			continue;
+		QString relPath = rootDir.relativeFilePath(doc->curFile);
+		if (relPath.startsWith(".."))
+			continue;	// not reachable from the scratch directory
+		QTextCodec *docCodec = (doc->codec ? doc->codec : TWApp::instance()->getDefaultCodec());
+		shadows.insert(relPath, docCodec->fromUnicode(doc->textEdit->toPlainText()));
+	}
+
+	QFileInfo shadowRoot(QDir(LivePreview::scratchDirectory(rootFilePath)), rootInfo.fileName());
+	QStringList args = engineArguments(e, shadowRoot);
+	if (!livePreview->start(rootFilePath, exeFilePath, args, env, shadows))
+		return false;
+	statusBar()->showMessage(tr("Updating preview..."), kStatusMessageDuration);
+	return true;
+}
+
+void TeXDocument::abortLivePreview()
+{
+	livePreview->abort();
+}
+
+void TeXDocument::livePreviewFinished(bool success, const QString& pdfFile)
+{
+	TypesetScheduler::instance()->jobFinished(this, TypesetScheduler::PreviewJob);
+	if (!success)
+		return;
+	QString pdfName;
+	if (getPreviewFileName(pdfName)) {
+		PDFDocument *pdf = PDFDocument::findDocument(pdfName);
+		if (pdf != NULL)
+			pdf->showLivePreview(pdfFile);
+	}
 }
 
 void TeXDocument::updateTypesettingAction()
 {
-	if (process == NULL) {
+	if (process == NULL && TypesetScheduler::instance()->state(this) == TypesetScheduler::Idle) {
 		disconnect(actionTypeset, SIGNAL(triggered()), this, SLOT(interrupt()));
 		actionTypeset->setIcon(QIcon(":/images/images/runtool.png"));
 		actionTypeset->setText(tr("Typeset"));
@@ -2553,6 +2842,7 @@ void TeXDocument::updateTypesettingAction()
 void TeXDocument::processStandardOutput()
 {
 	QByteArray bytes = process->readAllStandardOutput();
+	parser->addData(bytes);
 	QTextCursor cursor(textEdit_console->document());
 	cursor.select(QTextCursor::Document);
 	cursor.setPosition(cursor.selectionEnd());
@@ -2562,6 +2852,13 @@ void TeXDocument::processStandardOutput()
 
 void TeXDocument::processError(QProcess::ProcessError /*error*/)
 {
+	delete preambleCache;
+	preambleCache = NULL;
+	delete buildDriver;
+	buildDriver = NULL;
+	delete buildDirectory;
+	buildDirectory = NULL;
+	parser->finish();
 	if (userInterrupt)
 		textEdit_console->append(tr("Process interrupted by user"));
 	else
@@ -2571,10 +2868,54 @@ void TeXDocument::processError(QProcess::ProcessError /*error*/)
 	process = NULL;
 	inputLine->hide();
 	updateTypesettingAction();
+	TypesetScheduler::instance()->jobFinished(this);
 }
 
 void TeXDocument::processFinished(int exitCode, QProcess::ExitStatus exitStatus)
 {
+	if (process != NULL && preambleCache != NULL && preambleCache->isDumping()
+		&& !userInterrupt && exitStatus != QProcess::CrashExit) {
+		QStringList args = typesetArguments;
+		if (preambleCache->dumpFinished(exitCode, exitStatus)) {
+			textEdit_console->append(tr("Preamble format dumped in %1 s")
+									 .arg(preambleCache->dumpTime() / 1000.0, 0, 'f', 1));
+			process->setEnvironment(preambleCache->formatEnvironment(process->environment()));
+			args = preambleCache->formatArguments(args);
+		}
+		else
+			textEdit_console->append(tr("The preamble could not be dumped into a format; typesetting without it"));
+		if (buildDriver)
+			buildDriver->start(args);
+		parser->reset(process->workingDirectory());
+		process->start(preambleCache->program(), args);
+		return;
+	}
+
+	if (process != NULL && buildDriver != NULL && !userInterrupt && exitStatus != QProcess::CrashExit) {
+		BuildDriver::Pass next;
+		if (buildDriver->passFinished(exitCode, next)) {
+			textEdit_console->append(next.description);
+			// only the issues of the last pass are of interest
+			parser->reset(process->workingDirectory());
+			process->start(next.program, next.arguments);
+			return;
+		}
+		foreach (const QString& line, buildDriver->summary())
+			textEdit_console->append(line);
+	}
+	delete buildDriver;
+	buildDriver = NULL;
+	parser->finish();
+	if (buildDirectory != NULL && exitStatus != QProcess::CrashExit) {
+		QString failed;
+		if (!buildDirectory->commit(failed))
+			textEdit_console->append(tr("Could not update %1 from the build directory").arg(failed));
+	}
+	delete buildDirectory;
+	buildDirectory = NULL;
+	if (!userInterrupt && exitStatus != QProcess::CrashExit)
+		recordBuildStatistics(exitCode);
+
 	if (exitStatus != QProcess::CrashExit) {
 		QString pdfName;
 		if (getPreviewFileName(pdfName) && QFileInfo(pdfName).lastModified() != oldPdfTime) {
@@ -2624,6 +2965,23 @@ void TeXDocument::processFinished(int exitCode, QProcess::ExitStatus exitStatus)
 		process->deleteLater();
 	process = NULL;
 	updateTypesettingAction();
+	TypesetScheduler::instance()->jobFinished(this);
+}
+
+void TeXDocument::recordBuildStatistics(int exitCode)
+{
+	BuildRecord build;
+	build.finished = QDateTime::currentDateTime();
+	build.engine = engine->currentText();
+	build.wallMsecs = buildTimer.elapsed();
+	build.cpuMsecs = monitor->cpuMsecs();
+	build.peakRssKB = monitor->peakRssKB();
+	build.passes = monitor->passes();
+	build.pages = parser->outputPages();
+	QString pdfName;
+	build.pdfSize = (getPreviewFileName(pdfName) ? QFileInfo(pdfName).size() : -1);
+	build.exitCode = exitCode;
+	BuildStatistics::instance()->record(rootFilePath, build);
 }
 
 void TeXDocument::executeAfterTypesetHooks()
@@ -2876,9 +3234,20 @@ void TeXDocument::removeAuxFiles()
 	
 	dir.setNameFilters(filterList);
 	QStringList auxFileList = dir.entryList(QDir::Files | QDir::CaseSensitive, QDir::Name);
+	
+	// files left in the scratch directory of in-memory builds
+	QDir buildDir(BuildDirectory::pathFor(rootFilePath));
+	QStringList buildFileList;
+	if (buildDir.exists()) {
+		buildDir.setNameFilters(filterList);
+		buildFileList = buildDir.entryList(QDir::Files | QDir::CaseSensitive, QDir::Name);
+	}
+	
 	if (auxFileList.count() > 0)
 		ConfirmDelete::doConfirmDelete(dir, auxFileList);
-	else
+	if (buildFileList.count() > 0)
+		ConfirmDelete::doConfirmDelete(buildDir, buildFileList);
+	if (auxFileList.count() == 0 && buildFileList.count() == 0)
 		(void)QMessageBox::information(this, tr("No files found"),
 									   tr("No auxiliary files associated with this document at the moment."));
 }
@@ -49,6 +49,12 @@ class QFileSystemWatcher;
 
 class TeXHighlighter;
 class PDFDocument;
+class LivePreview;
+class PreambleCache;
+class BuildDriver;
+class BuildDirectory;
+class LogParser;
+class ProcessMonitor;
 
 const int kTeXWindowStateVersion = 1; // increment this if we add toolbars/docks/etc
 
@@ -88,6 +94,9 @@ public:
 
 	PDFDocument* pdfDocument()
 		{ return pdfDoc; }
+	LogParser* logParser()
+		{ return parser; }
+	const QString& getRootFilePath();
 
 	void addTag(const QTextCursor& cursor, int level, const QString& text);
 	int removeTags(int offset, int len);
@@ -97,6 +106,12 @@ public:
 	bool isModified() const { return textEdit->document()->isModified(); }
 	void setModified(const bool m = true) { textEdit->document()->setModified(m); }
 
+	// used by the TypesetScheduler
+	bool startTypesetting();
+	void abortTypesetting();
+	bool startLivePreview();
+	void abortLivePreview();
+
 	class Tag {
 	public:
 		QTextCursor	cursor;
@@ -186,6 +201,10 @@ public slots:
 	
 private slots:
 	void setLangInternal(const QString& lang);
+	void dictionaryLoaded(const QString& lang, int msecs);
+	void setLivePreview(bool enable);
+	void requestLivePreview();
+	void livePreviewFinished(bool success, const QString& pdfFile);
 	void maybeEnableSaveAndRevert(bool modified);
 	void clipboardChanged();
 	void doReplace(ReplaceDialog::DialogCode mode);
@@ -204,6 +223,8 @@ private slots:
 	void contentsChanged(int position, int charsRemoved, int charsAdded);
 	void reloadIfChangedOnDisk();
 	void setupFileWatcher();
+	void saveFinished(const QString& fileName, bool success, const QString& errorString);
+	void pendingSavesFinished();
 	void lineEndingPopup(const QPoint loc);
 	void encodingPopup(const QPoint loc);
 	void lineEndingLabelClick(QMouseEvent * event) { lineEndingPopup(event->pos()); }
@@ -220,6 +241,7 @@ private:
 	QString readFile(const QString &fileName, QTextCodec **codecUsed, int *lineEndings = NULL, QTextCodec * forceCodec = NULL);
 	void loadFile(const QString &fileName, bool asTemplate = false, bool inBackground = false, QTextCodec * forceCodec = NULL);
 	bool saveFile(const QString &fileName);
+	void setSpellChecker(Hunhandle *h);
 	void setCurrentFile(const QString &fileName);
 	void saveRecentFileInfo();
 	bool getPreviewFileName(QString &pdfName);
@@ -234,12 +256,13 @@ private:
 	int doReplaceAll(const QString& searchText, QRegExp* regex, const QString& replacement,
 						QTextDocument::FindFlags flags, int rangeStart = -1, int rangeEnd = -1);
 	void executeAfterTypesetHooks();
+	void recordBuildStatistics(int exitCode);
+	QStringList engineArguments(const Engine& e, const QFileInfo& fileInfo);
 	void showConsole();
 	void hideConsole();
 	void goToLine(int lineNo, int selStart = -1, int selEnd = -1);
 	void updateTypesettingAction();
 	void findRootFilePath();
-	const QString& getRootFilePath();
 	void maybeCenterSelection(int oldScrollValue = -1);
 	void presentResults(const QList<SearchResult>& results);
 	void showLineEndingSetting();
@@ -271,12 +294,22 @@ private:
 	bool keepConsoleOpen;
 	bool showPdfWhenFinished;
 	bool userInterrupt;
+	bool typesetAfterSaving;
+	LivePreview *livePreview;
+	PreambleCache *preambleCache;
+	BuildDriver *buildDriver;
+	BuildDirectory *buildDirectory;
+	LogParser *parser;
+	ProcessMonitor *monitor;
+	QTime buildTimer;
+	QStringList typesetArguments;
 	QDateTime oldPdfTime;
 
 	QList<QAction*> recentFileActions;
 	QMenu *menuRecent;
 
 	Hunhandle *pHunspell;
+	QString spellingLanguage;
 
 	QFileSystemWatcher *watcher;
 	
@@ -22,9 +22,13 @@
 #include <QRegExp>
 #include <QTextCodec>
 #include <QTextCursor>
+#include <QTextEdit>
+#include <QScrollBar>
+#include <QTime>
 
 #include "TeXHighlighter.h"
 #include "TeXDocument.h"
+#include "TeXBlockData.h"
 #include "TWUtils.h"
 
 #include <limits.h> // for INT_MAX
@@ -32,19 +36,166 @@
 QList<TeXHighlighter::HighlightingSpec> *TeXHighlighter::syntaxRules = NULL;
 QList<TeXHighlighter::TagPattern> *TeXHighlighter::tagPatterns = NULL;
 
+const int kVisibleMargin = 50; // blocks above and below the viewport that count as shown
+const int kEagerBlocks = 4; // blocks of an edit that are always highlighted immediately
+const int kHighlightSlice = 20; // max msec spent highlighting pending blocks at a time
+
 TeXHighlighter::TeXHighlighter(QTextDocument *parent, TeXDocument *texDocument)
-	: QSyntaxHighlighter(parent)
+	: QSyntaxHighlighter(static_cast<QObject*>(parent))
 	, texDoc(texDocument)
 	, highlightIndex(-1)
 	, isTagging(true)
 	, pHunspell(NULL)
 	, spellingCodec(NULL)
+	, firstVisibleBlock(0)
+	, lastVisibleBlock(0)
+	, visibleRangeValid(false)
+	, nextPendingBlock(INT_MAX)
+	, eagerBlocks(0)
+	, forceHighlight(false)
+	, batchingTags(false)
+	, tagsChangedInBatch(false)
 {
 	loadPatterns();
 	spellFormat.setUnderlineStyle(QTextCharFormat::SpellCheckUnderline);
 	spellFormat.setUnderlineColor(Qt::red);
+
+	pendingTimer.setSingleShot(true);
+	pendingTimer.setInterval(0);
+	connect(&pendingTimer, SIGNAL(timeout()), this, SLOT(highlightPendingBlocks()));
+
+	// our own slot must see each change before QSyntaxHighlighter starts
+	// reformatting, so it is connected before the document is attached
+	connect(parent, SIGNAL(contentsChange(int,int,int)), this, SLOT(documentChanged(int,int,int)));
+	setDocument(parent);
+}
+
+void TeXHighlighter::setTextEdit(QTextEdit *edit)
+{
+	if (textEdit)
+		disconnect(textEdit->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(viewportMoved()));
+	textEdit = edit;
+	if (textEdit)
+		connect(textEdit->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(viewportMoved()));
+	viewportMoved();
+}
+
+#pragma mark === lazy highlighting ===
+
+// Only the blocks around the viewport (and the first few blocks of an edit)
+// are highlighted while QSyntaxHighlighter walks through a change; all other
+// blocks are just marked as pending and picked up by highlightPendingBlocks()
+// in short slices, so loading a file or switching the syntax mode doesn't
+// block the UI. As the highlighter keeps no state across blocks, a block can
+// be highlighted on its own at any time.
+
+void TeXHighlighter::rehighlight()
+{
+	eagerBlocks = 0;
+	updateVisibleRange();
+	QSyntaxHighlighter::rehighlight();
+}
+
+void TeXHighlighter::documentChanged(int position, int charsRemoved, int charsAdded)
+{
+	Q_UNUSED(charsRemoved);
+	Q_UNUSED(charsAdded);
+	if (forceHighlight)
+		return; // format changes made by highlightIfPending()
+	eagerBlocks = kEagerBlocks;
+	// removed blocks may have moved pending ones in front of nextPendingBlock
+	if (nextPendingBlock != INT_MAX) {
+		int changed = document()->findBlock(position).blockNumber();
+		if (changed >= 0 && changed < nextPendingBlock)
+			nextPendingBlock = changed;
+	}
+}
+
+void TeXHighlighter::viewportMoved()
+{
+	// the layout may still be in the middle of an update here, so the
+	// visible blocks are only looked up in the next pending slice
+	visibleRangeValid = false;
+	if (nextPendingBlock != INT_MAX)
+		pendingTimer.start();
+}
+
+void TeXHighlighter::updateVisibleRange()
+{
+	if (visibleRangeValid || !textEdit)
+		return;
+	firstVisibleBlock = textEdit->cursorForPosition(QPoint(0, 0)).blockNumber();
+	lastVisibleBlock = textEdit->cursorForPosition(QPoint(0, textEdit->viewport()->height())).blockNumber();
+	visibleRangeValid = true;
+}
+
+bool TeXHighlighter::isShown(const QTextBlock& block) const
+{
+	int number = block.blockNumber();
+	return number >= firstVisibleBlock - kVisibleMargin && number <= lastVisibleBlock + kVisibleMargin;
+}
+
+void TeXHighlighter::markPending(const QTextBlock& block)
+{
+	TeXBlockData::forBlock(block)->highlightPending = true;
+	int number = block.blockNumber();
+	if (number < nextPendingBlock)
+		nextPendingBlock = number;
+	if (!pendingTimer.isActive())
+		pendingTimer.start();
+}
+
+void TeXHighlighter::highlightIfPending(const QTextBlock& block)
+{
+	TeXBlockData *data = static_cast<TeXBlockData*>(block.userData());
+	if (data == NULL || !data->highlightPending)
+		return;
+#if QT_VERSION >= 0x040600
+	forceHighlight = true;
+	rehighlightBlock(block);
+	forceHighlight = false;
+#endif
+}
+
+void TeXHighlighter::highlightPendingBlocks()
+{
+	QTextDocument *doc = document();
+	if (doc == NULL || nextPendingBlock == INT_MAX)
+		return;
+
+	QTime time;
+	time.start();
+	updateVisibleRange();
+
+	// the outline is updated once per slice rather than once per block
+	batchingTags = true;
+	tagsChangedInBatch = false;
+
+	QTextBlock block = doc->findBlockByNumber(qMax(0, firstVisibleBlock - kVisibleMargin));
+	while (block.isValid() && isShown(block)) {
+		highlightIfPending(block);
+		block = block.next();
+	}
+
+	block = doc->findBlockByNumber(nextPendingBlock);
+	while (block.isValid()) {
+		highlightIfPending(block);
+		block = block.next();
+		if (time.elapsed() > kHighlightSlice)
+			break;
+	}
+	nextPendingBlock = block.isValid() ? block.blockNumber() : INT_MAX;
+
+	batchingTags = false;
+	if (tagsChangedInBatch && texDoc != NULL)
+		texDoc->tagsChanged();
+
+	if (nextPendingBlock != INT_MAX)
+		pendingTimer.start();
 }
 
+#pragma mark === highlighting ===
+
 void TeXHighlighter::spellCheckRange(const QString &text, int index, int limit, const QTextCharFormat &spellFormat)
 {
 	while (index < limit) {
@@ -67,6 +218,20 @@ void TeXHighlighter::spellCheckRange(const QString &text, int index, int limit,
 
 void TeXHighlighter::highlightBlock(const QString &text)
 {
+#if QT_VERSION >= 0x040600	/* pending blocks are caught up with rehighlightBlock(), new in 4.6 */
+	if (!forceHighlight) {
+		if (eagerBlocks > 0)
+			--eagerBlocks;
+		else if (!isShown(currentBlock())) {
+			markPending(currentBlock());
+			return;
+		}
+	}
+	TeXBlockData *data = static_cast<TeXBlockData*>(currentBlock().userData());
+	if (data != NULL)
+		data->highlightPending = false;
+#endif
+
 	int index = 0;
 	if (highlightIndex >= 0 && highlightIndex < syntaxRules->count()) {
 		QList<HighlightingRule>& highlightingRules = (*syntaxRules)[highlightIndex].rules;
@@ -129,8 +294,12 @@ void TeXHighlighter::highlightBlock(const QString &text)
 					break;
 			}
 		}
-		if (changed)	
-			texDoc->tagsChanged();
+		if (changed) {
+			if (batchingTags)
+				tagsChangedInBatch = true;
+			else
+				texDoc->tagsChanged();
+		}
 	}
 #endif
 }
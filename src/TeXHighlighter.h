@@ -25,11 +25,15 @@
 #include <QSyntaxHighlighter>
 
 #include <QTextCharFormat>
+#include <QTextBlock>
+#include <QTimer>
+#include <QPointer>
 
 #include <hunspell.h>
 
 class QTextDocument;
 class QTextCodec;
+class QTextEdit;
 class TeXDocument;
 
 class TeXHighlighter : public QSyntaxHighlighter
@@ -43,6 +47,10 @@ public:
 
 	void setSpellChecker(Hunhandle *h, QTextCodec *codec);
 
+	// the editor whose viewport is highlighted first; blocks that are not
+	// shown are highlighted (and tagged) later, in idle time
+	void setTextEdit(QTextEdit *edit);
+
 	QString getSyntaxMode() const {
 		return (highlightIndex >= 0 && highlightIndex < syntaxOptions().size())
 				? syntaxOptions().at(highlightIndex) : QString();
@@ -50,14 +58,27 @@ public:
 	
 	static QStringList syntaxOptions();
 
+public slots:
+	void rehighlight();
+
 protected:
 	void highlightBlock(const QString &text);
 
 	void spellCheckRange(const QString &text, int index, int limit, const QTextCharFormat &spellFormat);
 
+private slots:
+	void documentChanged(int position, int charsRemoved, int charsAdded);
+	void viewportMoved();
+	void highlightPendingBlocks();
+
 private:
 	static void loadPatterns();
 
+	bool isShown(const QTextBlock& block) const;
+	void markPending(const QTextBlock& block);
+	void highlightIfPending(const QTextBlock& block);
+	void updateVisibleRange();
+
 	struct HighlightingRule {
 		QRegExp pattern;
 		QTextCharFormat format;
@@ -86,6 +107,17 @@ private:
 
 	Hunhandle	*pHunspell;
 	QTextCodec	*spellingCodec;
+
+	QPointer<QTextEdit>	textEdit;
+	QTimer	pendingTimer;
+	int		firstVisibleBlock;
+	int		lastVisibleBlock;
+	bool	visibleRangeValid;
+	int		nextPendingBlock;	// no block before this one is waiting to be highlighted
+	int		eagerBlocks;		// blocks of the current edit that are highlighted right away
+	bool	forceHighlight;
+	bool	batchingTags;
+	bool	tagsChangedInBatch;
 };
 
 #endif
@@ -0,0 +1,257 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#include "TypesetScheduler.h"
+#include "TeXDocument.h"
+#include "ConfigurableApp.h"
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QTimer>
+#include <QMap>
+
+TypesetScheduler *TypesetScheduler::theInstance = NULL;
+
+TypesetScheduler *TypesetScheduler::instance()
+{
+	if (theInstance == NULL)
+		theInstance = new TypesetScheduler(QCoreApplication::instance());
+	return theInstance;
+}
+
+TypesetScheduler::TypesetScheduler(QObject *parent)
+	: QObject(parent), starting(false), startScheduled(false)
+{
+	QSETTINGS_OBJECT(settings);
+	maxJobs = settings.value("maxTypesetJobs", QThread::idealThreadCount()).toInt();
+	if (maxJobs < 1)
+		maxJobs = 1;
+	connect(SettingsStore::instance(), SIGNAL(valueChanged(const QString&, const QVariant&)),
+			this, SLOT(settingChanged(const QString&, const QVariant&)));
+}
+
+TypesetScheduler::~TypesetScheduler()
+{
+	if (theInstance == this)
+		theInstance = NULL;
+}
+
+void TypesetScheduler::setMaxConcurrentJobs(int count)
+{
+	maxJobs = qMax(count, 1);
+	scheduleStart();
+}
+
+void TypesetScheduler::settingChanged(const QString& key, const QVariant& value)
+{
+	if (key == "maxTypesetJobs")
+		setMaxConcurrentJobs(value.isValid() ? value.toInt() : QThread::idealThreadCount());
+}
+
+void TypesetScheduler::request(TeXDocument *doc, const QString& rootFile, JobKind kind)
+{
+	Job job;
+	job.doc = doc;
+	job.rootFile = rootFile;
+	job.kind = kind;
+
+	if (kind == PreviewJob) {
+		// the real run will refresh the preview anyway
+		foreach (const Job& other, running + queued) {
+			if (other.kind == TypesetJob && (other.rootFile == rootFile || other.doc == doc))
+				return;
+		}
+	}
+	else
+		dropPreviews(rootFile);
+
+	// a newer request supersedes a run of the same root that is in progress
+	for (int i = running.count() - 1; i >= 0; --i) {
+		if (running[i].kind == kind && (running[i].rootFile == rootFile || running[i].doc == doc)) {
+			abortJob(running.takeAt(i));
+			queued.prepend(job);
+			scheduleStart();
+			emit queueChanged();
+			return;
+		}
+	}
+
+	// coalesce with a job that is still waiting, keeping its place in the queue
+	for (int i = 0; i < queued.count(); ++i) {
+		if (queued[i].kind == kind && (queued[i].rootFile == rootFile || queued[i].doc == doc)) {
+			queued[i] = job;
+			emit queueChanged();
+			return;
+		}
+	}
+
+	queued.append(job);
+	scheduleStart();
+	emit queueChanged();
+}
+
+void TypesetScheduler::jobFinished(TeXDocument *doc, JobKind kind)
+{
+	removeJobs(doc, kind);
+}
+
+void TypesetScheduler::cancel(TeXDocument *doc, JobKind kind)
+{
+	if (kind == PreviewJob) {
+		foreach (const Job& job, running) {
+			if (job.doc == doc && job.kind == PreviewJob)
+				abortJob(job);
+		}
+	}
+	removeJobs(doc, kind);
+}
+
+void TypesetScheduler::removeJobs(const TeXDocument *doc, JobKind kind)
+{
+	bool changed = false;
+	for (int i = running.count() - 1; i >= 0; --i) {
+		if ((running[i].doc == doc && running[i].kind == kind) || running[i].doc.isNull()) {
+			running.removeAt(i);
+			changed = true;
+		}
+	}
+	for (int i = queued.count() - 1; i >= 0; --i) {
+		if ((queued[i].doc == doc && queued[i].kind == kind) || queued[i].doc.isNull()) {
+			queued.removeAt(i);
+			changed = true;
+		}
+	}
+	if (changed) {
+		scheduleStart();
+		emit queueChanged();
+	}
+}
+
+void TypesetScheduler::dropPreviews(const QString& rootFile)
+{
+	for (int i = running.count() - 1; i >= 0; --i) {
+		if (running[i].kind == PreviewJob && running[i].rootFile == rootFile)
+			abortJob(running.takeAt(i));
+	}
+	for (int i = queued.count() - 1; i >= 0; --i) {
+		if (queued[i].kind == PreviewJob && queued[i].rootFile == rootFile)
+			queued.removeAt(i);
+	}
+}
+
+bool TypesetScheduler::startJob(const Job& job)
+{
+	if (job.kind == PreviewJob)
+		return job.doc->startLivePreview();
+	return job.doc->startTypesetting();
+}
+
+void TypesetScheduler::abortJob(const Job& job)
+{
+	if (job.doc.isNull())
+		return;
+	if (job.kind == PreviewJob)
+		job.doc->abortLivePreview();
+	else
+		job.doc->abortTypesetting();
+}
+
+void TypesetScheduler::scheduleStart()
+{
+	// start jobs from the event loop, never from within a document's
+	// process handlers
+	if (!startScheduled) {
+		startScheduled = true;
+		QTimer::singleShot(0, this, SLOT(startJobs()));
+	}
+}
+
+void TypesetScheduler::startJobs()
+{
+	startScheduled = false;
+	// starting a job may open a message box, which runs a nested event loop
+	if (starting)
+		return;
+	starting = true;
+
+	bool changed = false;
+	while (running.count() < maxJobs && !queued.isEmpty()) {
+		Job job = queued.takeFirst();
+		changed = true;
+		if (job.doc.isNull())
+			continue;
+		running.append(job);
+		if (!startJob(job)) {
+			for (int i = running.count() - 1; i >= 0; --i) {
+				if (running[i].doc == job.doc && running[i].kind == job.kind)
+					running.removeAt(i);
+			}
+		}
+	}
+
+	starting = false;
+	if (changed)
+		emit queueChanged();
+}
+
+TypesetScheduler::JobState TypesetScheduler::state(const TeXDocument *doc, JobKind kind) const
+{
+	foreach (const Job& job, running) {
+		if (job.doc == doc && job.kind == kind)
+			return Running;
+	}
+	foreach (const Job& job, queued) {
+		if (job.doc == doc && job.kind == kind)
+			return Queued;
+	}
+	return Idle;
+}
+
+int TypesetScheduler::queuePosition(const TeXDocument *doc, JobKind kind) const
+{
+	for (int i = 0; i < queued.count(); ++i) {
+		if (queued[i].doc == doc && queued[i].kind == kind)
+			return i + 1;
+	}
+	return 0;
+}
+
+QList<QVariant> TypesetScheduler::jobs() const
+{
+	QList<QVariant> result;
+	foreach (const Job& job, running) {
+		QMap<QString, QVariant> map;
+		map["rootFile"] = job.rootFile;
+		map["kind"] = (job.kind == PreviewJob ? "preview" : "typeset");
+		map["state"] = "running";
+		map["window"] = QVariant::fromValue(qobject_cast<QObject*>(job.doc));
+		result << map;
+	}
+	foreach (const Job& job, queued) {
+		QMap<QString, QVariant> map;
+		map["rootFile"] = job.rootFile;
+		map["kind"] = (job.kind == PreviewJob ? "preview" : "typeset");
+		map["state"] = "queued";
+		map["window"] = QVariant::fromValue(qobject_cast<QObject*>(job.doc));
+		result << map;
+	}
+	return result;
+}
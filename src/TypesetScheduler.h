@@ -0,0 +1,112 @@
+/*
+	This is part of TeXworks, an environment for working with TeX documents
+	Copyright (C) 2007-2011  Jonathan Kew, Stefan Löffler
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	For links to further information, or to contact the author,
+	see <http://texworks.org/>.
+*/
+
+#ifndef TypesetScheduler_H
+#define TypesetScheduler_H
+
+#include <QObject>
+#include <QList>
+#include <QVariant>
+#include <QPointer>
+
+class TeXDocument;
+
+// Central queue for typesetting jobs. Requests are keyed by root file: a
+// request for a root that is already waiting replaces the waiting job, and
+// one for a root that is being typeset cancels the running engine and
+// restarts it. At most maxConcurrentJobs() engines run at the same time
+// (by default one per processor core); further jobs wait in the queue.
+// Live-preview runs share the queue but give way to real typesetting: a
+// typeset request drops any preview of the same root, and no preview is
+// queued while the root is being typeset.
+class TypesetScheduler : public QObject
+{
+	Q_OBJECT
+
+	Q_PROPERTY(int maxConcurrentJobs READ maxConcurrentJobs WRITE setMaxConcurrentJobs)
+	Q_PROPERTY(int runningCount READ runningCount)
+	Q_PROPERTY(int queuedCount READ queuedCount)
+
+public:
+	enum JobState {
+		Idle,
+		Queued,
+		Running
+	};
+
+	enum JobKind {
+		TypesetJob,
+		PreviewJob
+	};
+
+	static TypesetScheduler *instance();
+
+	void request(TeXDocument *doc, const QString& rootFile, JobKind kind = TypesetJob);
+	// called by the document when its engine has finished (or failed)
+	void jobFinished(TeXDocument *doc, JobKind kind = TypesetJob);
+	// drop any queued or running job of doc
+	void cancel(TeXDocument *doc, JobKind kind = TypesetJob);
+
+	JobState state(const TeXDocument *doc, JobKind kind = TypesetJob) const;
+	// 1-based position in the queue, or 0 if doc isn't waiting
+	int queuePosition(const TeXDocument *doc, JobKind kind = TypesetJob) const;
+
+	int maxConcurrentJobs() const { return maxJobs; }
+	void setMaxConcurrentJobs(int count);
+	int runningCount() const { return running.count(); }
+	int queuedCount() const { return queued.count(); }
+
+	// for scripts: one map (rootFile, kind, state, window) per job, running jobs first
+	Q_INVOKABLE QList<QVariant> jobs() const;
+
+signals:
+	void queueChanged();
+
+private slots:
+	void settingChanged(const QString& key, const QVariant& value);
+	void startJobs();
+
+private:
+	TypesetScheduler(QObject *parent = NULL);
+	virtual ~TypesetScheduler();
+
+	struct Job {
+		QPointer<TeXDocument> doc;
+		QString rootFile;
+		JobKind kind;
+	};
+
+	void removeJobs(const TeXDocument *doc, JobKind kind);
+	void dropPreviews(const QString& rootFile);
+	bool startJob(const Job& job);
+	void abortJob(const Job& job);
+	void scheduleStart();
+
+	QList<Job> queued;
+	QList<Job> running;
+	int maxJobs;
+	bool starting;
+	bool startScheduled;
+
+	static TypesetScheduler *theInstance;
+};
+
+#endif